@@ -5,6 +5,7 @@ TARGET=KPhotoAlbum
 SOURCES += main.cpp \
     RemoteInterface.cpp \
     RemoteConnection.cpp \
+    NetworkWorker.cpp \
     RemoteImage.cpp \
     RemoteCommand.cpp \
     Client.cpp \
@@ -41,6 +42,7 @@ RESOURCES += \
 HEADERS += \
     RemoteInterface.h \
     RemoteConnection.h \
+    NetworkWorker.h \
     RemoteImage.h \
     RemoteCommand.h \
     Client.h \
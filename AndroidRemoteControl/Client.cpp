@@ -18,16 +18,20 @@
 
 #include "Client.h"
 
-#include <QTcpSocket>
 #include <QUdpSocket>
 #include "RemoteCommand.h"
 
 using namespace RemoteControl;
 
+void TcpServer::incomingConnection(qintptr socketDescriptor)
+{
+    emit newSocketDescriptor(socketDescriptor);
+}
+
 Client::Client(QObject *parent) :
     RemoteConnection(parent)
 {
-    connect(&m_server, &QTcpServer::newConnection, this, &Client::acceptConnection);
+    connect(&m_server, &TcpServer::newSocketDescriptor, this, &Client::acceptConnection);
     connect(&m_timer, &QTimer::timeout, this, &Client::sendBroadcastPackage);
     m_server.listen(QHostAddress::Any, TCPPORT);
     m_timer.start(500);
@@ -35,20 +39,18 @@ Client::Client(QObject *parent) :
 
 bool Client::isConnected() const
 {
-    return m_socket != nullptr;
+    return m_isConnected;
 }
 
-QTcpSocket* Client::socket()
+void Client::acceptConnection(qintptr socketDescriptor)
 {
-    return m_socket;
+    m_timer.stop();
+    takeOverSocket(socketDescriptor);
 }
 
-void Client::acceptConnection()
+void Client::connectionEstablished()
 {
-    m_timer.stop();
-    m_socket = m_server.nextPendingConnection();
-    connect(m_socket, &QTcpSocket::disconnected, this, &Client::disconnect);
-    connect(m_socket, &QTcpSocket::readyRead, this, &Client::dataReceived);
+    m_isConnected = true;
     emit gotConnected();
 }
 
@@ -59,10 +61,9 @@ void Client::sendBroadcastPackage()
     socket.writeDatagram(data, QHostAddress::Broadcast, UDPPORT);
 }
 
-void Client::disconnect()
+void Client::connectionLost()
 {
     m_timer.start(500);
-    m_socket->deleteLater();
-    m_socket = nullptr;
+    m_isConnected = false;
     emit disconnected();
 }
@@ -25,6 +25,23 @@
 
 namespace RemoteControl {
 
+/**
+ * Hands out the socket descriptor of each incoming connection instead of a QTcpSocket,
+ * so the socket can be created in the network thread of the RemoteConnection.
+ */
+class TcpServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    using QTcpServer::QTcpServer;
+
+signals:
+    void newSocketDescriptor(qintptr socketDescriptor);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+};
+
 class Client : public RemoteConnection
 {
     Q_OBJECT
@@ -36,17 +53,17 @@ signals:
     void gotConnected();
     void disconnected();
 
-protected:
-    QTcpSocket* socket() override;
+protected slots:
+    void connectionEstablished() override;
+    void connectionLost() override;
 
 private slots:
-    void acceptConnection();
+    void acceptConnection(qintptr socketDescriptor);
     void sendBroadcastPackage();
-    void disconnect();
 
 private:
-    QTcpServer m_server;
-    QTcpSocket* m_socket = nullptr;
+    TcpServer m_server;
+    bool m_isConnected = false;
     QTimer m_timer;
 
 };
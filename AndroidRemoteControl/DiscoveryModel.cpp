@@ -38,6 +38,19 @@ void DiscoveryModel::setImages(const QList<int>& images)
     resetImages();
 }
 
+void DiscoveryModel::appendImages(const QList<int>& images)
+{
+    // Keep the images shown, unless there were too few to choose from so far
+    const bool hadEnough = m_allImages.count() >= m_count;
+    m_allImages.append(images);
+    if (m_count == 0 || !m_action)
+        return;
+    if (hadEnough)
+        m_action->setCurrentSelection(m_images, m_allImages);
+    else
+        resetImages();
+}
+
 void DiscoveryModel::setCurrentSelection(const QList<int> &selection, const QList<int> &allImages)
 {
     ThumbnailModel::setImages(selection);
@@ -34,6 +34,7 @@ public:
     DiscoveryModel(QObject* parent);
     int count() const;
     void setImages(const QList<int>&images) override;
+    void appendImages(const QList<int>& images) override;
     void setCurrentSelection(const QList<int>& selection, const QList<int>& allImages);
     void setCurrentAction(DiscoverAction* action);
 
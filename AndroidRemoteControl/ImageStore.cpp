@@ -81,6 +81,24 @@ void ImageStore::updateImage(ImageId imageId, const QImage& image, const QString
     }
 }
 
+// Thumbnails taken from the thumbnail cache of the desktop may be larger than requested.
+void ImageStore::updateThumbnail(ImageId imageId, const QByteArray& jpegData)
+{
+    QSize size;
+    {
+        QMutexLocker locker(&m_mutex);
+        RemoteImage* client = m_requestMap.value(qMakePair(imageId, ViewType::Thumbnails));
+        if (!client)
+            return;
+        size = client->size();
+    }
+
+    QImage image = QImage::fromData(jpegData, "JPEG");
+    if (image.width() > size.width() || image.height() > size.height())
+        image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    updateImage(imageId, image, QString(), ViewType::Thumbnails);
+}
+
 void RemoteControl::ImageStore::reset()
 {
     QList<RemoteImage*> keys = m_reverseRequestMap.keys();
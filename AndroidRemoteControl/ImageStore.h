@@ -35,6 +35,7 @@ class ImageStore : public QObject
 public:
     static ImageStore& instance();
     void updateImage(ImageId imageId, const QImage& requestImage, const QString& label, ViewType type);
+    void updateThumbnail(ImageId imageId, const QByteArray& jpegData);
     void requestImage(RemoteImage* client, ImageId imageId, const QSize& size, ViewType type);
 
 private slots:
@@ -0,0 +1 @@
+../RemoteControl/NetworkWorker.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../RemoteControl/NetworkWorker.h
\ No newline at end of file
@@ -252,10 +252,14 @@ void RemoteInterface::handleCommand(const RemoteCommand& command)
 {
     if (command.commandType() == CommandType::ThumbnailResult)
         updateImage(static_cast<const ThumbnailResult&>(command));
+    else if (command.commandType() == CommandType::ThumbnailBatchResult)
+        updateImages(static_cast<const ThumbnailBatchResult&>(command));
     else if (command.commandType() == CommandType::CategoryListResult)
         updateCategoryList(static_cast<const CategoryListResult&>(command));
     else if (command.commandType() == CommandType::SearchResult)
         gotSearchResult(static_cast<const SearchResult&>(command));
+    else if (command.commandType() == CommandType::SearchResultPage)
+        gotSearchResultPage(static_cast<const SearchResultPage&>(command));
     else if (command.commandType() == CommandType::TimeCommand)
         ; // Used for debugging, it will print time stamp when decoded
     else if (command.commandType() == CommandType::ImageDetailsResult) {
@@ -275,6 +279,12 @@ void RemoteInterface::updateImage(const ThumbnailResult& command)
     ImageStore::instance().updateImage(command.imageId, command.image, command.label, command.type);
 }
 
+void RemoteInterface::updateImages(const ThumbnailBatchResult& command)
+{
+    for (const CachedThumbnail& thumbnail : command.thumbnails)
+        ImageStore::instance().updateThumbnail(thumbnail.imageId, thumbnail.data);
+}
+
 void RemoteInterface::updateCategoryList(const CategoryListResult& command)
 {
     ScreenInfo::instance().setCategoryCount(command.categories.count());
@@ -290,3 +300,12 @@ void RemoteInterface::gotSearchResult(const SearchResult& result)
         m_categoryItems->setImages(result.result);
     }
 }
+
+void RemoteInterface::gotSearchResultPage(const SearchResultPage& page)
+{
+    // Show the first page right away, and add the others as they arrive
+    if (page.isFirstPage)
+        m_activeThumbnailModel->setImages(page.result);
+    else
+        m_activeThumbnailModel->appendImages(page.result);
+}
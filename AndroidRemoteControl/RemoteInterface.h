@@ -110,8 +110,10 @@ private slots:
     void requestInitialData();
     void handleCommand(const RemoteCommand&);
     void updateImage(const ThumbnailResult&);
+    void updateImages(const ThumbnailBatchResult&);
     void updateCategoryList(const CategoryListResult&);
     void gotSearchResult(const SearchResult&);
+    void gotSearchResultPage(const SearchResultPage&);
     void requestHomePageImages();
     void gotDisconnected();
 private:
@@ -50,6 +50,16 @@ void ThumbnailModel::setImages(const QList<int>& images)
     endResetModel();
 }
 
+void ThumbnailModel::appendImages(const QList<int>& images)
+{
+    if (images.isEmpty())
+        return;
+
+    beginInsertRows(QModelIndex(), m_images.count(), m_images.count() + images.count() - 1);
+    m_images.append(images);
+    endInsertRows();
+}
+
 int ThumbnailModel::indexOf(int imageId)
 {
     return m_images.indexOf(imageId);
@@ -34,6 +34,7 @@ public:
     QVariant data(const QModelIndex &index, int role) const override;
     RoleMap roleNames() const override;
     virtual void setImages(const QList<int>&image);
+    virtual void appendImages(const QList<int>& images);
     int indexOf(int imageId);
 
 protected:
@@ -25,6 +25,7 @@
 
 #include <CategoryListView/CheckDropItem.h>
 #include <CategoryListView/DragableTreeWidget.h>
+#include <DB/CategoryImageCache.h>
 #include <DB/CategoryItem.h>
 #include <DB/ImageDB.h>
 #include <DB/MemberMap.h>
@@ -352,13 +353,16 @@ void AnnotationDialog::ListSelect::showContextMenu(const QPoint& pos)
     QAction* newCategoryAction = nullptr;
     if ( item ) {
         QStringList grps = memberMap.groups( m_category->name() );
+        const QSharedPointer<const DB::CompiledMemberMap> compiledMap = memberMap.compiled( m_category->name() );
+        const int itemId = compiledMap->id( item->text(0) );
 
         for( QStringList::ConstIterator it = grps.constBegin(); it != grps.constEnd(); ++it ) {
-            if (!memberMap.canAddMemberToGroup(m_category->name(), *it, item->text(0)))
+            // same as memberMap.canAddMemberToGroup(), without looking up the compiled map for each group:
+            if ( compiledMap->hasPath( item->text(0), *it ) )
                 continue;
             QAction* action = members->addAction( *it );
             action->setCheckable(true);
-            action->setChecked( (bool) memberMap.members( m_category->name(), *it, false ).contains( item->text(0) ) );
+            action->setChecked( itemId >= 0 && compiledMap->parents( itemId ).contains( compiledMap->id( *it ) ) );
             action->setData( *it );
         }
 
@@ -446,7 +450,11 @@ void AnnotationDialog::ListSelect::showContextMenu(const QPoint& pos)
                 // rename the category image too
                 QString oldFile = m_category->fileForCategoryImage( category(), oldStr );
                 QString newFile = m_category->fileForCategoryImage( category(), newStr );
-                KIO::move( QUrl::fromLocalFile(oldFile), QUrl::fromLocalFile(newFile) );
+                KIO::CopyJob* job = KIO::move( QUrl::fromLocalFile(oldFile), QUrl::fromLocalFile(newFile) );
+                connect( job, &KJob::result, this, [oldFile, newFile] {
+                    DB::CategoryImageCache::instance()->invalidate( oldFile );
+                    DB::CategoryImageCache::instance()->invalidate( newFile );
+                });
 
                 if (m_positionable) {
                     // Also take care of areas that could be linked against this
@@ -23,13 +23,72 @@
 #include <DB/ImageDB.h>
 #include <DB/MemberMap.h>
 #include <QIcon>
+#include <QElapsedTimer>
+#include <QTimer>
 #include "enums.h"
 
+namespace
+{
+// Files counted between checks of the elapsed time.
+// Large enough for the classifier to spread a step over several threads.
+constexpr int FILES_PER_STEP = 8000;
+// Time spent counting before the model is updated and the event loop gets control again.
+constexpr int SLICE_MS = 50;
+}
+
 Browser::AbstractCategoryModel::AbstractCategoryModel( const DB::CategoryPtr& category, const DB::ImageSearchInfo& info )
     : m_category( category ), m_info( info )
+    , m_classifier( DB::ImageDB::instance()->createClassifier( info, QStringList() << category->name() ) )
+    , m_countTimer( new QTimer( this ) )
+{
+    // The first slice runs once the subclass is constructed and the model is shown.
+    m_countTimer->setSingleShot( true );
+    connect( m_countTimer, &QTimer::timeout, this, &AbstractCategoryModel::countNextSlice );
+    m_countTimer->start( 0 );
+}
+
+void Browser::AbstractCategoryModel::finishCounting()
+{
+    if ( !m_classifier )
+        return;
+
+    m_countTimer->stop();
+    while ( !m_classifier->countNext( FILES_PER_STEP ) )
+        ;
+    updateCounts();
+}
+
+bool Browser::AbstractCategoryModel::isCounting() const
 {
-    m_images = DB::ImageDB::instance()->classify( info, m_category->name(), DB::Image );
-    m_videos = DB::ImageDB::instance()->classify( info, m_category->name(), DB::Video );
+    return m_classifier != nullptr;
+}
+
+void Browser::AbstractCategoryModel::countNextSlice()
+{
+    QElapsedTimer timer;
+    timer.start();
+    bool finished = false;
+    while ( !finished && timer.elapsed() < SLICE_MS )
+        finished = m_classifier->countNext( FILES_PER_STEP );
+
+    if ( !finished )
+        m_countTimer->start( 0 );
+    updateCounts();
+}
+
+void Browser::AbstractCategoryModel::updateCounts()
+{
+    const DB::CategoryClassification counts = m_classifier->result().value( m_category->name() );
+    m_images = counts.images;
+    m_videos = counts.videos;
+
+    const bool finished = m_classifier->isFinished();
+    if ( finished )
+        m_classifier.reset();
+
+    countsChanged();
+    if ( finished )
+        emit countingFinished();
 }
 
 bool Browser::AbstractCategoryModel::hasNoneEntry() const
@@ -19,9 +19,14 @@
 #ifndef ABSTRACTCATEGORYMODEL_H
 #define ABSTRACTCATEGORYMODEL_H
 #include <QAbstractItemModel>
+#include <DB/CategoryClassifier.h>
 #include <DB/ImageSearchInfo.h>
 #include <DB/CategoryPtr.h>
 
+#include <memory>
+
+class QTimer;
+
 namespace Browser
 {
 
@@ -31,17 +36,38 @@ namespace Browser
  * See \ref Browser for a detailed description of how this fits in with the rest of the classes in this module
  *
  * This class implements what is common for \ref FlatCategoryModel and \ref TreeCategoryModel.
+ *
+ * The items are counted in the background, a slice of the database at a time, so that the page
+ * can be shown right away. Only items with a non-zero count are part of the model, so rows are
+ * added while counting goes on, but never removed.
  */
 class AbstractCategoryModel :public QAbstractItemModel
 {
+    Q_OBJECT
+
 public:
     Qt::ItemFlags flags ( const QModelIndex& index ) const override;
     QVariant data( const QModelIndex & index, int role) const override;
     QVariant headerData ( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
 
+    /**
+     * @brief Count all remaining images right away, for users that need the complete model.
+     */
+    void finishCounting();
+    bool isCounting() const;
+
+signals:
+    void countingFinished();
+
 protected:
     AbstractCategoryModel( const DB::CategoryPtr& category, const DB::ImageSearchInfo& info );
 
+    /**
+     * @brief Called whenever m_images and m_videos have been updated.
+     * Counts never decrease, so implementations only need to insert rows that now have images or videos.
+     */
+    virtual void countsChanged() = 0;
+
     bool hasNoneEntry() const;
     QString text( const QString& name ) const;
     QPixmap icon( const QString& name ) const;
@@ -52,6 +78,14 @@ protected:
     QMap<QString, uint> m_images;
     QMap<QString, uint> m_videos;
 
+private slots:
+    void countNextSlice();
+
+private:
+    void updateCounts();
+
+    std::unique_ptr<DB::CategoryClassifier> m_classifier;
+    QTimer* m_countTimer;
 };
 
 }
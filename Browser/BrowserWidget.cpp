@@ -295,6 +295,10 @@ void Browser::BrowserWidget::setModel( QAbstractItemModel* model)
     // make sure the view knows about the source model change:
     m_curView->setModel( m_filterProxy );
 
+    if (AbstractCategoryModel* categoryModel = qobject_cast<AbstractCategoryModel*>(model)) {
+        // the columns were sized while the counts were still coming in:
+        connect(categoryModel, &AbstractCategoryModel::countingFinished, this, &BrowserWidget::adjustTreeViewColumnSize);
+    }
     if (qobject_cast<TreeCategoryModel*>(model)) {
         // FIXME: The new-style connect here does not work, reload() is not triggered
         //connect(model, &QAbstractItemModel::dataChanged, this, &BrowserWidget::reload);
@@ -23,19 +23,40 @@
 Browser::FlatCategoryModel::FlatCategoryModel( const DB::CategoryPtr& category, const DB::ImageSearchInfo& info )
     : AbstractCategoryModel( category, info )
 {
-    if ( hasNoneEntry() )
-        m_items.append( DB::ImageDB::NONE() );
+    m_candidates = m_category->itemsInclCategories();
+    m_candidates.sort();
+}
 
-    QStringList items = m_category->itemsInclCategories();
-    items.sort();
+void Browser::FlatCategoryModel::countsChanged()
+{
+    if ( hasNoneEntry() && ( m_items.isEmpty() || m_items.first() != DB::ImageDB::NONE() ) ) {
+        beginInsertRows( QModelIndex(), 0, 0 );
+        m_items.prepend( DB::ImageDB::NONE() );
+        endInsertRows();
+    }
 
-    Q_FOREACH( const QString &name, items ) {
-        const int imageCount = m_images.contains(name) ? m_images[name] : 0;
-        const int videoCount = m_videos.contains(name) ? m_videos[name] : 0;
+    // Both lists are in the same order, and m_items only grows, so the new items can be inserted in one pass.
+    int row = ( !m_items.isEmpty() && m_items.first() == DB::ImageDB::NONE() ) ? 1 : 0;
+    QStringList pending;
+    const auto insertPending = [&] {
+        if ( pending.isEmpty() )
+            return;
+        beginInsertRows( QModelIndex(), row, row + pending.size() - 1 );
+        for ( const QString& name : pending )
+            m_items.insert( row++, name );
+        endInsertRows();
+        pending.clear();
+    };
 
-        if ( imageCount + videoCount > 0 )
-            m_items.append( name );
+    for ( const QString& name : m_candidates ) {
+        if ( row < m_items.size() && m_items[row] == name ) {
+            insertPending();
+            ++row;
+        } else if ( m_images.value( name ) + m_videos.value( name ) > 0 ) {
+            pending.append( name );
+        }
     }
+    insertPending();
 }
 
 int Browser::FlatCategoryModel::rowCount( const QModelIndex& index ) const
@@ -43,8 +43,14 @@ public:
 
     QString indexToName(const QModelIndex& ) const override;
 
+protected:
+    void countsChanged() override;
+
 private:
     friend class RemoteControl::RemoteInterface;
+    /// all items of the category, in the order they are shown
+    QStringList m_candidates;
+    /// the items with images or videos, in the order of m_candidates
     QStringList m_items;
 };
 
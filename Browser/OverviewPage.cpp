@@ -272,7 +272,7 @@ Browser::BrowserPage* Browser::OverviewPage::activateExivAction()
 
     delete dialog;
 
-    if ( DB::ImageDB::instance()->count( info ).total() == 0 ) {
+    if ( !DB::ImageDB::instance()->hasMatches( info ) ) {
         KMessageBox::information( browser(), i18n( "Search did not match any images or videos." ), i18n("Empty Search Result") );
         return nullptr;
     }
@@ -292,7 +292,7 @@ Browser::BrowserPage* Browser::OverviewPage::activateSearchAction()
     if ( info.isNull() )
         return nullptr;
 
-    if ( DB::ImageDB::instance()->count( info ).total() == 0 ) {
+    if ( !DB::ImageDB::instance()->hasMatches( info ) ) {
         KMessageBox::information( browser(), i18n( "Search did not match any images or videos." ), i18n("Empty Search Result") );
         return nullptr;
     }
@@ -315,10 +315,16 @@ void Browser::OverviewPage::updateImageCount()
 {
     QElapsedTimer timer;
     timer.start();
+    const QList<DB::CategoryPtr> categoryList = categories();
+    QStringList names;
+    for (const DB::CategoryPtr& category : categoryList )
+        names.append( category->name() );
+
+    const QMap<QString, DB::CategoryClassification> classification
+        = DB::ImageDB::instance()->classifyCategories( BrowserPage::searchInfo(), names );
     int row = 0;
-    for (const DB::CategoryPtr& category : categories() ) {
-        QMap<QString, uint> items = DB::ImageDB::instance()->classify( BrowserPage::searchInfo(), category->name(), DB::anyMediaType );
-        m_count[row] = items.count();
+    for (const QString& name : names ) {
+        m_count[row] = classification[name].counts( DB::anyMediaType ).count();
         ++row;
     }
     qCDebug(TimingLog) << "Browser::Overview::updateImageCount(): " << timer.elapsed() << "ms.";
@@ -22,14 +22,13 @@
 // Local includes
 #include "TreeCategoryModel.h"
 #include "DB/ImageDB.h"
-#include "DB/CategoryItem.h"
 #include "DB/Category.h"
 #include "MainWindow/DirtyIndicator.h"
 
 struct Browser::TreeCategoryModel::Data
 {
-    Data(const QString& name)
-        : name(name), parent(nullptr)
+    Data(const QString& name, const DB::CategoryItem* item)
+        : name(name), item(item), parent(nullptr), populated(false)
     {
     }
 
@@ -44,29 +43,29 @@ struct Browser::TreeCategoryModel::Data
     }
 
     QString name;
+    // nullptr for the "None" entry
+    const DB::CategoryItem* item;
     QList<Data*> children;
     Data* parent;
+    // whether children has been filled in from item
+    bool populated;
 };
 
 Browser::TreeCategoryModel::TreeCategoryModel(const DB::CategoryPtr& category,
                                               const DB::ImageSearchInfo& info)
     : AbstractCategoryModel(category, info)
 {
-    m_data = new Data(QString());
-    createData(m_category->itemsCategories().data(), 0);
-
-    if (hasNoneEntry()) {
-        Data* data = new Data(DB::ImageDB::NONE());
-        data->parent = m_data;
-        m_data->children.prepend(data);
-    }
+    m_rootItem = m_category->itemsCategories();
+    m_data = new Data(m_rootItem->mp_name, m_rootItem.data());
 
     m_memberMap = DB::ImageDB::instance()->memberMap();
 }
 
 int Browser::TreeCategoryModel::rowCount(const QModelIndex& index) const
 {
-    return indexToData(index)->children.count();
+    Data* data = indexToData(index);
+    populate(data);
+    return data->children.count();
 }
 
 int Browser::TreeCategoryModel::columnCount(const QModelIndex&) const
@@ -76,8 +75,9 @@ int Browser::TreeCategoryModel::columnCount(const QModelIndex&) const
 
 QModelIndex Browser::TreeCategoryModel::index(int row, int column, const QModelIndex& parent) const
 {
-    const Data* data = indexToData(parent);
-    QList<Data*> children = data->children;
+    Data* data = indexToData(parent);
+    populate(data);
+    const QList<Data*>& children = data->children;
     int size = children.count();
     if ( row >= size || row < 0 || column >= columnCount(parent) || column < 0) {
         // Invalid index
@@ -109,31 +109,101 @@ Browser::TreeCategoryModel::~TreeCategoryModel()
     delete m_data;
 }
 
-bool Browser::TreeCategoryModel::createData(DB::CategoryItem* parentCategoryItem, Data* parent)
+void Browser::TreeCategoryModel::populate(Data* data) const
 {
-    const QString name = parentCategoryItem->mp_name;
-    const int imageCount = m_images.contains(name) ? m_images[name] : 0;
-    const int videoCount = m_videos.contains(name) ? m_videos[name] : 0;
+    if (data->populated) {
+        return;
+    }
+    data->populated = true;
 
-    Data* myData = new Data(name);
-    bool anyItems = imageCount != 0 || videoCount != 0;
+    if (data == m_data && hasNoneEntry()) {
+        data->addChild(new Data(DB::ImageDB::NONE(), nullptr));
+    }
+    if (data->item) {
+        for (const DB::CategoryItem* subCategory : data->item->mp_subcategories) {
+            if (isVisible(subCategory)) {
+                data->addChild(new Data(subCategory->mp_name, subCategory));
+            }
+        }
+    }
+}
 
-    for(QList<DB::CategoryItem*>::ConstIterator subCategoryIt = parentCategoryItem->mp_subcategories.constBegin();
-        subCategoryIt != parentCategoryItem->mp_subcategories.constEnd(); ++subCategoryIt) {
-        anyItems = createData(*subCategoryIt, myData) || anyItems;
+bool Browser::TreeCategoryModel::isVisible(const DB::CategoryItem* item) const
+{
+    const auto it = m_visible.constFind(item->mp_name);
+    if (it != m_visible.constEnd()) {
+        return it.value();
     }
 
-    if (parent) {
-        if (anyItems) {
-            parent->addChild(myData);
-        } else {
-            delete myData;
+    bool visible = m_images.value(item->mp_name) != 0 || m_videos.value(item->mp_name) != 0;
+    for (const DB::CategoryItem* subCategory : item->mp_subcategories) {
+        if (visible) {
+            break;
         }
-    } else {
-        m_data = myData;
+        visible = isVisible(subCategory);
+    }
+    m_visible.insert(item->mp_name, visible);
+    return visible;
+}
+
+bool Browser::TreeCategoryModel::hasNoneChild(const Data* data) const
+{
+    return !data->children.isEmpty() && data->children.first()->item == nullptr;
+}
+
+void Browser::TreeCategoryModel::countsChanged()
+{
+    m_visible.clear();
+    if (m_data->populated && hasNoneEntry() && !hasNoneChild(m_data)) {
+        beginInsertRows(QModelIndex(), 0, 0);
+        Data* none = new Data(DB::ImageDB::NONE(), nullptr);
+        none->parent = m_data;
+        m_data->children.prepend(none);
+        endInsertRows();
+    }
+    insertVisibleChildren(m_data, QModelIndex());
+}
+
+void Browser::TreeCategoryModel::insertVisibleChildren(Data* data, const QModelIndex& parentIndex)
+{
+    if (!data->populated || !data->item) {
+        // Will be populated with the current counts once the view asks for it.
+        return;
     }
 
-    return anyItems;
+    // Children are in the order of data->item->mp_subcategories, and only ever get added,
+    // so the new ones can be inserted in one pass.
+    int row = hasNoneChild(data) ? 1 : 0;
+    QList<Data*> pending;
+    const auto insertPending = [&] {
+        if (pending.isEmpty()) {
+            return;
+        }
+        beginInsertRows(parentIndex, row, row + pending.size() - 1);
+        for (Data* child : pending) {
+            child->parent = data;
+            data->children.insert(row++, child);
+        }
+        endInsertRows();
+        pending.clear();
+    };
+
+    for (const DB::CategoryItem* subCategory : data->item->mp_subcategories) {
+        if (row < data->children.size() && data->children[row]->item == subCategory) {
+            insertPending();
+            insertVisibleChildren(data->children[row], index(row, 0, parentIndex));
+            ++row;
+        } else if (isVisible(subCategory)) {
+            pending.append(new Data(subCategory->mp_name, subCategory));
+        }
+    }
+    insertPending();
+
+    if (!data->children.isEmpty()) {
+        // update the image and video counts of all children:
+        emit QAbstractItemModel::dataChanged(index(0, 1, parentIndex),
+                                             index(data->children.size() - 1, 2, parentIndex));
+    }
 }
 
 Browser::TreeCategoryModel::Data* Browser::TreeCategoryModel::indexToData(const QModelIndex& index) const
@@ -21,17 +21,14 @@
 
 // Local includes
 #include "AbstractCategoryModel.h"
+#include "DB/CategoryItem.h"
 #include "DB/MemberMap.h"
 
+#include <QHash>
+
 // Qt classes
 class QMimeData;
 
-namespace DB {
-
-class CategoryItem;
-
-}
-
 namespace Browser
 {
 
@@ -53,6 +50,11 @@ namespace Browser
  * this class was constructed, categories was added or removed, and the
  * class was asked information abouts its data.
  *
+ * The children of an item are only created when the view asks for them, and only
+ * items that have images or videos themselves or in any of their subcategories are shown.
+ * As the counts come in while the view is shown (see \ref AbstractCategoryModel), rows
+ * are inserted into the items that have been created already.
+ *
  * The drag and drop support is in some ways similar to the CategoryListView classes.
  * Any bugs there probably apply here as well and vice versa.
  */
@@ -88,15 +90,24 @@ public:
 signals:
     void dataChanged();
 
+protected:
+    void countsChanged() override;
+
 private: // Functions
     struct Data;
-    bool createData(DB::CategoryItem* parentCategoryItem, Data* parent);
+    void populate(Data* data) const;
+    bool isVisible(const DB::CategoryItem* item) const;
+    bool hasNoneChild(const Data* data) const;
+    void insertVisibleChildren(Data* data, const QModelIndex& parentIndex);
     Data* indexToData(const QModelIndex& index) const;
     TreeCategoryModel::tagData getDroppedTagData(QByteArray& encodedData);
 
 private: // Variables
     Data* m_data;
+    DB::CategoryItemPtr m_rootItem;
     DB::MemberMap m_memberMap;
+    // whether an item or any of its subcategories has images or videos; cleared when the counts change
+    mutable QHash<QString, bool> m_visible;
 };
 
 }
@@ -27,7 +27,7 @@ namespace DB
 class AndCategoryMatcher :public ContainerCategoryMatcher
 {
 public:
-    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) override;
+    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) const override;
     void debug( int level ) const override;
 };
 
@@ -27,6 +27,7 @@
 #include "DB/ImageDB.h"
 #include "DB/MemberMap.h"
 #include "CategoryItem.h"
+#include "CategoryImageCache.h"
 #include <QPixmap>
 #include <QIcon>
 #include <Utilities/Util.h>
@@ -135,19 +136,21 @@ QString DB::Category::defaultIconName() const
 QPixmap DB::Category::categoryImage( const QString& category, QString member, int width, int height ) const
 {
     QString fileName = fileForCategoryImage( category, member );
-    QString key = QString::fromLatin1( "%1-%2" ).arg(width).arg(fileName);
-    QPixmap res;
+    QPixmap res = CategoryImageCache::instance()->lookup( fileName, width, height );
+    if ( !res.isNull() )
+        return res;
+
+    const bool isGroup = DB::ImageDB::instance()->memberMap().isGroup( category, member );
+    // members without an image share the icon of their category:
+    QString key = QString::fromLatin1( "%1x%2-%3" ).arg(width).arg(height).arg( isGroup ? QString::fromLatin1("kuser") : iconName() );
     if ( QPixmapCache::find( key, res ) )
         return res;
 
     QImage img;
-    bool ok = img.load( fileName, "JPEG" );
-    if ( ! ok ) {
-        if ( DB::ImageDB::instance()->memberMap().isGroup( category, member ) )
-            img = KIconLoader::global()->loadIcon( QString::fromLatin1( "kuser" ), KIconLoader::Desktop, qMax(width,height) ).toImage();
-        else
-            img = icon( qMax(width,height) ).toImage();
-    }
+    if ( isGroup )
+        img = KIconLoader::global()->loadIcon( QString::fromLatin1( "kuser" ), KIconLoader::Desktop, qMax(width,height) ).toImage();
+    else
+        img = icon( qMax(width,height) ).toImage();
     res = QPixmap::fromImage( Utilities::scaleImage(img, width, height, Qt::KeepAspectRatio) );
 
     QPixmapCache::insert( key, res );
@@ -175,7 +178,7 @@ void DB::Category::setCategoryImage( const QString& category, QString member, co
         return;
     }
 
-    QPixmapCache::clear();
+    CategoryImageCache::instance()->invalidate( fileName );
 }
 
 QString DB::Category::fileForCategoryImage( const QString& category, QString member ) const
@@ -0,0 +1,62 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef CATEGORYCLASSIFICATION_H
+#define CATEGORYCLASSIFICATION_H
+
+#include "ImageInfo.h"
+
+#include <QMap>
+#include <QString>
+
+namespace DB
+{
+/**
+ * \brief The item counts of one category, as computed by ImageDB::classifyCategories.
+ *
+ * Images and videos are counted separately; each map has the same content that
+ * ImageDB::classify returns for the category with the respective media type.
+ */
+class CategoryClassification
+{
+public:
+    QMap<QString,uint> images;
+    QMap<QString,uint> videos;
+
+    /**
+     * @return the counts for all media types in \p typemask.
+     */
+    QMap<QString,uint> counts( MediaType typemask ) const
+    {
+        if ( typemask == Image )
+            return images;
+        if ( typemask == Video )
+            return videos;
+
+        // every file is either an image or a video, so the counts just add up:
+        QMap<QString,uint> result = images;
+        for ( auto it = videos.constBegin(); it != videos.constEnd(); ++it )
+            result[it.key()] += it.value();
+        return result;
+    }
+};
+
+}
+
+#endif /* CATEGORYCLASSIFICATION_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,56 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef CATEGORYCLASSIFIER_H
+#define CATEGORYCLASSIFIER_H
+
+#include "CategoryClassification.h"
+
+#include <QMap>
+#include <QString>
+
+namespace DB
+{
+/**
+ * \brief Counts the items of categories a part of the database at a time.
+ *
+ * A classifier is created by ImageDB::createClassifier. Calling countNext() repeatedly until it returns \c true
+ * yields the same result as ImageDB::classifyCategories, but allows the caller to show
+ * partial results and to keep the user interface responsive in between.
+ */
+class CategoryClassifier
+{
+public:
+    virtual ~CategoryClassifier() {}
+
+    /**
+     * @brief Count the next \p count files of the database.
+     * @return \c true when all files have been counted.
+     */
+    virtual bool countNext( int count ) = 0;
+    virtual bool isFinished() const = 0;
+    /**
+     * @return the counts of the files counted so far, in the format of ImageDB::classifyCategories.
+     */
+    virtual QMap<QString, CategoryClassification> result() const = 0;
+};
+
+}
+
+#endif /* CATEGORYCLASSIFIER_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
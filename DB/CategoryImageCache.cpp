@@ -0,0 +1,338 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "CategoryImageCache.h"
+#include "Logging.h"
+
+#include <Settings/SettingsData.h>
+#include <Utilities/Util.h>
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QSaveFile>
+#include <QTimer>
+
+namespace
+{
+constexpr quint32 PACK_MAGIC = 0x4b504349; // "KPCI"
+constexpr qint32 PACK_VERSION = 1;
+
+/**
+ * The standard sizes category images are stored at in the packed file.
+ * Requests for larger images load the image file directly.
+ */
+constexpr int BUCKETS[] = { 64, 128, 256, 512 };
+
+// in KiB, i.e. room for about 500 images at 128x128
+constexpr int PIXMAP_CACHE_COST = 32 * 1024;
+
+constexpr int SAVE_DELAY_MS = 5000;
+}
+
+DB::CategoryImageCache* DB::CategoryImageCache::s_instance = nullptr;
+
+DB::CategoryImageCache::CategoryImageCache()
+    : m_map( nullptr )
+    , m_dataStart( 0 )
+    , m_isDirty( false )
+    , m_saveTimer( new QTimer( this ) )
+    , m_pixmaps( PIXMAP_CACHE_COST )
+{
+    m_saveTimer->setSingleShot( true );
+    m_saveTimer->setInterval( SAVE_DELAY_MS );
+    connect( m_saveTimer, &QTimer::timeout, this, &CategoryImageCache::save );
+    load();
+}
+
+DB::CategoryImageCache::~CategoryImageCache()
+{
+    save();
+    unmap();
+}
+
+DB::CategoryImageCache* DB::CategoryImageCache::instance()
+{
+    if ( !s_instance )
+        s_instance = new CategoryImageCache;
+    return s_instance;
+}
+
+void DB::CategoryImageCache::deleteInstance()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+QPixmap DB::CategoryImageCache::lookup( const QString& fileName, int width, int height )
+{
+    const QString pixmapKey = QString::fromLatin1( "%1x%2:%3" ).arg( width ).arg( height ).arg( fileName );
+    if ( const QPixmap* cached = m_pixmaps.object( pixmapKey ) )
+        return *cached;
+
+    if ( !validate( fileName ) )
+        return QPixmap();
+
+    const int bucket = bucketFor( qMax( width, height ) );
+    QImage image;
+    if ( bucket == 0 )
+        image.load( fileName, "JPEG" );
+    else
+        image = scaledImage( fileName, bucket );
+    if ( image.isNull() ) {
+        m_missing.insert( fileName );
+        return QPixmap();
+    }
+
+    const QPixmap result = QPixmap::fromImage( Utilities::scaleImage( image, width, height, Qt::KeepAspectRatio ) );
+    m_pixmaps.insert( pixmapKey, new QPixmap( result ), qMax( 1, result.width() * result.height() * 4 / 1024 ) );
+    return result;
+}
+
+void DB::CategoryImageCache::invalidate( const QString& fileName )
+{
+    removeEntries( fileName );
+    m_validated.remove( fileName );
+    m_missing.remove( fileName );
+
+    const QString suffix = QChar::fromLatin1( ':' ) + fileName;
+    const QList<QString> keys = m_pixmaps.keys();
+    for ( const QString& key : keys ) {
+        if ( key.endsWith( suffix ) )
+            m_pixmaps.remove( key );
+    }
+}
+
+void DB::CategoryImageCache::save()
+{
+    m_saveTimer->stop();
+    if ( !m_isDirty )
+        return;
+
+    const QString fileName = packFileName();
+    QDir().mkpath( QFileInfo( fileName ).absolutePath() );
+    QSaveFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) ) {
+        qCWarning(DBLog) << "Unable to write category image cache" << fileName;
+        return;
+    }
+
+    // The data of packed entries still points into the mapping, so nothing is copied
+    // until it is written to the new file.
+    QList<QString> keys;
+    QList<QByteArray> blobs;
+    QList<PackedEntry> entries;
+    qint64 offset = 0;
+    const auto addEntry = [&]( const QString& key, const QByteArray& data, qint64 sourceTime, qint64 sourceSize ) {
+        keys.append( key );
+        blobs.append( data );
+        entries.append( PackedEntry { offset, data.size(), sourceTime, sourceSize } );
+        offset += data.size();
+    };
+    for ( auto it = m_packed.constBegin(); it != m_packed.constEnd(); ++it ) {
+        if ( !m_pending.contains( it.key() ) )
+            addEntry( it.key(), packedData( it.key() ), it.value().sourceTime, it.value().sourceSize );
+    }
+    for ( auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it )
+        addEntry( it.key(), it.value().data, it.value().sourceTime, it.value().sourceSize );
+
+    QDataStream stream( &file );
+    stream << PACK_MAGIC << PACK_VERSION << qint32( keys.size() );
+    for ( int i = 0; i < keys.size(); ++i ) {
+        const PackedEntry& entry = entries[i];
+        stream << keys[i] << entry.offset << qint32( entry.size ) << entry.sourceTime << entry.sourceSize;
+    }
+    for ( const QByteArray& data : blobs )
+        file.write( data );
+
+    if ( !file.commit() ) {
+        qCWarning(DBLog) << "Unable to write category image cache" << fileName;
+        return;
+    }
+
+    blobs.clear();
+    unmap();
+    m_pending.clear();
+    m_isDirty = false;
+    load();
+}
+
+QString DB::CategoryImageCache::packFileName()
+{
+    return Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1( ".thumbnails/categoryimages" );
+}
+
+QString DB::CategoryImageCache::packKey( const QString& fileName, int bucket )
+{
+    return QString::number( bucket ) + QChar::fromLatin1( ':' ) + fileName;
+}
+
+int DB::CategoryImageCache::bucketFor( int size )
+{
+    for ( int bucket : BUCKETS ) {
+        if ( size <= bucket )
+            return bucket;
+    }
+    return 0;
+}
+
+void DB::CategoryImageCache::load()
+{
+    m_packed.clear();
+    m_file.setFileName( packFileName() );
+    if ( !m_file.open( QIODevice::ReadOnly ) )
+        return;
+
+    const qint64 fileSize = m_file.size();
+    m_map = m_file.map( 0, fileSize );
+    if ( !m_map ) {
+        qCWarning(DBLog) << "Unable to map category image cache" << m_file.fileName();
+        m_file.close();
+        return;
+    }
+
+    QByteArray raw = QByteArray::fromRawData( reinterpret_cast<const char*>( m_map ), int( fileSize ) );
+    QBuffer buffer( &raw );
+    buffer.open( QIODevice::ReadOnly );
+    QDataStream stream( &buffer );
+
+    quint32 magic = 0;
+    qint32 version = 0;
+    qint32 count = 0;
+    stream >> magic >> version >> count;
+    if ( stream.status() != QDataStream::Ok || magic != PACK_MAGIC || version != PACK_VERSION ) {
+        qCDebug(DBLog) << "Ignoring category image cache with unknown format";
+        unmap();
+        return;
+    }
+
+    for ( int i = 0; i < count; ++i ) {
+        QString key;
+        PackedEntry entry;
+        qint32 size;
+        stream >> key >> entry.offset >> size >> entry.sourceTime >> entry.sourceSize;
+        entry.size = size;
+        m_packed.insert( key, entry );
+    }
+    m_dataStart = buffer.pos();
+
+    if ( stream.status() != QDataStream::Ok ) {
+        qCWarning(DBLog) << "Category image cache is truncated, ignoring it";
+        unmap();
+        return;
+    }
+    for ( auto it = m_packed.begin(); it != m_packed.end(); ) {
+        if ( it->offset < 0 || it->size < 0 || m_dataStart + it->offset + it->size > fileSize )
+            it = m_packed.erase( it );
+        else
+            ++it;
+    }
+}
+
+void DB::CategoryImageCache::unmap()
+{
+    if ( m_map )
+        m_file.unmap( const_cast<uchar*>( m_map ) );
+    m_map = nullptr;
+    m_file.close();
+    m_packed.clear();
+}
+
+bool DB::CategoryImageCache::validate( const QString& fileName )
+{
+    if ( m_validated.contains( fileName ) )
+        return true;
+    if ( m_missing.contains( fileName ) )
+        return false;
+
+    const QFileInfo fi( fileName );
+    if ( !fi.exists() ) {
+        m_missing.insert( fileName );
+        removeEntries( fileName );
+        return false;
+    }
+
+    const qint64 sourceTime = fi.lastModified().toMSecsSinceEpoch();
+    for ( int bucket : BUCKETS ) {
+        const QString key = packKey( fileName, bucket );
+        const auto packed = m_packed.constFind( key );
+        if ( packed != m_packed.constEnd() && ( packed->sourceTime != sourceTime || packed->sourceSize != fi.size() ) ) {
+            m_packed.remove( key );
+            m_isDirty = true;
+            m_saveTimer->start();
+        }
+    }
+    m_validated.insert( fileName );
+    return true;
+}
+
+QImage DB::CategoryImageCache::scaledImage( const QString& fileName, int bucket )
+{
+    const QString key = packKey( fileName, bucket );
+    const QByteArray data = packedData( key );
+    QImage image;
+    if ( !data.isNull() && image.loadFromData( data, "JPEG" ) )
+        return image;
+
+    if ( !image.load( fileName, "JPEG" ) )
+        return QImage();
+    if ( image.width() > bucket || image.height() > bucket )
+        image = Utilities::scaleImage( image, bucket, bucket, Qt::KeepAspectRatio );
+
+    PendingEntry entry;
+    QBuffer buffer( &entry.data );
+    buffer.open( QIODevice::WriteOnly );
+    image.save( &buffer, "JPEG" );
+    const QFileInfo fi( fileName );
+    entry.sourceTime = fi.lastModified().toMSecsSinceEpoch();
+    entry.sourceSize = fi.size();
+    m_pending.insert( key, entry );
+    m_isDirty = true;
+    m_saveTimer->start();
+    return image;
+}
+
+QByteArray DB::CategoryImageCache::packedData( const QString& key ) const
+{
+    const auto pending = m_pending.constFind( key );
+    if ( pending != m_pending.constEnd() )
+        return pending->data;
+
+    const auto packed = m_packed.constFind( key );
+    if ( packed == m_packed.constEnd() || !m_map )
+        return QByteArray();
+    return QByteArray::fromRawData( reinterpret_cast<const char*>( m_map + m_dataStart + packed->offset ), packed->size );
+}
+
+void DB::CategoryImageCache::removeEntries( const QString& fileName )
+{
+    bool removed = false;
+    for ( int bucket : BUCKETS ) {
+        const QString key = packKey( fileName, bucket );
+        removed |= ( m_packed.remove( key ) != 0 );
+        removed |= ( m_pending.remove( key ) != 0 );
+    }
+    if ( removed ) {
+        m_isDirty = true;
+        m_saveTimer->start();
+    }
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,124 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef DB_CATEGORYIMAGECACHE_H
+#define DB_CATEGORYIMAGECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QFile>
+#include <QHash>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QString>
+
+class QTimer;
+
+namespace DB
+{
+
+/**
+ * \brief Cache for the images of category members.
+ *
+ * Category images are stored as individual JPEG files in the CategoryImages directory.
+ * Loading and scaling them each time a member is shown is slow for categories with many members,
+ * so this cache keeps:
+ * - a pixmap for each recently used file and size (an LRU bounded by memory usage), and
+ * - one packed file (<tt>.thumbnails/categoryimages</tt>) with every category image pre-scaled to a
+ *   few standard sizes. The packed file is memory mapped, so looking up an image does not read the
+ *   individual image files at all.
+ *
+ * Entries of the packed file record the modification time and size of the image they were created from,
+ * and are checked against the image file once per session.
+ * Changing an image through DB::Category::setCategoryImage() invalidates its entries immediately.
+ *
+ * The cache must only be used from the GUI thread.
+ */
+class CategoryImageCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CategoryImageCache* instance();
+    static void deleteInstance();
+
+    /**
+     * @return the image stored in \p fileName scaled to fit into \p width x \p height,
+     * or a null pixmap if there is no such image.
+     */
+    QPixmap lookup( const QString& fileName, int width, int height );
+
+    /**
+     * @brief Forget everything cached for \p fileName.
+     * Call this whenever the image file is written, moved or removed.
+     */
+    void invalidate( const QString& fileName );
+
+public slots:
+    /**
+     * @brief Write the packed file if it contains images that are not saved yet.
+     */
+    void save();
+
+private:
+    CategoryImageCache();
+    ~CategoryImageCache() override;
+
+    struct PackedEntry {
+        qint64 offset;
+        int size;
+        qint64 sourceTime;
+        qint64 sourceSize;
+    };
+    struct PendingEntry {
+        QByteArray data;
+        qint64 sourceTime;
+        qint64 sourceSize;
+    };
+
+    static QString packFileName();
+    static QString packKey( const QString& fileName, int bucket );
+    static int bucketFor( int size );
+
+    void load();
+    void unmap();
+    bool validate( const QString& fileName );
+    QImage scaledImage( const QString& fileName, int bucket );
+    QByteArray packedData( const QString& key ) const;
+    void removeEntries( const QString& fileName );
+
+    static CategoryImageCache* s_instance;
+
+    QFile m_file;
+    const uchar* m_map;
+    qint64 m_dataStart;
+    QHash<QString, PackedEntry> m_packed;
+    QHash<QString, PendingEntry> m_pending;
+    bool m_isDirty;
+    QTimer* m_saveTimer;
+
+    QSet<QString> m_validated;
+    QSet<QString> m_missing;
+    QCache<QString, QPixmap> m_pixmaps;
+};
+
+}
+
+#endif /* DB_CATEGORYIMAGECACHE_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -41,6 +41,10 @@ using Utilities::StringSet;
    however, is rather expensive, so this collection is only turned on in
    that case.
 
+   Evaluating a matcher does not change it, only alreadyMatched. The matchers
+   of a search may therefore be evaluated by several threads at once, as long
+   as every thread passes its own alreadyMatched.
+
 */
 class CategoryMatcher
 {
@@ -49,7 +53,7 @@ public:
     virtual ~CategoryMatcher() {}
     virtual void debug( int level ) const = 0;
 
-    virtual bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) = 0;
+    virtual bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) const = 0;
     virtual void setShouldCreateMatchedSet(bool);
 
 protected:
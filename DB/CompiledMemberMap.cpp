@@ -0,0 +1,173 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "CompiledMemberMap.h"
+
+DB::CompiledMemberMap::CompiledMemberMap( const QMap<QString,StringSet>& groupMap, int version )
+    : m_version( version )
+    , m_groupCount( groupMap.size() )
+{
+    // Groups first, so their ids can be used as index into m_closure.
+    for ( auto groupIt = groupMap.constBegin(); groupIt != groupMap.constEnd(); ++groupIt )
+        addName( groupIt.key() );
+
+    QVector<QVector<int>> directMembers( m_groupCount );
+    for ( auto groupIt = groupMap.constBegin(); groupIt != groupMap.constEnd(); ++groupIt ) {
+        const int groupId = m_ids[groupIt.key()];
+        for ( const QString& member : groupIt.value() )
+            directMembers[groupId].append( addName( member ) );
+    }
+
+    m_parents.resize( count() );
+    for ( int groupId = 0; groupId < m_groupCount; ++groupId ) {
+        for ( int memberId : directMembers[groupId] )
+            m_parents[memberId].append( groupId );
+    }
+
+    m_closure.resize( m_groupCount );
+    QVector<char> state( m_groupCount, 0 );
+    for ( int groupId = 0; groupId < m_groupCount; ++groupId )
+        computeClosure( groupId, directMembers, state );
+
+    m_ancestors.resize( count() );
+    for ( int groupId = 0; groupId < m_groupCount; ++groupId ) {
+        const QBitArray& closure = m_closure[groupId];
+        for ( int memberId = 0; memberId < closure.size(); ++memberId ) {
+            if ( closure.testBit( memberId ) )
+                m_ancestors[memberId].append( groupId );
+        }
+    }
+}
+
+bool DB::CompiledMemberMap::contains( int groupId, int memberId ) const
+{
+    if ( !isGroup( groupId ) || memberId < 0 )
+        return false;
+    const QBitArray& closure = m_closure[groupId];
+    return memberId < closure.size() && closure.testBit( memberId );
+}
+
+bool DB::CompiledMemberMap::hasPath( const QString& from, const QString& to ) const
+{
+    if ( from == to )
+        return true;
+    return contains( id( from ), id( to ) );
+}
+
+StringSet DB::CompiledMemberMap::members( const QString& group ) const
+{
+    const int groupId = id( group );
+    if ( !isGroup( groupId ) )
+        return StringSet();
+    return names( m_closure[groupId] );
+}
+
+QMap<QString,StringSet> DB::CompiledMemberMap::closureMap() const
+{
+    QMap<QString,StringSet> result;
+    for ( int groupId = 0; groupId < m_groupCount; ++groupId )
+        result.insert( m_names[groupId], names( m_closure[groupId] ) );
+    return result;
+}
+
+DB::CompiledMemberMap* DB::CompiledMemberMap::withMember( const QString& group, const QString& item, int version ) const
+{
+    const int groupId = id( group );
+    if ( !isGroup( groupId ) )
+        return nullptr;
+
+    // The bit arrays and vectors are implicitly shared, so only the ones changed below are copied.
+    CompiledMemberMap* result = new CompiledMemberMap( *this );
+    result->m_version = version;
+    const int itemId = result->addName( item );
+    if ( itemId == result->m_parents.size() ) {
+        result->m_parents.append( QVector<int>() );
+        result->m_ancestors.append( QVector<int>() );
+    }
+    if ( !result->m_parents[itemId].contains( groupId ) )
+        result->m_parents[itemId].append( groupId );
+
+    // The item, and the members of it if it is a group, are now in the group and all groups containing it.
+    QBitArray added( result->count() );
+    added.setBit( itemId );
+    if ( isGroup( itemId ) )
+        added |= m_closure[itemId];
+    QVector<int> groups = m_ancestors[groupId];
+    groups.append( groupId );
+
+    for ( int id : groups )
+        result->m_closure[id] |= added;
+    for ( int memberId = 0; memberId < added.size(); ++memberId ) {
+        if ( !added.testBit( memberId ) )
+            continue;
+        QVector<int>& ancestors = result->m_ancestors[memberId];
+        for ( int id : groups ) {
+            if ( !ancestors.contains( id ) )
+                ancestors.append( id );
+        }
+    }
+    return result;
+}
+
+int DB::CompiledMemberMap::addName( const QString& name )
+{
+    const auto it = m_ids.constFind( name );
+    if ( it != m_ids.constEnd() )
+        return it.value();
+
+    const int id = m_names.size();
+    m_names.append( name );
+    m_ids.insert( name, id );
+    return id;
+}
+
+/**
+ * state is 0 for groups not visited yet, 1 while computing the closure of the group, and 2 when done.
+ * Cycles should not exist, but if they do, a group in progress counts as empty, like MemberMap always did.
+ */
+void DB::CompiledMemberMap::computeClosure( int groupId, const QVector<QVector<int>>& directMembers, QVector<char>& state )
+{
+    if ( state[groupId] != 0 )
+        return;
+    state[groupId] = 1;
+
+    QBitArray closure( count() );
+    for ( int memberId : directMembers[groupId] ) {
+        closure.setBit( memberId );
+        if ( isGroup( memberId ) ) {
+            computeClosure( memberId, directMembers, state );
+            if ( !m_closure[memberId].isEmpty() )
+                closure |= m_closure[memberId];
+        }
+    }
+
+    m_closure[groupId] = closure;
+    state[groupId] = 2;
+}
+
+StringSet DB::CompiledMemberMap::names( const QBitArray& bits ) const
+{
+    StringSet result;
+    for ( int id = 0; id < bits.size(); ++id ) {
+        if ( bits.testBit( id ) )
+            result.insert( m_names[id] );
+    }
+    return result;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
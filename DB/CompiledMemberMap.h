@@ -0,0 +1,111 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef COMPILEDMEMBERMAP_H
+#define COMPILEDMEMBERMAP_H
+
+#include "Utilities/StringSet.h"
+
+#include <QBitArray>
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace DB
+{
+using Utilities::StringSet;
+
+/**
+ * \brief Precomputed, immutable form of the member groups of one category.
+ *
+ * Every item that is a group or a member of a group gets an integer id. Groups get the ids
+ * 0 to groupCount()-1. The following is computed once:
+ * \li For each group, the closure of its members is stored as a bit array indexed by id.
+ * \li For each item, the groups containing it directly (parents()) are stored.
+ * \li For each item, the groups containing it directly or through subgroups (ancestors()) are stored.
+ *
+ * Instances are created by MemberMap::compiled(), and are shared until the member map changes.
+ * Since they are never modified, they can be used from any thread. Adding a member to a group
+ * creates an updated copy with withMember(), which only recomputes what the new member changes.
+ */
+class CompiledMemberMap
+{
+public:
+    CompiledMemberMap( const QMap<QString,StringSet>& groupMap, int version );
+
+    /**
+     * @return the version of the MemberMap this was compiled from.
+     */
+    int version() const { return m_version; }
+
+    /**
+     * @return the id of \p name, or -1 if it is neither a group nor a member of a group.
+     */
+    int id( const QString& name ) const { return m_ids.value( name, -1 ); }
+    QString name( int id ) const { return m_names[id]; }
+    int count() const { return m_names.size(); }
+    int groupCount() const { return m_groupCount; }
+    bool isGroup( int id ) const { return id >= 0 && id < m_groupCount; }
+
+    /**
+     * @return \c true if \p memberId is in the group \p groupId, directly or through subgroups.
+     */
+    bool contains( int groupId, int memberId ) const;
+    /**
+     * @return \c true if \p to is \p from, or is in the group \p from (see MemberMap::hasPath).
+     */
+    bool hasPath( const QString& from, const QString& to ) const;
+    const QVector<int>& parents( int id ) const { return m_parents[id]; }
+    const QVector<int>& ancestors( int id ) const { return m_ancestors[id]; }
+
+    /**
+     * @return all members of \p group, including the members of its subgroups.
+     */
+    StringSet members( const QString& group ) const;
+    /**
+     * @return a map from each group to all its members, including the members of its subgroups.
+     */
+    QMap<QString,StringSet> closureMap() const;
+
+    /**
+     * @return a copy with \p item added to \p group, compiled for \p version,
+     * or a null pointer if \p group is not a group yet, which needs a full compilation.
+     * Adding the member must not create a cycle.
+     */
+    CompiledMemberMap* withMember( const QString& group, const QString& item, int version ) const;
+
+private:
+    int addName( const QString& name );
+    void computeClosure( int groupId, const QVector<QVector<int>>& directMembers, QVector<char>& state );
+    StringSet names( const QBitArray& bits ) const;
+
+    int m_version;
+    QStringList m_names;
+    QHash<QString,int> m_ids;
+    int m_groupCount;
+    QVector<QBitArray> m_closure;
+    QVector<QVector<int>> m_parents;
+    QVector<QVector<int>> m_ancestors;
+};
+
+}
+
+#endif /* COMPILEDMEMBERMAP_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
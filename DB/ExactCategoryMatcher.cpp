@@ -41,7 +41,12 @@ void DB::ExactCategoryMatcher::setMatcher( CategoryMatcher* subMatcher )
         m_matcher->setShouldCreateMatchedSet( true );
 }
 
-bool DB::ExactCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched)
+DB::CategoryMatcher* DB::ExactCategoryMatcher::matcher() const
+{
+    return m_matcher;
+}
+
+bool DB::ExactCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched) const
 {
     // it makes no sense to put one ExactCategoryMatcher into another, so we ignore alreadyMatched.
     Q_UNUSED( alreadyMatched );
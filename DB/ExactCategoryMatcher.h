@@ -45,7 +45,8 @@ public:
     explicit ExactCategoryMatcher( const QString category );
     virtual ~ExactCategoryMatcher();
     void setMatcher( CategoryMatcher * subMatcher );
-    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) override;
+    CategoryMatcher* matcher() const;
+    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) const override;
     void debug( int level ) const override;
     /// shouldCreateMatchedSet is _always_ set for the sub-matcher of ExactCategoryMatcher.
     void setShouldCreateMatchedSet(bool) override;
@@ -19,6 +19,7 @@
 
 #include "FileName.h"
 #include "ImageDB.h"
+#include "PathTrie.h"
 
 #include <DB/ImageInfoList.h>
 #include <Utilities/Util.h>
@@ -27,7 +28,12 @@
 #include <QFile>
 
 DB::FileName::FileName()
-    : m_isNull(true)
+    : m_id( 0 )
+{
+}
+
+DB::FileName::FileName( quint32 id )
+    : m_id( id )
 {
 }
 
@@ -37,43 +43,36 @@ DB::FileName DB::FileName::fromAbsolutePath(const QString &fileName)
     if (!fileName.startsWith(imageRoot))
         return FileName();
 
-    FileName res;
-    res.m_isNull = false;
-    res.m_absoluteFilePath = fileName;
-    res.m_relativePath = fileName.mid(imageRoot.length());
-    return res;
+    return FileName( PathTrie::instance()->intern( fileName.mid(imageRoot.length()) ) );
 }
 
 DB::FileName DB::FileName::fromRelativePath(const QString &fileName)
 {
     Q_ASSERT(!fileName.startsWith(QChar::fromLatin1('/')));
-    FileName res;
-    res.m_isNull = false;
-    res.m_relativePath = fileName;
-    res.m_absoluteFilePath = Utilities::stripEndingForwardSlash( Settings::SettingsData::instance()->imageDirectory() ) + QLatin1String("/") + fileName;
-    return res;
+    return FileName( PathTrie::instance()->intern( fileName ) );
 }
 
 QString DB::FileName::absolute() const
 {
     Q_ASSERT(!isNull());
-    return m_absoluteFilePath;
+    // the image directory always ends with a slash:
+    return PathTrie::instance()->path( m_id, Settings::SettingsData::instance()->imageDirectory() );
 }
 
 QString DB::FileName::relative() const
 {
-    Q_ASSERT(!m_isNull);
-    return m_relativePath;
+    Q_ASSERT(!isNull());
+    return PathTrie::instance()->path( m_id );
 }
 
 bool DB::FileName::isNull() const
 {
-    return m_isNull;
+    return m_id == 0;
 }
 
 bool DB::FileName::operator ==(const DB::FileName &other) const
 {
-    return m_isNull == other.m_isNull && m_relativePath == other.m_relativePath;
+    return m_id == other.m_id;
 }
 
 bool DB::FileName::operator !=(const DB::FileName &other) const
@@ -83,7 +82,7 @@ bool DB::FileName::operator !=(const DB::FileName &other) const
 
 bool DB::FileName::operator <(const DB::FileName &other) const
 {
-    return relative() < other.relative();
+    return m_id != other.m_id && PathTrie::instance()->compare( m_id, other.m_id ) < 0;
 }
 
 bool DB::FileName::exists() const
@@ -95,9 +94,4 @@ DB::ImageInfoPtr DB::FileName::info() const
 {
     return ImageDB::instance()->info(*this);
 }
-
-uint DB::qHash( const DB::FileName& fileName )
-{
-    return qHash(fileName.relative());
-}
 // vi:expandtab:tabstop=4 shiftwidth=4:
@@ -28,6 +28,12 @@
 namespace DB
 {
 
+/**
+ * \brief The name of a file in the image directory.
+ *
+ * A FileName is only the number of its path in the PathTrie, so copying, comparing and hashing
+ * one is as cheap as for an integer. The paths are put together when they are asked for.
+ */
 class FileName
 {
 public:
@@ -42,19 +48,22 @@ public:
     bool operator<( const FileName& other ) const;
     bool exists() const;
     ImageInfoPtr info() const;
+    /**
+     * @return the number of the file in the PathTrie, which is 0 for a null FileName.
+     */
+    quint32 id() const { return m_id; }
 
 private:
-    // During previous profilation it showed that converting between absolute and relative took quite some time,
-    // so to avoid that, I store both.
-    QString m_relativePath;
-    QString m_absoluteFilePath;
-    bool m_isNull;
+    explicit FileName( quint32 id );
+
+    quint32 m_id;
 };
 
-uint qHash( const DB::FileName& fileName );
+inline uint qHash( const DB::FileName& fileName ) { return ::qHash( fileName.id() ); }
 typedef QSet<DB::FileName> FileNameSet;
 }
 
+Q_DECLARE_TYPEINFO(DB::FileName, Q_PRIMITIVE_TYPE);
 Q_DECLARE_METATYPE(DB::FileName)
 
 
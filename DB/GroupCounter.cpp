@@ -31,8 +31,8 @@ using namespace DB;
  * categorizing. The class is instantiating with the category we currently
  * are counting items for.
  *
- * The class builds the inverse member map, that is a map pointing from items
- * to parent.
+ * The class uses the inverse member map, that is a map pointing from items
+ * to the groups containing them, directly or through subgroups.
  *
  * As an example, imagine we have the following member map (stored in the
  * variable groupToMemberMap in  the code):
@@ -41,35 +41,22 @@ using namespace DB;
  *      California |-> [Santa Clara, Los Angeles] }
  * \endcode
  *
- * The inverse map (stored in m_memberToGroup in the code ) will then look
+ * The inverse map (see DB::CompiledMemberMap::ancestors) will then look
  * like this:
  * \code
  *  { Chicago |-> [USA],
  *    Sanata Clara |-> [ USA, California ],
  *    Los Angeless |-> [ California ] }
  * \endcode
+ *
+ * The inverse map is shared with the member map, so it is only computed when the member map changes.
  */
 GroupCounter::GroupCounter( const QString& category )
+    : m_map( DB::ImageDB::instance()->memberMap().compiled( category ) )
+    , m_groupCount( m_map->groupCount(), 0 )
+    , m_lastCountedImage( m_map->groupCount(), 0 )
+    , m_image( 0 )
 {
-    const MemberMap map = DB::ImageDB::instance()->memberMap();
-    QMap<QString,StringSet> groupToMemberMap = map.groupMap(category);
-
-    m_memberToGroup.reserve( 2729 /* A large prime */ );
-    m_groupCount.reserve( 2729 /* A large prime */ );
-
-    // Populate the m_memberToGroup map
-    for( QMap<QString,StringSet>::Iterator groupToMemberIt= groupToMemberMap.begin()
-         ; groupToMemberIt != groupToMemberMap.end()
-         ; ++groupToMemberIt )
-    {
-        StringSet members = groupToMemberIt.value();
-        QString group = groupToMemberIt.key();
-
-        Q_FOREACH( const auto &member, members ) {
-            m_memberToGroup[member].append( group );
-        }
-        m_groupCount.insert( group, 0 );
-    }
 }
 
 /**
@@ -77,39 +64,49 @@ GroupCounter::GroupCounter( const QString& category )
  * category in question is Places.
  * This function then increases m_groupCount with 1 for each of the groups the relavant items belongs to
  * Las Vegas might increase the m_groupCount[Nevada] by one.
- * The tricky part is to avoid increasing it by more than 1 per image, that is what the countedGroupDict is
+ * The tricky part is to avoid increasing it by more than 1 per image, that is what m_lastCountedImage is
  * used for.
  */
 void GroupCounter::count( const StringSet& categories )
 {
-    static StringSet countedGroupDict;
+    ++m_image;
+    const auto countGroup = [this]( int groupId ) {
+        if ( m_lastCountedImage[groupId] != m_image ) {
+            m_lastCountedImage[groupId] = m_image;
+            ++m_groupCount[groupId];
+        }
+    };
 
-    countedGroupDict.clear();
     for( StringSet::const_iterator categoryIt = categories.begin(); categoryIt != categories.end(); ++categoryIt ) {
-        if ( m_memberToGroup.contains(*categoryIt)) {
-            const QStringList groups = m_memberToGroup[*categoryIt];
-            for ( const QString& group : groups ) {
-                if ( !countedGroupDict.contains( group ) ) {
-                    countedGroupDict.insert( group );
-                    (m_groupCount[group])++;
-                }
-            }
-        }
+        const int id = m_map->id( *categoryIt );
+        if ( id < 0 )
+            continue;
+        for ( int groupId : m_map->ancestors( id ) )
+            countGroup( groupId );
         // The item Nevada should itself go into the group Nevada.
-        if ( !countedGroupDict.contains( *categoryIt ) && m_groupCount.contains( *categoryIt ) ) {
-             countedGroupDict.insert( *categoryIt);
-             (m_groupCount[*categoryIt])++;
-        }
+        if ( m_map->isGroup( id ) )
+            countGroup( id );
     }
 }
 
-QMap<QString,uint> GroupCounter::result()
+/**
+ * Add the counts of \p other, which must be a counter for the same category that counted other images.
+ * This is used to merge the counts of several threads.
+ */
+void GroupCounter::merge( const GroupCounter& other )
+{
+    Q_ASSERT( other.m_map == m_map );
+    for ( int groupId = 0; groupId < m_groupCount.size(); ++groupId )
+        m_groupCount[groupId] += other.m_groupCount[groupId];
+}
+
+QMap<QString,uint> GroupCounter::result() const
 {
     QMap<QString,uint> res;
 
-    for( QHash<QString,uint>::const_iterator it = m_groupCount.constBegin(); it != m_groupCount.constEnd(); ++it) {
-        if ( it.value() != 0 )
-            res.insert( it.key(), it.value() );
+    for ( int groupId = 0; groupId < m_groupCount.size(); ++groupId ) {
+        if ( m_groupCount[groupId] != 0 )
+            res.insert( m_map->name( groupId ), m_groupCount[groupId] );
     }
     return res;
 }
@@ -19,7 +19,9 @@
 #ifndef GROUPCOUNTER_H
 #define GROUPCOUNTER_H
 #include "Settings/SettingsData.h"
-#include <QHash>
+#include "CompiledMemberMap.h"
+#include <QSharedPointer>
+#include <QVector>
 
 namespace DB
 {
@@ -30,12 +32,15 @@ class GroupCounter
 public:
     explicit GroupCounter( const QString& category );
     void count(const StringSet& );
-    QMap<QString,uint> result();
+    void merge( const GroupCounter& other );
+    QMap<QString,uint> result() const;
 
 private:
-    QHash<QString,QStringList> m_memberToGroup;
-    QHash<QString,uint> m_groupCount;
-
+    QSharedPointer<const CompiledMemberMap> m_map;
+    // indexed by group id:
+    QVector<uint> m_groupCount;
+    QVector<uint> m_lastCountedImage;
+    uint m_image;
 };
 
 }
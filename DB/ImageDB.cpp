@@ -26,6 +26,7 @@
 #include <DB/MediaCount.h>
 #include <QProgressDialog>
 #include <DB/FileName.h>
+#include <DB/ImageSearchInfo.h>
 
 using namespace DB;
 
@@ -138,6 +139,74 @@ DB::MediaCount ImageDB::count( const ImageSearchInfo& searchInfo )
     return MediaCount( images, videos );
 }
 
+bool ImageDB::hasMatches( const ImageSearchInfo& info )
+{
+    return count( info ).total() != 0;
+}
+
+QMap<QString, CategoryClassification> ImageDB::classifyCategories( const ImageSearchInfo& info, const QStringList& categories )
+{
+    QMap<QString, CategoryClassification> result;
+    for ( const QString& category : categories ) {
+        CategoryClassification& classification = result[category];
+        classification.images = classify( info, category, Image );
+        classification.videos = classify( info, category, Video );
+    }
+    return result;
+}
+
+namespace
+{
+/**
+ * Classifier for databases without an incremental implementation, which counts everything at once.
+ */
+class CompleteClassifier : public CategoryClassifier
+{
+public:
+    CompleteClassifier( ImageDB* db, const ImageSearchInfo& info, const QStringList& categories )
+        : m_db( db ), m_info( info ), m_categories( categories ), m_finished( false )
+    {}
+
+    bool countNext( int ) override
+    {
+        if ( !m_finished ) {
+            m_result = m_db->classifyCategories( m_info, m_categories );
+            m_finished = true;
+        }
+        return true;
+    }
+    bool isFinished() const override { return m_finished; }
+    QMap<QString, CategoryClassification> result() const override { return m_result; }
+
+private:
+    ImageDB* m_db;
+    ImageSearchInfo m_info;
+    QStringList m_categories;
+    bool m_finished;
+    QMap<QString, CategoryClassification> m_result;
+};
+}
+
+std::unique_ptr<CategoryClassifier> ImageDB::createClassifier( const ImageSearchInfo& info, const QStringList& categories )
+{
+    return std::unique_ptr<CategoryClassifier>( new CompleteClassifier( this, info, categories ) );
+}
+
+DB::FileNameList ImageDB::searchStackTops( const ImageSearchInfo& searchInfo, MediaType typemask, int* position, int maxCount )
+{
+    // position counts the matches of search(), which has to be run for each page
+    const DB::FileNameList matches = search(searchInfo);
+    DB::FileNameList result;
+    int index = *position;
+    for ( ; index < matches.size() && result.size() < maxCount; ++index ) {
+        const DB::ImageInfoPtr imageInfo = info(matches.at(index));
+        if ( imageInfo->stackOrder() <= 1 && ( imageInfo->mediaType() & typemask ) )
+            result.append( matches.at(index) );
+    }
+    *position = ( index < matches.size() ) ? index : -1;
+    return result;
+}
+
 void ImageDB::slotReread( const DB::FileNameList& list, DB::ExifMode mode)
 {
 // Do here a reread of the exif info and change the info correctly in the database without loss of previous added data
@@ -21,10 +21,14 @@
 
 #include <QObject>
 
+#include <memory>
+
 #include <DB/FileNameList.h>
 #include <DB/ImageInfoList.h>
 #include <DB/ImageInfoPtr.h>
 #include <DB/MediaCount.h>
+#include <DB/CategoryClassification.h>
+#include <DB/CategoryClassifier.h>
 #include <DB/ImageDateCollection.h>
 
 class QProgressBar;
@@ -73,6 +77,34 @@ public:
     static QString NONE();
     DB::FileNameList currentScope(bool requireOnDisk) const;
 
+    /**
+     * @return \c true if at least one image or video matches \p info.
+     * This is cheaper than checking count(), as it stops at the first match.
+     */
+    virtual bool hasMatches( const ImageSearchInfo& info );
+    /**
+     * @return the files matching \p info and \p typemask, leaving out all images of a stack except its top.
+     * Unlike search(), this never checks whether the files exist on disk.
+     *
+     * The search stops once \p maxCount files are found, so a long result can be fetched page by page.
+     * \p position tells where to start, 0 being the first image of the database. It is set to where the
+     * next page starts, or to -1 when there are no more files. Images added or deleted between two pages
+     * may be missed or returned twice.
+     */
+    virtual DB::FileNameList searchStackTops( const ImageSearchInfo& info, MediaType typemask, int* position, int maxCount );
+    /**
+     * @brief Classify several categories at once.
+     * The result maps each of the \p categories to its counts; for each of them, it contains
+     * what classify() would return for images and videos.
+     * Implementations should make only a single pass over the matching images.
+     */
+    virtual QMap<QString, CategoryClassification> classifyCategories( const ImageSearchInfo& info, const QStringList& categories );
+    /**
+     * @brief Create a classifier computing what classifyCategories() returns a part of the database at a time.
+     * Files added to or removed from the database while the classifier is used may or may not be counted.
+     */
+    virtual std::unique_ptr<CategoryClassifier> createClassifier( const ImageSearchInfo& info, const QStringList& categories );
+
     virtual DB::FileName findFirstItemInRange(
         const FileNameList& images,
         const ImageDate& range,
@@ -106,6 +138,28 @@ public: // Methods that must be overridden
     virtual ImageInfoPtr info( const DB::FileName& fileName ) const = 0;
     virtual MemberMap& memberMap() = 0;
     virtual void save( const QString& fileName, bool isAutoSave ) = 0;
+    /**
+     * @brief Save the database without blocking the GUI.
+     * The state of the database at the time of the call is saved, while the file is written on a worker thread.
+     * Changes made in the meantime go into the next save. Saves are written in the order they were requested.
+     *
+     * saveProgress() is emitted while the file is written, and saveFinished() when it is done.
+     */
+    virtual void saveInBackground( const QString& fileName, bool isAutoSave ) = 0;
+    /**
+     * @brief Block until all saves started by saveInBackground() are written, and saveFinished() was emitted for them.
+     */
+    virtual void waitForSaves() = 0;
+    /**
+     * @brief Save the changes since the last save so that they can be recovered, without writing index.xml.
+     * Like saveInBackground(), saveFinished() is emitted when done.
+     * @return \c false if this is not possible right now, and should be tried again later.
+     */
+    virtual bool autoSave() = 0;
+    /**
+     * @brief Remove what autoSave() wrote, as the changes since the last save are not wanted.
+     */
+    virtual void discardAutoSave() = 0;
     virtual MD5Map* md5Map() = 0;
     virtual void sortAndMergeBackIn(const DB::FileNameList& list) = 0;
 
@@ -146,6 +200,17 @@ public: // Methods that must be overridden
      * */
     virtual void unstack(const DB::FileNameList& images) = 0;
 
+    /** @short Create several stacks at once
+     *
+     * Every list in \p groups is stacked as if by stack(). If \p unstackFirst is
+     * \c true, the images of a group are taken out of their current stacks first.
+     *
+     * Unlike calling stack() for every group, the database is marked dirty only once.
+     *
+     * @return the number of images that were added to a stack.
+     * */
+    virtual int stackAll(const QList<DB::FileNameList>& groups, bool unstackFirst) = 0;
+
     /** @short Return a list of images which are in the same stack as the one specified.
      *
      * Returns an empty list when the image is not stacked.
@@ -153,6 +218,10 @@ public: // Methods that must be overridden
      * They are returned sorted according to their stackOrder.
      * */
     virtual DB::FileNameList getStackFor(const DB::FileName& referenceId) const = 0;
+    /**
+     * @return the id of the stack \p fileName is in, or 0 if it is not stacked.
+     */
+    virtual DB::StackID getStackId(const DB::FileName& fileName) const = 0;
 
     virtual void copyData( const DB::FileName& from, const DB::FileName& to) = 0;
 protected slots:
@@ -163,6 +232,8 @@ signals:
     void totalChanged( uint );
     void dirty();
     void imagesDeleted( const DB::FileNameList& );
+    void saveProgress( int percent );
+    void saveFinished( bool isAutoSave, bool success );
 };
 
 }
@@ -94,7 +94,7 @@ void ImageInfo::delaySavingChanges(bool b)
 void ImageInfo::setLabel( const QString& desc )
 {
     if (desc != m_label)
-        m_dirty = true;
+        markDirty();
     m_label = desc;
     saveChangesIfNotDelayed();
 }
@@ -107,7 +107,7 @@ QString ImageInfo::label() const
 void ImageInfo::setDescription( const QString& desc )
 {
     if (desc != m_description)
-        m_dirty = true;
+        markDirty();
     m_description = desc.trimmed();
     saveChangesIfNotDelayed();
 }
@@ -121,7 +121,7 @@ QString ImageInfo::description() const
 void ImageInfo::setCategoryInfo( const QString& key, const StringSet& value )
 {
     // Don't check if really changed, because it's too slow.
-    m_dirty = true;
+    markDirty();
     m_categoryInfomation[key] = value;
     saveChangesIfNotDelayed();
 }
@@ -155,7 +155,7 @@ void ImageInfo::renameItem( const QString& category, const QString& oldValue, co
     StringSet& set = m_categoryInfomation[category];
     StringSet::iterator it = set.find( oldValue );
     if ( it != set.end() ) {
-        m_dirty = true;
+        markDirty();
         set.erase( it );
         set.insert( newValue );
         saveChangesIfNotDelayed();
@@ -170,7 +170,7 @@ DB::FileName ImageInfo::fileName() const
 void ImageInfo::setFileName( const DB::FileName& fileName )
 {
     if (fileName != m_fileName)
-        m_dirty = true;
+        markDirty();
     m_fileName = fileName;
 
     m_imageOnDisk = Unchecked;
@@ -193,7 +193,7 @@ void ImageInfo::rotate( int degrees, RotationMode mode )
     if ( degrees == 0 )
         return;
 
-    m_dirty = true;
+    markDirty();
     m_angle = ( m_angle + degrees ) % 360;
 
     if (degrees == 90 || degrees == 270) {
@@ -260,7 +260,7 @@ int ImageInfo::angle() const
 void ImageInfo::setAngle( int angle )
 {
     if (angle != m_angle)
-        m_dirty = true;
+        markDirty();
     m_angle = angle;
     saveChangesIfNotDelayed();
 }
@@ -282,6 +282,7 @@ void ImageInfo::setRating( short rating )
         m_dirty = true;
 
     m_rating = rating;
+    notifyObserver();
     saveChangesIfNotDelayed();
 }
 
@@ -295,6 +296,7 @@ void ImageInfo::setStackId( const DB::StackID stackId )
     if ( stackId != m_stackId )
         m_dirty = true;
     m_stackId = stackId;
+    notifyObserver();
     saveChangesIfNotDelayed();
 }
 
@@ -308,17 +310,26 @@ void ImageInfo::setStackOrder( const unsigned int stackOrder )
     if ( stackOrder != m_stackOrder )
         m_dirty = true;
     m_stackOrder = stackOrder;
+    notifyObserver();
     saveChangesIfNotDelayed();
 }
 
 void ImageInfo::setVideoLength(int length)
 {
     if ( m_videoLength != length )
-        m_dirty = true;
+        markDirty();
     m_videoLength = length;
     saveChangesIfNotDelayed();
 }
 
+void ImageInfo::setPerceptualHash( quint64 hash )
+{
+    if ( m_perceptualHash != hash )
+        markDirty();
+    m_perceptualHash = hash;
+    saveChangesIfNotDelayed();
+}
+
 int ImageInfo::videoLength() const
 {
     return m_videoLength;
@@ -329,6 +340,7 @@ void ImageInfo::setDate( const ImageDate& date )
     if (date != m_date)
         m_dirty = true;
     m_date = date;
+    notifyObserver();
     saveChangesIfNotDelayed();
 }
 
@@ -370,7 +382,7 @@ bool ImageInfo::operator==( const ImageInfo& other ) const
 
 void ImageInfo::renameCategory( const QString& oldName, const QString& newName )
 {
-    m_dirty = true;
+    markDirty();
 
     m_categoryInfomation[newName] = m_categoryInfomation[oldName];
     m_categoryInfomation.remove(oldName);
@@ -408,7 +420,7 @@ void ImageInfo::setMD5Sum( const MD5& sum, bool storeEXIF )
 
         // image size is invalidated by the thumbnail builder, if needed
 
-        m_dirty = true;
+        markDirty();
     }
     m_md5sum = sum;
     saveChangesIfNotDelayed();
@@ -417,6 +429,7 @@ void ImageInfo::setMD5Sum( const MD5& sum, bool storeEXIF )
 void ImageInfo::setLocked( bool locked )
 {
     m_locked = locked;
+    notifyObserver();
 }
 
 bool ImageInfo::isLocked() const
@@ -492,6 +505,7 @@ void ImageInfo::setSize( const QSize& size )
     if (size != m_size)
         m_dirty = true;
     m_size = size;
+    notifyObserver();
     saveChangesIfNotDelayed();
 }
 
@@ -555,16 +569,30 @@ ImageInfo& ImageInfo::operator=( const ImageInfo& other )
     m_null = other.m_null;
     m_size = other.m_size;
     m_type = other.m_type;
-    m_dirty = other.m_dirty;
+    m_dirty = true;
     m_rating = other.m_rating;
     m_stackId = other.m_stackId;
     m_stackOrder = other.m_stackOrder;
     m_videoLength = other.m_videoLength;
+    m_perceptualHash = other.m_perceptualHash;
+    notifyObserver();
     delaySavingChanges(false);
 
     return *this;
 }
 
+void ImageInfo::notifyObserver()
+{
+    if ( m_observer )
+        m_observer->imageInfoChanged( m_observerIndex, this );
+}
+
+void ImageInfo::markDirty()
+{
+    m_dirty = true;
+    notifyObserver();
+}
+
 MediaType DB::ImageInfo::mediaType() const
 {
     return m_type;
@@ -609,6 +637,8 @@ void DB::ImageInfo::copyExtraData( const DB::ImageInfo& from, bool copyAngle)
     if (copyAngle)
         m_angle = from.m_angle;
     m_rating = from.m_rating;
+    m_dirty = true;
+    notifyObserver();
 }
 
 void DB::ImageInfo::removeExtraData ()
@@ -616,10 +646,14 @@ void DB::ImageInfo::removeExtraData ()
     m_categoryInfomation.clear();
     m_description.clear();
     m_rating = -1;
+    m_dirty = true;
+    notifyObserver();
 }
 
 void ImageInfo::merge(const ImageInfo &other)
 {
+    markDirty();
+
     // Merge description
     if ( !other.description().isEmpty() ) {
         if ( m_description.isEmpty() )
@@ -664,7 +698,7 @@ void DB::ImageInfo::addCategoryInfo( const QString& category, const StringSet& v
 {
     for ( StringSet::const_iterator valueIt = values.constBegin(); valueIt != values.constEnd(); ++valueIt ) {
         if (! m_categoryInfomation[category].contains( *valueIt ) ) {
-            m_dirty = true;
+            markDirty();
             m_categoryInfomation[category].insert( *valueIt );
         }
     }
@@ -673,6 +707,7 @@ void DB::ImageInfo::addCategoryInfo( const QString& category, const StringSet& v
 
 void DB::ImageInfo::clearAllCategoryInfo()
 {
+    markDirty();
     m_categoryInfomation.clear();
     m_taggedAreas.clear();
 }
@@ -681,7 +716,7 @@ void DB::ImageInfo::removeCategoryInfo( const QString& category, const StringSet
 {
     for ( StringSet::const_iterator valueIt = values.constBegin(); valueIt != values.constEnd(); ++valueIt ) {
         if ( m_categoryInfomation[category].contains( *valueIt ) ) {
-            m_dirty = true;
+            markDirty();
             m_categoryInfomation[category].remove(*valueIt);
             m_taggedAreas[category].remove(*valueIt);
         }
@@ -692,7 +727,7 @@ void DB::ImageInfo::removeCategoryInfo( const QString& category, const StringSet
 void DB::ImageInfo::addCategoryInfo( const QString& category, const QString& value, const QRect& area )
 {
     if (! m_categoryInfomation[category].contains( value ) ) {
-        m_dirty = true;
+        markDirty();
         m_categoryInfomation[category].insert( value );
 
         if (area.isValid()) {
@@ -705,7 +740,7 @@ void DB::ImageInfo::addCategoryInfo( const QString& category, const QString& val
 void DB::ImageInfo::removeCategoryInfo( const QString& category, const QString& value )
 {
     if ( m_categoryInfomation[category].contains( value ) ) {
-        m_dirty = true;
+        markDirty();
         m_categoryInfomation[category].remove( value );
         m_taggedAreas[category].remove( value );
     }
@@ -714,7 +749,7 @@ void DB::ImageInfo::removeCategoryInfo( const QString& category, const QString&
 
 void DB::ImageInfo::setPositionedTags(const QString& category, const QMap<QString, QRect> &positionedTags)
 {
-    m_dirty = true;
+    markDirty();
     m_taggedAreas[category] = positionedTags;
     saveChangesIfNotDelayed();
 }
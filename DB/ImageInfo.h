@@ -30,6 +30,7 @@
 #include <QSize>
 #include <QRect>
 #include "FileName.h"
+#include "ImageInfoObserver.h"
 
 #include "config-kpa-kgeomap.h"
 #ifdef HAVE_KGEOMAP
@@ -151,6 +152,13 @@ public:
     const MD5& MD5Sum() const { return m_md5sum; }
     void setMD5Sum( const MD5& sum, bool storeEXIF=true );
 
+    /**
+     * @return a hash of what the image looks like, or 0 if it is not known yet.
+     * It is taken from the thumbnail; see Utilities::perceptualHash.
+     */
+    quint64 perceptualHash() const { return m_perceptualHash; }
+    void setPerceptualHash( quint64 hash );
+
     void setLocked( bool );
     bool isLocked() const;
 
@@ -159,7 +167,7 @@ public:
     void setSize( const QSize& size );
 
     MediaType mediaType() const;
-    void setMediaType( MediaType type ) { if (type != m_type) m_dirty = true; m_type = type; saveChangesIfNotDelayed(); }
+    void setMediaType( MediaType type ) { if (type != m_type) m_dirty = true; m_type = type; notifyObserver(); saveChangesIfNotDelayed(); }
     bool isVideo() const;
 
     void createFolderCategoryItem( DB::CategoryPtr, DB::MemberMap& memberMap );
@@ -202,8 +210,21 @@ protected:
     bool updateDateInformation( int mode ) const;
 
     void setStackId( const StackID stackId );
+
+    /**
+     * Let \p observer know about changes of this image, passing \p index along.
+     * A copy of an ImageInfo gets the observer of the original; the observer must check
+     * that the image is the one it expects.
+     */
+    void setObserver( ImageInfoObserver* observer, int index ) { m_observer = observer; m_observerIndex = index; }
+    ImageInfoObserver* observer() const { return m_observer; }
+    int observerIndex() const { return m_observerIndex; }
+
     friend class XMLDB::Database;
 private:
+    void notifyObserver();
+    void markDirty();
+
     DB::FileName m_fileName;
     QString m_label;
     QString m_description;
@@ -221,6 +242,7 @@ private:
     StackID m_stackId;
     unsigned int m_stackOrder;
     int m_videoLength;
+    quint64 m_perceptualHash = 0;
 #ifdef HAVE_KGEOMAP
     mutable KGeoMap::GeoCoordinates m_coordinates;
     mutable bool m_coordsIsSet = false;
@@ -229,10 +251,15 @@ private:
     // Cache information
     bool m_locked;
 
-    // Will be set to true after every change
+    // Will be set to true after every change, and cleared by the XMLDB::Journal once the change is recorded
     bool m_dirty;
 
     bool m_delaySaving;
+
+    // Told about every change, after the new value is set for date, media type, rating, stack, lock and size.
+    // Changes to the date through the non-const date() are not seen there; use setDate.
+    ImageInfoObserver* m_observer = nullptr;
+    int m_observerIndex = -1;
 };
 
 }
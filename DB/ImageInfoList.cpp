@@ -32,25 +32,26 @@ using namespace DB;
 class SortableImageInfo
 {
 public:
-    SortableImageInfo(const QDateTime& datetime, const QString& string, const ImageInfoPtr &info)
-        : m_dt(datetime), m_st(string), m_in(info) {}
+    SortableImageInfo(const QDateTime& datetime, const DB::FileName& fileName, const ImageInfoPtr &info)
+        : m_dt(datetime), m_fn(fileName), m_in(info) {}
     SortableImageInfo(const SortableImageInfo& in)
-        : m_dt(in.m_dt), m_st(in.m_st), m_in(in.m_in) {}
+        : m_dt(in.m_dt), m_fn(in.m_fn), m_in(in.m_in) {}
     SortableImageInfo() {}
     ~SortableImageInfo() {}
     const QDateTime& DateTime(void) const { return m_dt; }
-    const QString& String(void) const { return m_st; }
+    const DB::FileName& FileName(void) const { return m_fn; }
     const ImageInfoPtr& ImageInfo(void) const { return m_in; }
-    bool operator== (const SortableImageInfo& other) const { return m_dt == other.m_dt && m_st == other.m_st; }
-    bool operator!= (const SortableImageInfo& other) const { return m_dt != other.m_dt || m_st != other.m_st; }
-    bool operator> (const SortableImageInfo& other) const { if (m_dt != other.m_dt) { return m_dt > other.m_dt; } else { return m_st > other.m_st; }}
-    bool operator< (const SortableImageInfo& other) const { if (m_dt != other.m_dt) { return m_dt < other.m_dt; } else { return m_st < other.m_st; }}
+    bool operator== (const SortableImageInfo& other) const { return m_dt == other.m_dt && m_fn == other.m_fn; }
+    bool operator!= (const SortableImageInfo& other) const { return m_dt != other.m_dt || m_fn != other.m_fn; }
+    bool operator> (const SortableImageInfo& other) const { if (m_dt != other.m_dt) { return m_dt > other.m_dt; } else { return other.m_fn < m_fn; }}
+    bool operator< (const SortableImageInfo& other) const { if (m_dt != other.m_dt) { return m_dt < other.m_dt; } else { return m_fn < other.m_fn; }}
     bool operator>= (const SortableImageInfo& other) const { return *this == other || *this > other; }
     bool operator<= (const SortableImageInfo& other) const { return *this == other || *this < other; }
 
 private:
     QDateTime m_dt;
-    QString m_st;
+    // all images share the image directory, so comparing the file names orders them like their absolute paths:
+    DB::FileName m_fn;
     ImageInfoPtr m_in;
 };
 
@@ -58,7 +59,7 @@ ImageInfoList ImageInfoList::sort() const
 {
     QVector<SortableImageInfo> vec;
     for( ImageInfoListConstIterator it = constBegin(); it != constEnd(); ++it ) {
-        vec.append(SortableImageInfo((*it)->date().start(),(*it)->fileName().absolute(), *it));
+        vec.append(SortableImageInfo((*it)->date().start(),(*it)->fileName(), *it));
     }
 
     std::sort(vec.begin(),vec.end());
@@ -70,26 +71,6 @@ ImageInfoList ImageInfoList::sort() const
     return res;
 }
 
-void ImageInfoList::sortAndMergeBackIn( ImageInfoList& subListToSort )
-{
-    ImageInfoList sorted = subListToSort.sort();
-
-    const int insertIndex = indexOf(subListToSort[0]);
-    Q_ASSERT(insertIndex >= 0);
-
-    // Delete the items we will merge in.
-    for( ImageInfoListIterator it = sorted.begin(); it != sorted.end(); ++it )
-        remove( *it );
-
-    ImageInfoListIterator insertIt = begin() + insertIndex;
-
-    // Now merge in the items
-    for( ImageInfoListIterator it = sorted.begin(); it != sorted.end(); ++it ) {
-        insertIt = insert( insertIt, *it );
-        ++insertIt;
-    }
-}
-
 ImageInfoList::~ImageInfoList()
 {
 }
@@ -114,12 +95,12 @@ bool ImageInfoList::isSorted()
         return true;
 
     QDateTime prev = first()->date().start();
-    QString prevFile = first()->fileName().absolute();
+    DB::FileName prevFile = first()->fileName();
     for ( ImageInfoListConstIterator it = constBegin(); it != constEnd(); ++it ) {
         QDateTime cur = (*it)->date().start();
-        QString curFile = (*it)->fileName().absolute();
+        DB::FileName curFile = (*it)->fileName();
         if ( prev > cur ||
-             ( prev == cur && prevFile > curFile ) )
+             ( prev == cur && curFile < prevFile ) )
             return false;
         prev = cur;
         prevFile = curFile;
@@ -133,10 +114,10 @@ void ImageInfoList::mergeIn( ImageInfoList other)
 
     for ( ImageInfoListConstIterator it = constBegin(); it != constEnd(); ++it ) {
         QDateTime thisDate = (*it)->date().start();
-        QString thisFileName = (*it)->fileName().absolute();
+        DB::FileName thisFileName = (*it)->fileName();
         while ( other.count() != 0 ) {
             QDateTime otherDate = other.first()->date().start();
-            QString otherFileName = other.first()->fileName().absolute();
+            DB::FileName otherFileName = other.first()->fileName();
             if ( otherDate < thisDate ||
                  ( otherDate == thisDate && otherFileName < thisFileName ) ) {
                 tmp.append( other[0] );
@@ -29,7 +29,6 @@ class ImageInfoList :public QList<ImageInfoPtr>
 {
 public:
     ~ImageInfoList();
-    void sortAndMergeBackIn( ImageInfoList& subListToSort );
     ImageInfoList sort() const;
     void appendList( ImageInfoList& other );
     void printItems();
@@ -0,0 +1,47 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef IMAGEINFOOBSERVER_H
+#define IMAGEINFOOBSERVER_H
+
+namespace DB
+{
+class ImageInfo;
+
+/**
+ * \brief Gets told about changes of the ImageInfos it is set on with ImageInfo::setObserver().
+ *
+ * This lets a back-end keep its own copies of image fields up to date, without DB depending on it.
+ */
+class ImageInfoObserver
+{
+public:
+    virtual ~ImageInfoObserver() {}
+
+    /**
+     * Called whenever \p info changes; the setters of the date, media type, rating, stack, lock
+     * and size call it once the new value is set.
+     * @param index is the number that was passed to ImageInfo::setObserver().
+     */
+    virtual void imageInfoChanged( int index, const ImageInfo* info ) = 0;
+};
+
+}
+
+#endif /* IMAGEINFOOBSERVER_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
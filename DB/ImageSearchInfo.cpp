@@ -26,9 +26,9 @@
 #include "NegationCategoryMatcher.h"
 #include "NoTagCategoryMatcher.h"
 #include "OrCategoryMatcher.h"
+#include "SearchPlan.h"
 #include "ValueCategoryMatcher.h"
 
-#include <ImageManager/RawImageDecoder.h>
 #include <Settings/SettingsData.h>
 
 #include <KConfigGroup>
@@ -86,112 +86,18 @@ bool ImageSearchInfo::match( ImageInfoPtr info ) const
     if ( !m_compiled )
         compile();
 
-    bool ok = true;
-    ok = m_exifSearchInfo.matches( info->fileName() );
-
-    QDateTime actualStart = info->date().start();
-    QDateTime actualEnd = info->date().end();
-    if ( actualEnd <= actualStart )  {
-        QDateTime tmp = actualStart;
-        actualStart = actualEnd;
-        actualEnd = tmp;
-    }
-
-    if ( !m_date.start().isNull() ) {
-        // Date
-        // the search date matches the actual date if:
-        // actual.start <= search.start <= actuel.end or
-        // actual.start <= search.end <=actuel.end or
-        // search.start <= actual.start and actual.end <= search.end
-
-        bool b1 =( actualStart <= m_date.start() && m_date.start() <= actualEnd );
-        bool b2 =( actualStart <= m_date.end() && m_date.end() <= actualEnd );
-        bool b3 = ( m_date.start() <= actualStart && ( actualEnd <= m_date.end() || m_date.end().isNull() ) );
-
-        ok = ok && ( ( b1 || b2 || b3 ) );
-    } else if ( !m_date.end().isNull() ) {
-        bool b1 = ( actualStart <= m_date.end() && m_date.end() <= actualEnd );
-        bool b2 = ( actualEnd <= m_date.end() );
-        ok = ok && ( ( b1 || b2 ) );
-    }
-
-    // -------------------------------------------------- Options
-    // alreadyMatched map is used to make it possible to search for
-    // Jesper & None
-    QMap<QString, StringSet> alreadyMatched;
-    for (CategoryMatcher* optionMatcher : m_categoryMatchers) {
-        ok = ok && optionMatcher->eval(info, alreadyMatched);
-    }
-
-
-    // -------------------------------------------------- Label
-    ok = ok && ( m_label.isEmpty() || info->label().indexOf(m_label) != -1 );
-
-    // -------------------------------------------------- RAW
-    ok = ok && ( m_searchRAW == false || ImageManager::RAWImageDecoder::isRAW( info->fileName()) );
-
-    // -------------------------------------------------- Rating
-
-    //ok = ok && (_rating == -1 ) || ( _rating == info->rating() );
-    if (m_rating != -1) {
-    switch( m_ratingSearchMode ) {
-        case 1:
-        // Image rating at least selected
-        ok = ok && ( m_rating <= info->rating() );
-        break;
-        case 2:
-        // Image rating less than selected
-        ok = ok && ( m_rating >= info->rating() );
-        break;
-        case 3:
-        // Image rating not equal
-        ok = ok && ( m_rating != info->rating() );
-        break;
-        default:
-            ok = ok && ((m_rating == -1 ) || ( m_rating == info->rating() ));
-        break;
-    }
-    }
-
-
-    // -------------------------------------------------- Resolution
-    if ( m_megapixel )
-        ok = ok && ( m_megapixel * 1000000 <= info->size().width() * info->size().height() );
-
-    if ( m_max_megapixel && m_max_megapixel > m_megapixel )
-        ok = ok && ( m_max_megapixel * 1000000 > info->size().width() * info->size().height() );
-
-    // -------------------------------------------------- Text
-    QString txt = info->description();
-    if ( !m_description.isEmpty() ) {
-        QStringList list = m_description.split(QChar::fromLatin1(' '), QString::SkipEmptyParts);
-        Q_FOREACH( const QString &word, list ) {
-            ok = ok && ( txt.indexOf( word, 0, Qt::CaseInsensitive ) != -1 );
-        }
-    }
-
-    // -------------------------------------------------- File name pattern
-    ok = ok && ( m_fnPattern.isEmpty() ||
-        m_fnPattern.indexIn( info->fileName().relative() ) != -1 );
+    return m_plan->match( info );
+}
 
+bool ImageSearchInfo::prepareConcurrentMatching() const
+{
+    if ( m_isNull )
+        return true;
 
-#ifdef HAVE_KGEOMAP
-    // Search for GPS Position
-    if (ok && m_usingRegionSelection) {
-        ok = ok && info->coordinates().hasCoordinates();
-        if (ok) {
-            float infoLat = info->coordinates().lat();
-            float infoLon = info->coordinates().lon();
-            ok = ok
-                 && m_regionSelectionMinLat <= infoLat
-                 && infoLat                 <= m_regionSelectionMaxLat
-                 && m_regionSelectionMinLon <= infoLon
-                 && infoLon                 <= m_regionSelectionMaxLon;
-        }
-    }
-#endif
+    if ( !m_compiled )
+        compile();
 
-    return ok;
+    return m_plan->canMatchConcurrently();
 }
 
 
@@ -322,7 +228,18 @@ ImageSearchInfo ImageSearchInfo::loadLock()
 }
 
 ImageSearchInfo::ImageSearchInfo( const ImageSearchInfo& other )
+    : m_compiled( false )
+{
+    *this = other;
+}
+
+ImageSearchInfo& ImageSearchInfo::operator=( const ImageSearchInfo& other )
 {
+    if ( this == &other )
+        return *this;
+
+    // the matchers and the search plan are not shared, but compiled again when needed:
+    deleteMatchers();
     m_date = other.m_date;
     m_categoryMatchText = other.m_categoryMatchText;
     m_label = other.m_label;
@@ -339,7 +256,7 @@ ImageSearchInfo::ImageSearchInfo( const ImageSearchInfo& other )
 #ifdef HAVE_KGEOMAP
     m_regionSelection = other.m_regionSelection;
 #endif
-
+    return *this;
 }
 
 void ImageSearchInfo::compile() const
@@ -360,6 +277,7 @@ void ImageSearchInfo::compile() const
 
     deleteMatchers();
 
+    QList<QPair<QString, CategoryMatcher*>> planMatchers;
     for( QMap<QString,QString>::ConstIterator it = m_categoryMatchText.begin(); it != m_categoryMatchText.end(); ++it ) {
         QString category = it.key();
         QString matchText = it.value();
@@ -436,6 +354,7 @@ void ImageSearchInfo::compile() const
         if ( matcher )
         {
             m_categoryMatchers.append( matcher );
+            planMatchers.append( qMakePair( category, matcher ) );
             if ( DBCategoryMatcherLog().isDebugEnabled() )
             {
                 qCDebug(DBCategoryMatcherLog) << "Matching text '" << matchText << "' in category "<< category <<":";
@@ -444,6 +363,7 @@ void ImageSearchInfo::compile() const
             }
         }
     }
+    m_plan.reset( new SearchPlan( *this, planMatchers ) );
     m_compiled = true;
 }
 
@@ -515,6 +435,8 @@ Utilities::StringSet ImageSearchInfo::findAlreadyMatched( const QString &group )
 
 void ImageSearchInfo::deleteMatchers() const
 {
+    // the plan refers to the matchers:
+    m_plan.reset();
     qDeleteAll(m_categoryMatchers);
     m_categoryMatchers.clear();
 }
@@ -23,6 +23,8 @@
 #include <QMap>
 #include <QList>
 
+#include <memory>
+
 #include <DB/ImageDate.h>
 #include <DB/ImageInfoPtr.h>
 #include <Exif/SearchInfo.h>
@@ -37,6 +39,7 @@ namespace DB
 class SimpleCategoryMatcher;
 class ImageInfo;
 class CategoryMatcher;
+class SearchPlan;
 
 
 class ImageSearchInfo {
@@ -49,6 +52,7 @@ public:
                      const QString& label, const QString& description,
              const QString& fnPattern );
     ImageSearchInfo( const ImageSearchInfo& other );
+    ImageSearchInfo& operator=( const ImageSearchInfo& other );
 
     ImageDate date() const;
 
@@ -62,6 +66,11 @@ public:
 
     bool isNull() const;
     bool match( ImageInfoPtr ) const;
+    /**
+     * Compile the search unless it is already compiled.
+     * @return \c true if match may then be called from several threads at once.
+     */
+    bool prepareConcurrentMatching() const;
     QList<QList<SimpleCategoryMatcher*> > query() const;
 
     void addAnd( const QString& category, const QString& value );
@@ -108,6 +117,7 @@ private:
     bool m_isNull;
     mutable bool m_compiled;
     mutable QList<CategoryMatcher*> m_categoryMatchers;
+    mutable std::unique_ptr<SearchPlan> m_plan;
 
     Exif::SearchInfo m_exifSearchInfo;
 
@@ -119,7 +129,9 @@ private:
     mutable float m_regionSelectionMinLon;
     mutable float m_regionSelectionMaxLon;
 #endif
-    // When adding new instance variable, please notice that this class as an explicit written copy constructor.
+    // When adding new instance variable, please notice that this class as an explicit written assignment operator.
+
+    friend class SearchPlan;
 };
 
 }
@@ -26,6 +26,17 @@ void MD5Map::insert( const MD5& md5sum, const DB::FileName& fileName )
     m_i_map.insert( fileName, md5sum );
 }
 
+void MD5Map::removeFile( const DB::FileName& fileName )
+{
+    const FileMD5Map::iterator it = m_i_map.find( fileName );
+    if ( it == m_i_map.end() )
+        return;
+    // another file with the same sum keeps its entry:
+    if ( m_map.value( it.value() ) == fileName )
+        m_map.remove( it.value() );
+    m_i_map.erase( it );
+}
+
 DB::FileName MD5Map::lookup( const MD5& md5sum ) const
 {
     return m_map[md5sum];
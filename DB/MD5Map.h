@@ -37,6 +37,7 @@ class MD5Map
 public:
     virtual ~MD5Map() {}
     virtual void insert( const MD5& md5sum, const DB::FileName& fileName );
+    virtual void removeFile( const DB::FileName& fileName );
     virtual DB::FileName lookup( const MD5& md5sum ) const;
     virtual MD5 lookupFile( const DB::FileName& fileName ) const;
     virtual bool contains( const MD5& md5sum ) const;
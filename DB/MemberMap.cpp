@@ -22,7 +22,7 @@
 
 using namespace DB;
 
-MemberMap::MemberMap() :QObject(nullptr), m_dirty( true ), m_loading( false )
+MemberMap::MemberMap() :QObject(nullptr), m_version( 0 ), m_loading( false )
 {
 }
 
@@ -50,7 +50,7 @@ void MemberMap::markDirty( const QString& category )
 void MemberMap::deleteGroup( const QString& category, const QString& name )
 {
     m_members[category].remove(name);
-    m_dirty = true;
+    changed( category );
     markDirty(category);
 }
 
@@ -59,11 +59,8 @@ void MemberMap::deleteGroup( const QString& category, const QString& name )
 */
 QStringList MemberMap::members( const QString& category, const QString& memberGroup, bool closure ) const
 {
-    if ( closure ) {
-        if ( m_dirty )
-            calculate();
-        return m_closureMembers[category][memberGroup].toList();
-    }
+    if ( closure )
+        return compiled( category )->members( memberGroup ).toList();
     else
         return m_members[category][memberGroup].toList();
 }
@@ -77,7 +74,7 @@ void MemberMap::setMembers( const QString& category, const QString& memberGroup,
             allowedMembers.remove(*i);
 
     m_members[category][memberGroup] = allowedMembers;
-    m_dirty = true;
+    changed( category );
     markDirty( category );
 }
 
@@ -101,62 +98,21 @@ bool MemberMap::isGroup( const QString& category, const QString& item ) const
 */
 QMap<QString,StringSet> MemberMap::groupMap( const QString& category ) const
 {
-    if ( m_dirty )
-        calculate();
-
-    return m_closureMembers[category];
+    return compiled( category )->closureMap();
 }
 
-/**
-   Calculates the closure for group, that is finds all members for group.
-   Imagine there is a group called USA, and that this groups has a group inside it called Califonia,
-   Califonia consists of members San Fransisco and Los Angeless.
-   This function then maps USA to include Califonia, San Fransisco and Los Angeless.
-*/
-QStringList MemberMap::calculateClosure( QMap<QString,StringSet>& resultSoFar, const QString& category, const QString& group ) const
+QSharedPointer<const CompiledMemberMap> MemberMap::compiled( const QString& category ) const
 {
-    resultSoFar[group] = StringSet(); // Prevent against cykles.
-    StringSet members = m_members[category][group];
-    StringSet result = members;
-    for( StringSet::const_iterator it = members.begin(); it != members.end(); ++it ) {
-        if ( resultSoFar.contains( *it ) ) {
-            result += resultSoFar[*it];
-        }
-        else if ( isGroup(category, *it ) ) {
-            result += calculateClosure( resultSoFar, category, *it ).toSet();
-        }
-    }
-
-    resultSoFar[group] = result;
-    return result.toList();
+    QSharedPointer<const CompiledMemberMap>& result = m_compiled[category];
+    const int version = m_categoryVersions.value( category );
+    if ( !result || result->version() != version )
+        result.reset( new CompiledMemberMap( m_members[category], version ) );
+    return result;
 }
 
-/**
-   This methods create the map _closureMembers from _members
-   This is simply to avoid finding the closure each and every time it is needed.
-*/
-void MemberMap::calculate() const
+void MemberMap::changed( const QString& category )
 {
-    m_closureMembers.clear();
-    // run through all categories
-    for( QMap< QString,QMap<QString,StringSet> >::ConstIterator categoryIt= m_members.begin();
-         categoryIt != m_members.end(); ++categoryIt ) {
-
-        QString category = categoryIt.key();
-        QMap<QString, StringSet> groupMap = categoryIt.value();
-
-        // Run through each of the groups for the given categories
-        for( QMap<QString,StringSet>::const_iterator groupIt= groupMap.constBegin()
-             ; groupIt != groupMap.constEnd()
-             ; ++groupIt )
-        {
-            QString group = groupIt.key();
-            if ( m_closureMembers[category].find( group ) == m_closureMembers[category].end() ) {
-                (void) calculateClosure( m_closureMembers[category], category, group );
-            }
-        }
-    }
-    m_dirty = false;
+    m_categoryVersions[category] = ++m_version;
 }
 
 void MemberMap::renameGroup( const QString& category, const QString& oldName, const QString& newName )
@@ -165,7 +121,7 @@ void MemberMap::renameGroup( const QString& category, const QString& oldName, co
     if (m_members[category].contains(newName))
         return;
 
-    m_dirty = true;
+    changed( category );
     markDirty( category );
     QMap<QString, StringSet>& groupMap = m_members[category];
     groupMap.insert(newName,m_members[category][oldName] );
@@ -179,7 +135,7 @@ void MemberMap::renameGroup( const QString& category, const QString& oldName, co
 }
 
 MemberMap::MemberMap( const MemberMap& other )
-    : QObject( nullptr ), m_members( other.memberMap() ), m_dirty( true ), m_loading( false )
+    : QObject( nullptr ), m_members( other.memberMap() ), m_version( other.m_version ), m_categoryVersions( other.m_categoryVersions ), m_compiled( other.m_compiled ), m_loading( false )
 {
 }
 
@@ -190,7 +146,7 @@ void MemberMap::deleteItem( DB::Category* category, const QString& name)
         items.remove( name );
     }
     m_members[category->name()].remove(name);
-    m_dirty = true;
+    changed( category->name() );
     markDirty( category->name() );
 }
 
@@ -210,7 +166,7 @@ void MemberMap::renameItem( DB::Category* category, const QString& oldName, cons
         groupMap[newName] = groupMap[oldName];
         groupMap.remove(oldName);
     }
-    m_dirty = true;
+    changed( category->name() );
     markDirty( category->name() );
 }
 
@@ -218,8 +174,15 @@ void MemberMap::renameItem( DB::Category* category, const QString& oldName, cons
 MemberMap& MemberMap::operator=( const MemberMap& other )
 {
     if ( this != &other ) {
+        // the settings dialog assigns its copy back even when nothing was changed:
+        const bool changed = ( m_members != other.memberMap() );
         m_members = other.memberMap();
-        m_dirty = true;
+        // compiled maps are immutable, so they can be shared with other:
+        m_version = other.m_version;
+        m_categoryVersions = other.m_categoryVersions;
+        m_compiled = other.m_compiled;
+        if ( changed && !m_loading )
+            emit dirty();
     }
     return *this;
 }
@@ -251,31 +214,16 @@ void MemberMap::addMemberToGroup( const QString& category, const QString& group,
     m_members[category][group].insert( item );
     m_flatMembers[category].insert( item );
 
-    if (m_loading) {
-        m_dirty = true;
-    } else if (!m_dirty) {
-        // Update _closureMembers to avoid marking it dirty
-
-        QMap<QString, StringSet>& categoryClosure = m_closureMembers[category];
-
-        categoryClosure[group].insert(item);
-
-        QMap<QString, StringSet>::const_iterator
-            closureOfItem = categoryClosure.constFind(item);
-        const StringSet* closureOfItemPtr(nullptr);
-        if (closureOfItem != categoryClosure.constEnd()) {
-            closureOfItemPtr = &(*closureOfItem);
-            categoryClosure[group] += *closureOfItem;
-        }
-
-        for (QMap<QString, StringSet>::iterator i = categoryClosure.begin();
-             i != categoryClosure.end(); ++i)
-            if ((*i).contains(group)) {
-                (*i).insert(item);
-                if (closureOfItemPtr)
-                    (*i) += *closureOfItemPtr;
-            }
+    // Update the compiled map if it is up to date, rather than compiling it all again on next use,
+    // as canAddMemberToGroup() needs it for every member added.
+    const int version = ++m_version;
+    QSharedPointer<const CompiledMemberMap>& compiled = m_compiled[category];
+    if ( !m_loading && compiled && compiled->version() == m_categoryVersions.value( category ) ) {
+        CompiledMemberMap* updated = compiled->withMember( group, item, version );
+        if ( updated )
+            compiled.reset( updated );
     }
+    m_categoryVersions[category] = version;
 
     // If we are loading, we do *not* want to regenerate the list!
     if ( !m_loading )
@@ -287,6 +235,7 @@ void MemberMap::removeMemberFromGroup( const QString& category, const QString& g
     Q_ASSERT( m_members.contains(category) );
     if ( m_members[category].contains( group ) ) {
         m_members[category][group].remove( item );
+        changed( category );
         // We shouldn't be doing this very often, so just regenerate
         // the flat list
         regenerateFlatList( category );
@@ -298,6 +247,7 @@ void MemberMap::addGroup( const QString& category, const QString& group )
 {
     if ( ! m_members[category].contains( group ) ) {
         m_members[category].insert( group, StringSet() );
+        changed( category );
     }
     markDirty( category );
 }
@@ -308,8 +258,8 @@ void MemberMap::renameCategory( const QString& oldName, const QString& newName )
         return;
     m_members[newName] = m_members[oldName];
     m_members.remove(oldName);
-    m_closureMembers[newName] = m_closureMembers[oldName];
-    m_closureMembers.remove(oldName);
+    changed( oldName );
+    changed( newName );
     if ( !m_loading )
         emit dirty();
 }
@@ -317,7 +267,7 @@ void MemberMap::renameCategory( const QString& oldName, const QString& newName )
 void MemberMap::deleteCategory(const QString &category)
 {
     m_members.remove(category);
-    m_closureMembers.remove(category);
+    changed( category );
     markDirty( category );
 }
 
@@ -341,13 +291,10 @@ bool DB::MemberMap::hasPath( const QString& category, const QString& from, const
     if (from == to)
         return true;
     else if (!m_members[category].contains(from))
-        // Try to avoid calculate(), which is quite time consuming.
+        // Try to avoid compiling the member map, which is quite time consuming.
         return false;
     else {
-        // return members(category, from, true).contains(to);
-        if ( m_dirty )
-            calculate();
-        return m_closureMembers[category][from].contains(to);
+        return compiled( category )->hasPath( from, to );
     }
 }
 
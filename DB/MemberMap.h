@@ -21,7 +21,10 @@
 #include <qstringlist.h>
 #include <qmap.h>
 #include <qobject.h>
+#include <QHash>
+#include <QSharedPointer>
 #include "Utilities/StringSet.h"
+#include "CompiledMemberMap.h"
 
 namespace DB
 {
@@ -65,9 +68,15 @@ public:
     virtual bool hasPath( const QString& category, const QString& from, const QString& to ) const;
     virtual bool contains(const QString& category, const QString& item) const;
 
-protected:
-    void calculate() const;
-    QStringList calculateClosure( QMap<QString,StringSet>& resultSoFar, const QString& category, const QString& group ) const;
+    /**
+     * @return the member groups of \p category in precomputed form.
+     * The result is computed once and then shared, until the member map changes.
+     */
+    QSharedPointer<const CompiledMemberMap> compiled( const QString& category ) const;
+    /**
+     * @return a number that changes whenever the member map changes.
+     */
+    int version() const { return m_version; }
 
 public slots:
     virtual void deleteCategory( const QString& category );
@@ -80,16 +89,19 @@ signals:
 
 private:
     void markDirty( const QString& category );
+    void changed( const QString& category );
     void regenerateFlatList( const QString& category );
     // This is the primary data structure
     // { category |-> { group |-> [ member ] } } <- VDM syntax ;-)
     QMap<QString, QMap<QString,StringSet> > m_members;
     mutable QMap<QString, QSet<QString> > m_flatMembers;
 
-    // These are the data structures used to develop closures, they are only
-    // needed to speed up the program *SIGNIFICANTLY* ;-)
-    mutable bool m_dirty;
-    mutable QMap<QString, QMap<QString,StringSet> > m_closureMembers;
+    // Closures and inverse maps, only needed to speed up the program *SIGNIFICANTLY* ;-)
+    // An entry is out of date if its version differs from the one of its category in m_categoryVersions,
+    // which is set to the incremented m_version whenever the category changes.
+    int m_version;
+    QHash<QString, int> m_categoryVersions;
+    mutable QHash<QString, QSharedPointer<const CompiledMemberMap> > m_compiled;
 
     bool m_loading;
 };
@@ -34,7 +34,12 @@ void DB::NegationCategoryMatcher::setShouldCreateMatchedSet(bool b)
     m_child->setShouldCreateMatchedSet( b );
 }
 
-bool DB::NegationCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched)
+DB::CategoryMatcher* DB::NegationCategoryMatcher::child() const
+{
+    return m_child;
+}
+
+bool DB::NegationCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched) const
 {
     return ! m_child->eval( info, alreadyMatched);
 }
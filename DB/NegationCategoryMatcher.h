@@ -34,9 +34,10 @@ namespace DB
         public:
             explicit NegationCategoryMatcher( CategoryMatcher *child );
             virtual ~NegationCategoryMatcher();
-            bool eval( ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched ) override;
+            bool eval( ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched ) const override;
             void debug( int level ) const override;
             void setShouldCreateMatchedSet( bool b ) override;
+            CategoryMatcher* child() const;
         private:
             CategoryMatcher *m_child;
     };
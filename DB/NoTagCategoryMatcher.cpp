@@ -28,7 +28,7 @@ DB::NoTagCategoryMatcher::~NoTagCategoryMatcher()
 {
 }
 
-bool DB::NoTagCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched)
+bool DB::NoTagCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched) const
 {
     Q_UNUSED( alreadyMatched );
     return info->itemsOfCategory(m_category).isEmpty();
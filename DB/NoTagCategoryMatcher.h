@@ -32,7 +32,7 @@ class NoTagCategoryMatcher :public CategoryMatcher
 public:
     explicit NoTagCategoryMatcher(const QString& category);
     virtual ~NoTagCategoryMatcher();
-    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) override;
+    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) const override;
     void debug( int level ) const override;
 
 private:
@@ -19,9 +19,9 @@
 #include "ImageInfo.h"
 #include "Logging.h"
 
-bool DB::OrCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched)
+bool DB::OrCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched) const
 {
-    Q_FOREACH( CategoryMatcher *subMatcher, mp_elements ) {
+    for ( CategoryMatcher* subMatcher : mp_elements ) {
         if (subMatcher->eval(info, alreadyMatched))
             return true;
     }
@@ -0,0 +1,262 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "PathTrie.h"
+
+#include <cstring>
+
+namespace
+{
+constexpr quint32 IMAGE_ROOT = 0;
+constexpr int INITIAL_FILE_SLOTS = 1024;
+}
+
+DB::PathTrie* DB::PathTrie::instance()
+{
+    static PathTrie s_instance;
+    return &s_instance;
+}
+
+DB::PathTrie::PathTrie()
+    : m_fileSlots( INITIAL_FILE_SLOTS, 0 )
+{
+    m_directories.append( Directory { IMAGE_ROOT, QString(), QByteArray() } );
+    // 0 is the number of the null file name:
+    m_files.append( File { IMAGE_ROOT, 0, 0 } );
+}
+
+quint32 DB::PathTrie::intern( const QString& relativePath )
+{
+    const int lastSlash = relativePath.lastIndexOf( QLatin1Char( '/' ) );
+    const QByteArray name = relativePath.mid( lastSlash + 1 ).toUtf8();
+    {
+        QReadLocker locker( &m_lock );
+        const quint32 directory = findDirectory( relativePath, lastSlash );
+        if ( directory != IMAGE_ROOT || lastSlash == -1 ) {
+            const quint32 id = findFile( directory, name, fileHash( directory, name ) );
+            if ( id != 0 )
+                return id;
+        }
+    }
+
+    QWriteLocker locker( &m_lock );
+    quint32 parent = IMAGE_ROOT;
+    int start = 0;
+    for ( int slash = relativePath.indexOf( QLatin1Char( '/' ) ); slash != -1 && slash <= lastSlash; slash = relativePath.indexOf( QLatin1Char( '/' ), start ) ) {
+        parent = directory( parent, relativePath.mid( start, slash - start ) );
+        start = slash + 1;
+    }
+
+    // another thread may have added the file since the lookup above:
+    const uint hash = fileHash( parent, name );
+    const quint32 id = findFile( parent, name, hash );
+    if ( id != 0 )
+        return id;
+
+    addFile( parent, name, hash );
+    return m_files.size() - 1;
+}
+
+QString DB::PathTrie::path( quint32 id, const QString& root ) const
+{
+    QReadLocker locker( &m_lock );
+    const File& file = m_files.at( id );
+    const char* name = m_names.constData() + file.nameOffset;
+    const QString& directory = m_directories.at( file.directory ).path;
+
+    // put the path together in one go; most names are plain ASCII and need no conversion:
+    QString result;
+    result.reserve( root.size() + directory.size() + 1 + int( file.nameLength ) );
+    result.append( root );
+    if ( file.directory != IMAGE_ROOT ) {
+        result.append( directory );
+        result.append( QLatin1Char( '/' ) );
+    }
+    bool ascii = true;
+    for ( quint32 i = 0; i < file.nameLength && ascii; ++i )
+        ascii = ( uchar( name[i] ) < 0x80 );
+    if ( ascii )
+        result.append( QLatin1String( name, int( file.nameLength ) ) );
+    else
+        result.append( QString::fromUtf8( name, int( file.nameLength ) ) );
+    return result;
+}
+
+int DB::PathTrie::compare( quint32 id1, quint32 id2 ) const
+{
+    if ( id1 == id2 )
+        return 0;
+    QReadLocker locker( &m_lock );
+    return compareLocked( id1, id2 );
+}
+
+namespace
+{
+/**
+ * The relative path of a file as UTF-8, in the pieces it is stored in.
+ * Comparing UTF-8 byte by byte compares the code points.
+ */
+struct PathPieces {
+    const char* data[3];
+    int size[3];
+    int count;
+};
+
+int comparePieces( const PathPieces& a, const PathPieces& b )
+{
+    int pieceA = 0, offsetA = 0;
+    int pieceB = 0, offsetB = 0;
+    for ( ;; ) {
+        while ( pieceA < a.count && offsetA == a.size[pieceA] ) {
+            ++pieceA;
+            offsetA = 0;
+        }
+        while ( pieceB < b.count && offsetB == b.size[pieceB] ) {
+            ++pieceB;
+            offsetB = 0;
+        }
+        if ( pieceA == a.count )
+            return ( pieceB == b.count ) ? 0 : -1;
+        if ( pieceB == b.count )
+            return 1;
+
+        const int length = qMin( a.size[pieceA] - offsetA, b.size[pieceB] - offsetB );
+        const int result = std::memcmp( a.data[pieceA] + offsetA, b.data[pieceB] + offsetB, length );
+        if ( result != 0 )
+            return result;
+        offsetA += length;
+        offsetB += length;
+    }
+}
+}
+
+// Must be called with the lock held.
+int DB::PathTrie::compareLocked( quint32 id1, quint32 id2 ) const
+{
+    const File& file1 = m_files.at( id1 );
+    const File& file2 = m_files.at( id2 );
+    auto pieces = [this]( const File& file ) {
+        PathPieces result;
+        result.count = 0;
+        if ( file.directory != IMAGE_ROOT ) {
+            const QByteArray& directory = m_directories.at( file.directory ).utf8Path;
+            result.data[result.count] = directory.constData();
+            result.size[result.count++] = directory.size();
+            result.data[result.count] = "/";
+            result.size[result.count++] = 1;
+        }
+        result.data[result.count] = m_names.constData() + file.nameOffset;
+        result.size[result.count++] = int( file.nameLength );
+        return result;
+    };
+
+    if ( file1.directory == file2.directory ) {
+        // only the names differ:
+        const int result = std::memcmp( m_names.constData() + file1.nameOffset, m_names.constData() + file2.nameOffset,
+                                        qMin( file1.nameLength, file2.nameLength ) );
+        if ( result != 0 )
+            return result;
+        return int( file1.nameLength ) - int( file2.nameLength );
+    }
+    return comparePieces( pieces( file1 ), pieces( file2 ) );
+}
+
+// Return the number of the directory of the first \p end characters of \p relativePath,
+// or IMAGE_ROOT if it isn't in the table yet. Must be called with the lock held.
+quint32 DB::PathTrie::findDirectory( const QString& relativePath, int end ) const
+{
+    quint32 parent = IMAGE_ROOT;
+    int start = 0;
+    for ( int slash = relativePath.indexOf( QLatin1Char( '/' ) ); slash != -1 && slash <= end; slash = relativePath.indexOf( QLatin1Char( '/' ), start ) ) {
+        const auto found = m_directoryIds.constFind( Key( parent, relativePath.mid( start, slash - start ) ) );
+        if ( found == m_directoryIds.constEnd() )
+            return IMAGE_ROOT;
+        parent = found.value();
+        start = slash + 1;
+    }
+    return parent;
+}
+
+// Return the number of the directory, adding it if needed. Must be called with the write lock held.
+quint32 DB::PathTrie::directory( quint32 parent, const QString& name )
+{
+    const Key key( parent, name );
+    const auto found = m_directoryIds.constFind( key );
+    if ( found != m_directoryIds.constEnd() )
+        return found.value();
+
+    const QString path = ( parent == IMAGE_ROOT ) ? name : m_directories.at( parent ).path + QLatin1Char( '/' ) + name;
+    const quint32 id = m_directories.size();
+    m_directories.append( Directory { parent, path, path.toUtf8() } );
+    m_directoryIds.insert( key, id );
+    return id;
+}
+
+// Return the number of the file, or 0 if it isn't in the table yet. Must be called with the lock held.
+quint32 DB::PathTrie::findFile( quint32 directory, const QByteArray& name, uint hash ) const
+{
+    const int mask = m_fileSlots.size() - 1;
+    for ( int slot = hash & mask; ; slot = ( slot + 1 ) & mask ) {
+        const quint32 id = m_fileSlots.at( slot );
+        if ( id == 0 )
+            return 0;
+        const File& file = m_files.at( id );
+        if ( file.directory == directory && int( file.nameLength ) == name.size()
+             && std::memcmp( m_names.constData() + file.nameOffset, name.constData(), name.size() ) == 0 )
+            return id;
+    }
+}
+
+// Must be called with the write lock held.
+void DB::PathTrie::addFile( quint32 directory, const QByteArray& name, uint hash )
+{
+    const quint32 id = m_files.size();
+    m_files.append( File { directory, quint32( m_names.size() ), quint32( name.size() ) } );
+    m_names.append( name );
+
+    if ( 2 * m_files.size() > m_fileSlots.size() )
+        growFileSlots();
+    else {
+        const int mask = m_fileSlots.size() - 1;
+        int slot = hash & mask;
+        while ( m_fileSlots.at( slot ) != 0 )
+            slot = ( slot + 1 ) & mask;
+        m_fileSlots[slot] = id;
+    }
+}
+
+// Double the number of slots, and put all files into them again.
+void DB::PathTrie::growFileSlots()
+{
+    m_fileSlots = QVector<quint32>( 2 * m_fileSlots.size(), 0 );
+    const int mask = m_fileSlots.size() - 1;
+    for ( quint32 id = 1; id < quint32( m_files.size() ); ++id ) {
+        const File& file = m_files.at( id );
+        int slot = qHashBits( m_names.constData() + file.nameOffset, file.nameLength, file.directory ) & mask;
+        while ( m_fileSlots.at( slot ) != 0 )
+            slot = ( slot + 1 ) & mask;
+        m_fileSlots[slot] = id;
+    }
+}
+
+uint DB::PathTrie::fileHash( quint32 directory, const QByteArray& name )
+{
+    return qHashBits( name.constData(), name.size(), directory );
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
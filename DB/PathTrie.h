@@ -0,0 +1,109 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef DB_PATHTRIE_H
+#define DB_PATHTRIE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+namespace DB
+{
+
+/**
+ * \brief The table of all file names that DB::FileName refers to.
+ *
+ * Every relative path that is turned into a FileName gets a number that stays the same
+ * for as long as the application runs, so FileName only needs to hold that number.
+ *
+ * The paths are stored as a trie of directories, so the name of a directory is only stored once
+ * no matter how many files it has. The path of a file is put together when it is asked for.
+ *
+ * As there are far more files than directories, the files are stored compactly: their names are
+ * kept back to back as UTF-8 in one byte array, and they are found through an open addressing
+ * table of their numbers. That is about 20 bytes per file on top of its name, where a QString
+ * and a QHash node per file would take well over 100.
+ *
+ * Entries are never removed. The table is safe to use from several threads.
+ */
+class PathTrie
+{
+public:
+    static PathTrie* instance();
+
+    /**
+     * @return the number of \p relativePath, which is added to the table if it is not in it yet.
+     * The number is never 0.
+     */
+    quint32 intern( const QString& relativePath );
+
+    /**
+     * @return \p root followed by the relative path of the file with number \p id.
+     */
+    QString path( quint32 id, const QString& root = QString() ) const;
+
+    /**
+     * Compare the relative paths of the files with numbers \p id1 and \p id2, without putting them together.
+     * The paths are compared by their unicode code points.
+     * @return a negative number, 0 or a positive number if the first path is less than, equal to or greater than the second.
+     */
+    int compare( quint32 id1, quint32 id2 ) const;
+
+private:
+    PathTrie();
+    quint32 findDirectory( const QString& relativePath, int end ) const;
+    quint32 directory( quint32 parent, const QString& name );
+    quint32 findFile( quint32 directory, const QByteArray& name, uint hash ) const;
+    void addFile( quint32 directory, const QByteArray& name, uint hash );
+    void growFileSlots();
+    static uint fileHash( quint32 directory, const QByteArray& name );
+    int compareLocked( quint32 id1, quint32 id2 ) const;
+
+    struct Directory {
+        quint32 parent;
+        // the relative path of the directory, which is empty for the image directory itself:
+        QString path;
+        // the path again, as UTF-8 like the names of the files, for compare():
+        QByteArray utf8Path;
+    };
+    struct File {
+        quint32 directory;
+        // the name is in m_names from nameOffset on:
+        quint32 nameOffset;
+        quint32 nameLength;
+    };
+    typedef QPair<quint32, QString> Key;
+
+    mutable QReadWriteLock m_lock;
+    QVector<Directory> m_directories;
+    QHash<Key, quint32> m_directoryIds;
+    QVector<File> m_files;
+    QByteArray m_names;
+    // the numbers of the files by the hash of their directory and name, with 0 for an empty slot;
+    // the size is a power of two, and at most half of the slots are used:
+    QVector<quint32> m_fileSlots;
+};
+
+}
+
+#endif /* DB_PATHTRIE_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
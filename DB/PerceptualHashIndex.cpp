@@ -0,0 +1,123 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "PerceptualHashIndex.h"
+
+#include <Utilities/PerceptualHash.h>
+
+#include <algorithm>
+#include <numeric>
+
+DB::PerceptualHashIndex::PerceptualHashIndex( const QVector<quint64>& hashes )
+    : m_hashes( hashes )
+{
+    const int buckets = 1 << CHUNK_BITS;
+    for ( int table = 0; table < CHUNKS; ++table ) {
+        // counting sort of the indices by their chunk:
+        QVector<int>& start = m_bucketStart[table];
+        start.fill( 0, buckets + 1 );
+        for ( quint64 hash : m_hashes ) {
+            if ( hash != 0 )
+                ++start[chunk( hash, table ) + 1];
+        }
+        std::partial_sum( start.begin(), start.end(), start.begin() );
+
+        QVector<int>& items = m_items[table];
+        items.resize( start[buckets] );
+        QVector<int> next( start );
+        for ( int index = 0; index < m_hashes.size(); ++index ) {
+            if ( m_hashes[index] != 0 )
+                items[next[chunk( m_hashes[index], table )]++] = index;
+        }
+    }
+}
+
+QVector<int> DB::PerceptualHashIndex::neighbours( int index, int maxDistance ) const
+{
+    QVector<int> result;
+    const quint64 hash = m_hashes[index];
+    if ( hash == 0 )
+        return result;
+
+    const int maxChunkDistance = maxDistance / CHUNKS;
+    Q_ASSERT( maxChunkDistance <= 2 );
+    for ( int table = 0; table < CHUNKS; ++table ) {
+        const int key = chunk( hash, table );
+        collectBucket( table, key, index, maxDistance, maxChunkDistance, result );
+
+        // all chunk values within maxChunkDistance bits of key; that is at most two for any sensible distance:
+        for ( int bit1 = 0; bit1 < CHUNK_BITS && maxChunkDistance >= 1; ++bit1 ) {
+            collectBucket( table, key ^ ( 1 << bit1 ), index, maxDistance, maxChunkDistance, result );
+            for ( int bit2 = bit1 + 1; bit2 < CHUNK_BITS && maxChunkDistance >= 2; ++bit2 )
+                collectBucket( table, key ^ ( 1 << bit1 ) ^ ( 1 << bit2 ), index, maxDistance, maxChunkDistance, result );
+        }
+    }
+    return result;
+}
+
+void DB::PerceptualHashIndex::collectBucket( int table, int key, int index, int maxDistance, int maxChunkDistance, QVector<int>& result ) const
+{
+    const quint64 hash = m_hashes[index];
+    const int* it = m_items[table].constData() + m_bucketStart[table][key];
+    const int* end = m_items[table].constData() + m_bucketStart[table][key + 1];
+    for ( ; it != end; ++it ) {
+        const int candidate = *it;
+        if ( candidate == index )
+            continue;
+        const quint64 other = m_hashes[candidate];
+        if ( Utilities::hammingDistance( hash, other ) > maxDistance )
+            continue;
+
+        // A close hash is found through every table where its chunk is close enough.
+        // Only count it in the first of those tables.
+        bool foundBefore = false;
+        for ( int earlier = 0; earlier < table && !foundBefore; ++earlier )
+            foundBefore = qPopulationCount( quint16( chunk( hash, earlier ) ^ chunk( other, earlier ) ) ) <= maxChunkDistance;
+        if ( !foundBefore )
+            result.append( candidate );
+    }
+}
+
+QList<QVector<int>> DB::PerceptualHashIndex::clusters( int maxDistance ) const
+{
+    // Being close is not transitive: a chain of small differences may connect two images that
+    // don't look alike at all. So every group is built around one hash, and only holds hashes close to that one.
+    QVector<bool> grouped( m_hashes.size(), false );
+    QList<QVector<int>> groups;
+    for ( int anchor = 0; anchor < m_hashes.size(); ++anchor ) {
+        if ( grouped[anchor] || m_hashes[anchor] == 0 )
+            continue;
+
+        QVector<int> group;
+        group.append( anchor );
+        for ( int neighbour : neighbours( anchor, maxDistance ) ) {
+            if ( !grouped[neighbour] )
+                group.append( neighbour );
+        }
+        if ( group.size() < 2 )
+            continue;
+
+        std::sort( group.begin() + 1, group.end() );
+        for ( int index : group )
+            grouped[index] = true;
+        groups.append( group );
+    }
+    return groups;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,74 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef DB_PERCEPTUALHASHINDEX_H
+#define DB_PERCEPTUALHASHINDEX_H
+
+#include <QList>
+#include <QVector>
+
+namespace DB
+{
+
+/**
+ * \brief Find the perceptual hashes that are close to each other, without comparing all pairs.
+ *
+ * This is multi-index hashing: every 64 bit hash is split into four 16 bit chunks, and there is
+ * one table per chunk. If two hashes differ in at most \c d bits, then at least one of their chunks
+ * differs in at most <tt>d / 4</tt> bits. So only the hashes in the buckets of the chunk values
+ * near the ones of the hash we look for need to be compared.
+ *
+ * Hashes are referred to by their index in the vector the index was built from.
+ * A hash of 0 means unknown, and is never close to anything.
+ */
+class PerceptualHashIndex
+{
+public:
+    explicit PerceptualHashIndex( const QVector<quint64>& hashes );
+
+    /**
+     * @return the indices of all hashes that differ from the hash at \p index in at most
+     * \p maxDistance bits, not counting \p index itself. \p maxDistance must be less than 12.
+     */
+    QVector<int> neighbours( int index, int maxDistance ) const;
+
+    /**
+     * @return groups of indices, each made of an anchor, which comes first, and the indices
+     * of the hashes that differ from the hash of the anchor in at most \p maxDistance bits.
+     * No index is in more than one group, and groups of one are left out.
+     */
+    QList<QVector<int>> clusters( int maxDistance ) const;
+
+private:
+    static constexpr int CHUNKS = 4;
+    static constexpr int CHUNK_BITS = 16;
+
+    static int chunk( quint64 hash, int table ) { return int( ( hash >> ( table * CHUNK_BITS ) ) & 0xFFFF ); }
+    void collectBucket( int table, int key, int index, int maxDistance, int maxChunkDistance, QVector<int>& result ) const;
+
+    QVector<quint64> m_hashes;
+    // m_items[table] holds the indices sorted by their chunk in that table,
+    // and the indices with chunk value k start at m_bucketStart[table][k]:
+    QVector<int> m_bucketStart[CHUNKS];
+    QVector<int> m_items[CHUNKS];
+};
+
+}
+
+#endif /* DB_PERCEPTUALHASHINDEX_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,368 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "SearchPlan.h"
+
+#include "AndCategoryMatcher.h"
+#include "ExactCategoryMatcher.h"
+#include "ImageInfo.h"
+#include "ImageSearchInfo.h"
+#include "Logging.h"
+#include "NegationCategoryMatcher.h"
+#include "NoTagCategoryMatcher.h"
+#include "OrCategoryMatcher.h"
+#include "ValueCategoryMatcher.h"
+
+#include <Exif/SearchInfo.h>
+#include <ImageManager/RawImageDecoder.h>
+
+#include <algorithm>
+
+namespace
+{
+constexpr int MAX_TAGS_PER_TERM = 64;
+}
+
+DB::SearchPlan::SearchPlan( const ImageSearchInfo& info, const QList<QPair<QString, CategoryMatcher*>>& categoryMatchers )
+    : m_dateStart( info.m_date.start() )
+    , m_dateEnd( info.m_date.end() )
+    , m_rating( info.m_rating )
+    , m_ratingSearchMode( info.m_ratingSearchMode )
+    , m_megapixel( info.m_megapixel )
+    , m_maxMegapixel( info.m_max_megapixel )
+    , m_exifSearchInfo( &info.m_exifSearchInfo )
+    , m_label( info.m_label )
+    , m_descriptionWords( info.m_description.split( QChar::fromLatin1(' '), QString::SkipEmptyParts ) )
+    , m_fnPattern( info.m_fnPattern )
+{
+    // -------------------------------------------------- Cheap comparisons first
+    if ( !m_dateStart.isNull() || !m_dateEnd.isNull() )
+        m_steps.append( { StepType::Date, -1 } );
+    if ( m_rating != -1 )
+        m_steps.append( { StepType::Rating, -1 } );
+    if ( m_megapixel )
+        m_steps.append( { StepType::MinMegaPixel, -1 } );
+    if ( m_maxMegapixel && m_maxMegapixel > m_megapixel )
+        m_steps.append( { StepType::MaxMegaPixel, -1 } );
+#ifdef HAVE_KGEOMAP
+    if ( info.m_usingRegionSelection ) {
+        m_regionMinLat = info.m_regionSelectionMinLat;
+        m_regionMaxLat = info.m_regionSelectionMaxLat;
+        m_regionMinLon = info.m_regionSelectionMinLon;
+        m_regionMaxLon = info.m_regionSelectionMaxLon;
+        m_steps.append( { StepType::Region, -1 } );
+    }
+#endif
+    m_steps.append( { StepType::Exif, -1 } );
+
+    // -------------------------------------------------- Categories, most selective first
+    for ( const auto& categoryMatcher : categoryMatchers ) {
+        CategoryCondition condition;
+        condition.category = categoryMatcher.first;
+        if ( !lowerCondition( categoryMatcher.second, &condition ) ) {
+            qCDebug(DBCategoryMatcherLog) << "Using the category matcher for category" << condition.category;
+            condition.terms.clear();
+            condition.matcher = categoryMatcher.second;
+            condition.estimate = 1.0;
+        }
+        m_conditions.append( condition );
+    }
+    QVector<int> order( m_conditions.size() );
+    for ( int i = 0; i < order.size(); ++i )
+        order[i] = i;
+    std::stable_sort( order.begin(), order.end(), [this]( int a, int b ) {
+        // conditions that could not be lowered go last, as they are the most expensive ones
+        if ( ( m_conditions[a].matcher == nullptr ) != ( m_conditions[b].matcher == nullptr ) )
+            return m_conditions[a].matcher == nullptr;
+        return m_conditions[a].estimate < m_conditions[b].estimate;
+    });
+    for ( int index : order )
+        m_steps.append( { m_conditions[index].matcher ? StepType::Matcher : StepType::Category, index } );
+
+    // -------------------------------------------------- String searches last
+    if ( !m_label.isEmpty() )
+        m_steps.append( { StepType::Label, -1 } );
+    if ( info.m_searchRAW ) {
+        // initializes the list of RAW file extensions, before match may be called from other threads:
+        ImageManager::RAWImageDecoder::rawExtensions();
+        m_steps.append( { StepType::RAW, -1 } );
+    }
+    if ( !m_descriptionWords.isEmpty() )
+        m_steps.append( { StepType::Description, -1 } );
+    if ( !m_fnPattern.isEmpty() )
+        m_steps.append( { StepType::FileNamePattern, -1 } );
+}
+
+bool DB::SearchPlan::match( const ImageInfoPtr& info ) const
+{
+    for ( const Step& step : m_steps ) {
+        if ( !matchStep( step, info ) )
+            return false;
+    }
+    return true;
+}
+
+bool DB::SearchPlan::canMatchConcurrently() const
+{
+    for ( const Step& step : m_steps ) {
+        if ( step.type == StepType::Region )
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Lower the matcher ImageSearchInfo::compile created for one category.
+ * It is either a single term, or an OrCategoryMatcher of terms.
+ * @return \c false if the matcher can not be expressed as terms.
+ */
+bool DB::SearchPlan::lowerCondition( CategoryMatcher* matcher, CategoryCondition* condition )
+{
+    QList<CategoryMatcher*> terms;
+    if ( OrCategoryMatcher* orMatcher = dynamic_cast<OrCategoryMatcher*>( matcher ) )
+        terms = orMatcher->mp_elements;
+    else
+        terms.append( matcher );
+
+    double sum = 0;
+    for ( CategoryMatcher* termMatcher : terms ) {
+        Term term;
+        if ( !lowerTerm( termMatcher, &term ) )
+            return false;
+        sum += estimate( term );
+        condition->terms.append( term );
+    }
+    condition->estimate = qMin( sum, 1.0 );
+    return true;
+}
+
+bool DB::SearchPlan::lowerTerm( CategoryMatcher* matcher, Term* term )
+{
+    if ( const ValueCategoryMatcher* valueMatcher = dynamic_cast<ValueCategoryMatcher*>( matcher ) )
+        return addTag( valueMatcher, false, term );
+
+    if ( NegationCategoryMatcher* negationMatcher = dynamic_cast<NegationCategoryMatcher*>( matcher ) ) {
+        if ( const ValueCategoryMatcher* valueMatcher = dynamic_cast<ValueCategoryMatcher*>( negationMatcher->child() ) )
+            return addTag( valueMatcher, true, term );
+        if ( !lowerTerm( negationMatcher->child(), term ) )
+            return false;
+        term->negated = !term->negated;
+        return true;
+    }
+
+    if ( dynamic_cast<NoTagCategoryMatcher*>( matcher ) ) {
+        term->noTags = true;
+        return true;
+    }
+
+    if ( ExactCategoryMatcher* exactMatcher = dynamic_cast<ExactCategoryMatcher*>( matcher ) ) {
+        // ImageSearchInfo::compile only creates exact matchers for tags, negated tags or a conjunction of them.
+        if ( !exactMatcher->matcher() || dynamic_cast<ExactCategoryMatcher*>( exactMatcher->matcher() ) )
+            return false;
+        term->exact = true;
+        return lowerTerm( exactMatcher->matcher(), term ) && !term->negated && !term->noTags;
+    }
+
+    if ( AndCategoryMatcher* andMatcher = dynamic_cast<AndCategoryMatcher*>( matcher ) ) {
+        for ( CategoryMatcher* element : andMatcher->mp_elements ) {
+            const bool isTag = dynamic_cast<ValueCategoryMatcher*>( element ) != nullptr;
+            NegationCategoryMatcher* negation = dynamic_cast<NegationCategoryMatcher*>( element );
+            const bool isNegatedTag = negation && dynamic_cast<ValueCategoryMatcher*>( negation->child() );
+            if ( !( isTag || isNegatedTag ) || !lowerTerm( element, term ) )
+                return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+bool DB::SearchPlan::addTag( const ValueCategoryMatcher* matcher, bool negated, Term* term )
+{
+    if ( term->tagCount == MAX_TAGS_PER_TERM )
+        return false;
+
+    const quint64 bit = quint64(1) << term->tagCount++;
+    TagBits& tagBits = term->tags[matcher->m_option];
+    tagBits.satisfies |= bit;
+    tagBits.is |= bit;
+    for ( const QString& member : matcher->m_members )
+        term->tags[member].satisfies |= bit;
+
+    if ( negated )
+        term->forbidden |= bit;
+    else
+        term->required |= bit;
+    return true;
+}
+
+/**
+ * A rough guess of the fraction of images matched by \p term, only used for ordering the conditions.
+ * It assumes that a tag is on 5% of the images, and that a tag with members is on the images of each member as well.
+ */
+double DB::SearchPlan::estimate( const Term& term )
+{
+    double result = term.noTags ? 0.5 : 1.0;
+    for ( int i = 0; i < term.tagCount; ++i ) {
+        const quint64 bit = quint64(1) << i;
+        int satisfiedBy = 0;
+        for ( const TagBits& tagBits : term.tags ) {
+            if ( tagBits.satisfies & bit )
+                ++satisfiedBy;
+        }
+        const double fraction = qMin( 0.05 * satisfiedBy, 1.0 );
+        result *= ( term.forbidden & bit ) ? 1.0 - fraction : fraction;
+    }
+    if ( term.exact )
+        result *= 0.5;
+    return term.negated ? 1.0 - result : result;
+}
+
+bool DB::SearchPlan::matchStep( const Step& step, const ImageInfoPtr& info ) const
+{
+    switch ( step.type ) {
+    case StepType::Date:
+        return matchDate( info );
+    case StepType::Rating:
+        return matchRating( info );
+    case StepType::MinMegaPixel:
+        return m_megapixel * 1000000 <= info->size().width() * info->size().height();
+    case StepType::MaxMegaPixel:
+        return m_maxMegapixel * 1000000 > info->size().width() * info->size().height();
+    case StepType::Region:
+#ifdef HAVE_KGEOMAP
+    {
+        if ( !info->coordinates().hasCoordinates() )
+            return false;
+        const float infoLat = info->coordinates().lat();
+        const float infoLon = info->coordinates().lon();
+        return m_regionMinLat <= infoLat && infoLat <= m_regionMaxLat
+                && m_regionMinLon <= infoLon && infoLon <= m_regionMaxLon;
+    }
+#else
+        return true;
+#endif
+    case StepType::Exif:
+        return m_exifSearchInfo->matches( info->fileName() );
+    case StepType::Category:
+    {
+        const CategoryCondition& condition = m_conditions[step.condition];
+        const StringSet items = info->itemsOfCategory( condition.category );
+        for ( const Term& term : condition.terms ) {
+            if ( matchTerm( term, items ) )
+                return true;
+        }
+        return false;
+    }
+    case StepType::Matcher:
+    {
+        QMap<QString, StringSet> alreadyMatched;
+        return m_conditions[step.condition].matcher->eval( info, alreadyMatched );
+    }
+    case StepType::Label:
+        return info->label().indexOf( m_label ) != -1;
+    case StepType::RAW:
+        return ImageManager::RAWImageDecoder::isRAW( info->fileName() );
+    case StepType::Description:
+    {
+        const QString txt = info->description();
+        for ( const QString& word : m_descriptionWords ) {
+            if ( txt.indexOf( word, 0, Qt::CaseInsensitive ) == -1 )
+                return false;
+        }
+        return true;
+    }
+    case StepType::FileNamePattern:
+    {
+        // QRegExp stores the state of the last match, so every thread uses a copy of its own:
+        thread_local QRegExp pattern;
+        if ( pattern != m_fnPattern )
+            pattern = m_fnPattern;
+        return pattern.indexIn( info->fileName().relative() ) != -1;
+    }
+    }
+    return true;
+}
+
+bool DB::SearchPlan::matchDate( const ImageInfoPtr& info ) const
+{
+    QDateTime actualStart = info->date().start();
+    QDateTime actualEnd = info->date().end();
+    if ( actualEnd <= actualStart )
+        std::swap( actualStart, actualEnd );
+
+    if ( !m_dateStart.isNull() ) {
+        // the search date matches the actual date if:
+        // actual.start <= search.start <= actuel.end or
+        // actual.start <= search.end <=actuel.end or
+        // search.start <= actual.start and actual.end <= search.end
+        const bool b1 = ( actualStart <= m_dateStart && m_dateStart <= actualEnd );
+        const bool b2 = ( actualStart <= m_dateEnd && m_dateEnd <= actualEnd );
+        const bool b3 = ( m_dateStart <= actualStart && ( actualEnd <= m_dateEnd || m_dateEnd.isNull() ) );
+        return b1 || b2 || b3;
+    }
+
+    const bool b1 = ( actualStart <= m_dateEnd && m_dateEnd <= actualEnd );
+    const bool b2 = ( actualEnd <= m_dateEnd );
+    return b1 || b2;
+}
+
+bool DB::SearchPlan::matchRating( const ImageInfoPtr& info ) const
+{
+    switch( m_ratingSearchMode ) {
+    case 1:
+        // Image rating at least selected
+        return m_rating <= info->rating();
+    case 2:
+        // Image rating less than selected
+        return m_rating >= info->rating();
+    case 3:
+        // Image rating not equal
+        return m_rating != info->rating();
+    default:
+        return m_rating == info->rating();
+    }
+}
+
+bool DB::SearchPlan::matchTerm( const Term& term, const StringSet& items )
+{
+    bool ok;
+    if ( term.noTags ) {
+        ok = items.isEmpty();
+    } else {
+        quint64 satisfied = 0;
+        // for "no other": every tag of the image must be one of the tags of the term
+        bool onlyTermTags = true;
+        for ( const QString& item : items ) {
+            const auto it = term.tags.constFind( item );
+            if ( it == term.tags.constEnd() ) {
+                onlyTermTags = false;
+                continue;
+            }
+            satisfied |= it->satisfies;
+            if ( it->is == 0 )
+                onlyTermTags = false;
+        }
+        ok = ( satisfied & term.required ) == term.required
+                && ( satisfied & term.forbidden ) == 0
+                && ( !term.exact || onlyTermTags );
+    }
+    return ok != term.negated;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,150 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef SEARCHPLAN_H
+#define SEARCHPLAN_H
+#include <config-kpa-kgeomap.h>
+
+#include "ImageInfoPtr.h"
+
+#include <Utilities/StringSet.h>
+
+#include <QDateTime>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QRegExp>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace Exif
+{
+class SearchInfo;
+}
+
+namespace DB
+{
+class CategoryMatcher;
+class ImageSearchInfo;
+class ValueCategoryMatcher;
+using Utilities::StringSet;
+
+/**
+ * \brief Flat, precompiled form of an ImageSearchInfo, used by ImageSearchInfo::match.
+ *
+ * The plan is a list of steps, all of which must match an image. The steps are ordered so that
+ * comparisons of numbers (date, rating, resolution, position) come first. The Exif search result
+ * comes next, followed by the category conditions, ordered by a rough estimate of how many images
+ * they let through. Searches in the label, description and file name come last.
+ *
+ * A category condition is a disjunction of terms, each of which is a conjunction of (possibly negated)
+ * tags, optionally with "no other" tags. The tags of a term are numbered, and every tag relevant for the
+ * term maps to a bit mask of the tags it satisfies (being the tag or one of its members).
+ * Evaluating a term is then one hash lookup per tag of the image, and a comparison of bit masks,
+ * instead of evaluating a tree of CategoryMatchers.
+ * Conditions the plan can not express this way are evaluated by their CategoryMatcher.
+ *
+ * The plan refers to the matchers and the Exif::SearchInfo of the ImageSearchInfo it was created from,
+ * and is deleted along with them. It does not change while matching.
+ */
+class SearchPlan
+{
+public:
+    SearchPlan( const ImageSearchInfo& info, const QList<QPair<QString, CategoryMatcher*>>& categoryMatchers );
+
+    bool match( const ImageInfoPtr& info ) const;
+    /**
+     * @return \c true if match may be called from several threads at once.
+     * This is not the case when searching for a region, as the coordinates of an image are read from
+     * the Exif database when needed.
+     */
+    bool canMatchConcurrently() const;
+
+private:
+    enum class StepType {
+        Date, Rating, MinMegaPixel, MaxMegaPixel, Region, Exif,
+        Category, Matcher,
+        Label, RAW, Description, FileNamePattern
+    };
+    struct Step {
+        StepType type;
+        // index into m_conditions for Category and Matcher steps
+        int condition;
+    };
+
+    struct TagBits {
+        // the tags of the term that are satisfied by the tag
+        quint64 satisfies = 0;
+        // the tags of the term that are this very tag
+        quint64 is = 0;
+    };
+    struct Term {
+        quint64 required = 0;
+        quint64 forbidden = 0;
+        int tagCount = 0;
+        QHash<QString, TagBits> tags;
+        // the image may not have any tags except the ones of the term ("None" as in "no other")
+        bool exact = false;
+        // the image may not have any tags at all ("None" on its own)
+        bool noTags = false;
+        bool negated = false;
+    };
+    struct CategoryCondition {
+        QString category;
+        QVector<Term> terms;
+        // used if the condition could not be expressed by terms:
+        CategoryMatcher* matcher = nullptr;
+        double estimate = 1.0;
+    };
+
+    static bool lowerCondition( CategoryMatcher* matcher, CategoryCondition* condition );
+    static bool lowerTerm( CategoryMatcher* matcher, Term* term );
+    static bool addTag( const ValueCategoryMatcher* matcher, bool negated, Term* term );
+    static double estimate( const Term& term );
+
+    bool matchStep( const Step& step, const ImageInfoPtr& info ) const;
+    bool matchDate( const ImageInfoPtr& info ) const;
+    bool matchRating( const ImageInfoPtr& info ) const;
+    static bool matchTerm( const Term& term, const StringSet& items );
+
+    QVector<Step> m_steps;
+    QVector<CategoryCondition> m_conditions;
+
+    QDateTime m_dateStart;
+    QDateTime m_dateEnd;
+    short m_rating;
+    int m_ratingSearchMode;
+    short m_megapixel;
+    short m_maxMegapixel;
+    const Exif::SearchInfo* m_exifSearchInfo;
+    QString m_label;
+    QStringList m_descriptionWords;
+    QRegExp m_fnPattern;
+#ifdef HAVE_KGEOMAP
+    float m_regionMinLat;
+    float m_regionMaxLat;
+    float m_regionMinLon;
+    float m_regionMaxLon;
+#endif
+};
+
+}
+
+#endif /* SEARCHPLAN_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -35,11 +35,10 @@ DB::ValueCategoryMatcher::ValueCategoryMatcher( const QString& category, const Q
     m_option = unEscapedValue;
 
     const MemberMap& map = DB::ImageDB::instance()->memberMap();
-    const QStringList members = map.members(m_category, m_option, true);
-    m_members = members.toSet();
+    m_members = map.compiled(m_category)->members(m_option);
 }
 
-bool DB::ValueCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched)
+bool DB::ValueCategoryMatcher::eval(ImageInfoPtr info, QMap<QString, StringSet>& alreadyMatched) const
 {
     // Only add the tag _option to the alreadyMatched tags,
     // and omit the tags in _members
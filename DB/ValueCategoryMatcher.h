@@ -28,7 +28,7 @@ class ValueCategoryMatcher :public SimpleCategoryMatcher
 {
 public:
     ValueCategoryMatcher( const QString& category, const QString& value );
-    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) override;
+    bool eval(ImageInfoPtr, QMap<QString, StringSet>& alreadyMatched) const override;
     void debug( int level ) const override;
 
     QString m_option;
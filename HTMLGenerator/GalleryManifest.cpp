@@ -0,0 +1,156 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "GalleryManifest.h"
+#include "Logging.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+
+namespace
+{
+constexpr int MANIFEST_VERSION = 1;
+}
+
+bool HTMLGenerator::ManifestEntry::operator==( const ManifestEntry& other ) const
+{
+    return source == other.source
+            && md5 == other.md5
+            && angle == other.angle
+            && size == other.size
+            && checksum == other.checksum;
+}
+
+QString HTMLGenerator::GalleryManifest::manifestFileName()
+{
+    return QString::fromLatin1( ".kphotoalbum-gallery.xml" );
+}
+
+bool HTMLGenerator::GalleryManifest::exists( const QDir& galleryDir )
+{
+    return galleryDir.exists( manifestFileName() );
+}
+
+bool HTMLGenerator::GalleryManifest::load( const QDir& galleryDir )
+{
+    m_entries.clear();
+
+    QFile file( galleryDir.filePath( manifestFileName() ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QXmlStreamReader reader( &file );
+    if ( !reader.readNextStartElement() || reader.name() != QLatin1String( "gallery-manifest" ) )
+        return false;
+    if ( reader.attributes().value( QLatin1String( "version" ) ).toInt() != MANIFEST_VERSION ) {
+        qCDebug(HTMLGeneratorLog) << "Ignoring gallery manifest with unknown version in" << galleryDir.path();
+        return false;
+    }
+
+    while ( reader.readNextStartElement() ) {
+        if ( reader.name() == QLatin1String( "file" ) ) {
+            const QXmlStreamAttributes attributes = reader.attributes();
+            ManifestEntry entry;
+            entry.source = attributes.value( QLatin1String( "source" ) ).toString();
+            entry.md5 = attributes.value( QLatin1String( "md5" ) ).toString();
+            entry.angle = attributes.value( QLatin1String( "angle" ) ).toInt();
+            entry.size = attributes.value( QLatin1String( "size" ) ).toInt();
+            entry.checksum = attributes.value( QLatin1String( "checksum" ) ).toString();
+            m_entries.insert( attributes.value( QLatin1String( "name" ) ).toString(), entry );
+        }
+        reader.skipCurrentElement();
+    }
+
+    if ( reader.hasError() ) {
+        qCWarning(HTMLGeneratorLog) << "Error reading gallery manifest:" << reader.errorString();
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+bool HTMLGenerator::GalleryManifest::save( const QDir& galleryDir ) const
+{
+    QSaveFile file( galleryDir.filePath( manifestFileName() ) );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    QXmlStreamWriter writer( &file );
+    writer.setAutoFormatting( true );
+    writer.writeStartDocument();
+    writer.writeStartElement( QString::fromLatin1( "gallery-manifest" ) );
+    writer.writeAttribute( QString::fromLatin1( "version" ), QString::number( MANIFEST_VERSION ) );
+    for ( auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it ) {
+        const ManifestEntry& entry = it.value();
+        writer.writeStartElement( QString::fromLatin1( "file" ) );
+        writer.writeAttribute( QString::fromLatin1( "name" ), it.key() );
+        if ( !entry.source.isEmpty() ) {
+            writer.writeAttribute( QString::fromLatin1( "source" ), entry.source );
+            writer.writeAttribute( QString::fromLatin1( "md5" ), entry.md5 );
+            writer.writeAttribute( QString::fromLatin1( "angle" ), QString::number( entry.angle ) );
+            writer.writeAttribute( QString::fromLatin1( "size" ), QString::number( entry.size ) );
+        }
+        writer.writeAttribute( QString::fromLatin1( "checksum" ), entry.checksum );
+        writer.writeEndElement();
+    }
+    writer.writeEndElement();
+    writer.writeEndDocument();
+
+    return file.commit();
+}
+
+void HTMLGenerator::GalleryManifest::insert( const QString& fileName, const ManifestEntry& entry )
+{
+    m_entries.insert( fileName, entry );
+}
+
+void HTMLGenerator::GalleryManifest::remove( const QString& fileName )
+{
+    m_entries.remove( fileName );
+}
+
+bool HTMLGenerator::GalleryManifest::contains( const QString& fileName ) const
+{
+    return m_entries.contains( fileName );
+}
+
+bool HTMLGenerator::GalleryManifest::isUpToDate( const QString& fileName, const ManifestEntry& entry ) const
+{
+    if ( !entry.source.isEmpty() && entry.md5.isEmpty() )
+        return false;
+    if ( entry.source.isEmpty() && entry.checksum.isEmpty() )
+        return false;
+
+    const auto it = m_entries.constFind( fileName );
+    return it != m_entries.constEnd() && it.value() == entry;
+}
+
+QStringList HTMLGenerator::GalleryManifest::filesMissingIn( const GalleryManifest& current ) const
+{
+    QStringList result;
+    for ( auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it ) {
+        if ( !current.contains( it.key() ) )
+            result.append( it.key() );
+    }
+    return result;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
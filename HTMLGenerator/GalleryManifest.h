@@ -0,0 +1,88 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef HTMLGENERATOR_GALLERYMANIFEST_H
+#define HTMLGENERATOR_GALLERYMANIFEST_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+class QDir;
+
+namespace HTMLGenerator
+{
+
+/**
+ * \brief Description of how a single file of a generated gallery was produced.
+ *
+ * For scaled images and videos, the entry records the source image, its MD5 sum, angle and the
+ * requested size, as well as a checksum of the metadata that was written into the file.
+ * For pages, only the checksum of the written content is used.
+ */
+struct ManifestEntry {
+    QString source;
+    QString md5;
+    int angle = 0;
+    int size = 0;
+    QString checksum;
+
+    bool operator==( const ManifestEntry& other ) const;
+    bool operator!=( const ManifestEntry& other ) const { return !( *this == other ); }
+};
+
+/**
+ * \brief List of all files the HTMLGenerator::Generator wrote into a gallery.
+ *
+ * The manifest is stored inside the gallery directory. When a gallery is generated again into the
+ * same directory, files with an unchanged entry are not generated again, and files that are no
+ * longer part of the gallery are deleted.
+ *
+ * File names are relative to the gallery directory.
+ */
+class GalleryManifest
+{
+public:
+    static QString manifestFileName();
+    static bool exists( const QDir& galleryDir );
+
+    bool load( const QDir& galleryDir );
+    bool save( const QDir& galleryDir ) const;
+
+    void insert( const QString& fileName, const ManifestEntry& entry );
+    void remove( const QString& fileName );
+    bool contains( const QString& fileName ) const;
+    /**
+     * @return \c true if the manifest contains the file with exactly the given entry.
+     * Entries without a checksum or MD5 sum are never considered up to date.
+     */
+    bool isUpToDate( const QString& fileName, const ManifestEntry& entry ) const;
+
+    /**
+     * @return all files in this manifest that are not in \p current.
+     */
+    QStringList filesMissingIn( const GalleryManifest& current ) const;
+
+private:
+    QHash<QString, ManifestEntry> m_entries;
+};
+
+}
+
+#endif /* HTMLGENERATOR_GALLERYMANIFEST_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -24,11 +24,14 @@
 
 #include <QFile>
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QList>
 #include <QDir>
 #include <QDomDocument>
 #include <QMimeDatabase>
 #include <QStandardPaths>
+#include <QThread>
+#include <QUrl>
 
 #include <KConfig>
 #include <KConfigGroup>
@@ -45,15 +48,28 @@
 #include <ImportExport/Export.h>
 #include <Utilities/Util.h>
 
+#include "ImageScaleTask.h"
 #include "ImageSizeCheckBox.h"
 #include "Setup.h"
 #include "MainWindow/Window.h"
 
+namespace
+{
+QString checksum( const QByteArray& data )
+{
+    return QString::fromLatin1( QCryptographicHash::hash( data, QCryptographicHash::Md5 ).toHex() );
+}
+}
+
 HTMLGenerator::Generator::Generator( const Setup& setup, QWidget* parent )
     : QProgressDialog( parent )
     , m_tempDirHandle()
-    , m_tempDir(m_tempDirHandle.path())
+    , m_targetDir(m_tempDirHandle.path())
+    , m_writeDirectly( false )
+    , m_isUpdate( false )
+    , m_galleryCompleted( false )
     , m_hasEnteredLoop( false )
+    , m_cancelScaling( 0 )
 {
     setLabelText( i18n("Generating images for HTML page ") );
     m_setup = setup;
@@ -62,11 +78,34 @@ HTMLGenerator::Generator::Generator( const Setup& setup, QWidget* parent )
     if ( m_avconv.isNull() )
         m_avconv = QStandardPaths::findExecutable(QString::fromUtf8("ffmpeg"));
     m_tempDirHandle.setAutoRemove(true);
+
+    // Local galleries are written in place. Only remote destinations are staged in the
+    // temporary directory and moved over using KIO once everything is generated.
+    const QUrl outputURL = QUrl::fromUserInput( m_setup.baseDir() + QString::fromLatin1( "/" ) + m_setup.outputDir() );
+    if ( outputURL.isLocalFile() && QDir().mkpath( outputURL.toLocalFile() ) ) {
+        m_targetDir = QDir( outputURL.toLocalFile() );
+        m_writeDirectly = true;
+        m_isUpdate = m_previousManifest.load( m_targetDir );
+    }
+
+    // Unlike the AsyncLoader, we do not need to spare a core for the GUI, as it is only showing a progress bar.
+    m_scalePool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() ) );
+    qRegisterMetaType<DB::FileName>();
 }
 
 HTMLGenerator::Generator::~Generator()
 {
+    // the scale tasks reference m_cancelScaling and call back into this object
+    m_cancelScaling.store( 1 );
+    m_scalePool.clear();
+    m_scalePool.waitForDone();
     delete m_eventLoop;
+
+    if ( m_isUpdate && !m_galleryCompleted ) {
+        // Keep what is still valid from the last run, so that the next update
+        // does not need to start from scratch.
+        m_previousManifest.save( m_targetDir );
+    }
 }
 void HTMLGenerator::Generator::generate()
 {
@@ -153,6 +192,10 @@ void HTMLGenerator::Generator::generate()
     if ( wasCanceled() )
         return;
 
+    qCDebug(HTMLGeneratorLog) << "Scaling images...";
+    if ( !startImageScaling() )
+        return;
+
     if ( m_waitCounter > 0 ) {
         m_hasEnteredLoop = true;
         m_eventLoop->exec();
@@ -183,7 +226,7 @@ void HTMLGenerator::Generator::generate()
             *it == QString::fromLatin1("mainpage.html") ||
             *it == QString::fromLatin1("imagepage.html")) continue;
         QString from = QString::fromLatin1("%1%2").arg( themeDir ).arg(*it);
-        QString to = m_tempDir.filePath(*it);
+        QString to = m_targetDir.filePath(*it);
         bool ok = Utilities::copy( from, to );
         if ( !ok ) {
             KMessageBox::error( this, i18n("Error copying %1 to %2", from , to ) );
@@ -192,10 +235,16 @@ void HTMLGenerator::Generator::generate()
     }
 
 
+    if ( m_writeDirectly ) {
+        finishManifest();
+        showBrowser();
+        return;
+    }
+
     // Copy files over to destination.
     QString outputDir = m_setup.baseDir() + QString::fromLatin1( "/" ) + m_setup.outputDir();
-    qCDebug(HTMLGeneratorLog) << "Copying files from" << m_tempDir.path() << "to final location"<< outputDir<<"...";
-    KIO::CopyJob* job = KIO::move( QUrl::fromLocalFile( m_tempDir.path() ), QUrl::fromUserInput(outputDir) );
+    qCDebug(HTMLGeneratorLog) << "Copying files from" << m_targetDir.path() << "to final location"<< outputDir<<"...";
+    KIO::CopyJob* job = KIO::move( QUrl::fromLocalFile( m_targetDir.path() ), QUrl::fromUserInput(outputDir) );
     connect(job, &KIO::CopyJob::result, this, &Generator::showBrowser);
 
     m_eventLoop->exec();
@@ -405,7 +454,7 @@ bool HTMLGenerator::Generator::generateIndexPage( int width, int height )
         return false;
 
     // -------------------------------------------------- write to file
-    QString fileName = m_tempDir.filePath(
+    QString fileName = m_targetDir.filePath(
                 QString::fromLatin1("index-%1.html" )
                        .arg(ImageSizeCheckBox::text(width,height,true))
                 );
@@ -583,7 +632,7 @@ bool HTMLGenerator::Generator::generateContentPage( int width, int height,
 
     // -------------------------------------------------- write to file
     if(m_setup.generateHTMLImageFile()){
-        QString fileName = m_tempDir.filePath(namePage( width, height, currentFile ));
+        QString fileName = m_targetDir.filePath(namePage( width, height, currentFile ));
         bool ok = writeToFile( fileName, content );
         if ( !ok ){
             qCDebug(HTMLGeneratorLog) << "generateContentPage : can't write to file";
@@ -648,20 +697,123 @@ QString HTMLGenerator::Generator::nameImage( const DB::FileName& fileName, int s
 
 QString HTMLGenerator::Generator::createImage( const DB::FileName& fileName, int size )
 {
-    DB::ImageInfoPtr info = fileName.info();
+    const QString imageName = nameImage( fileName, size );
     if ( m_generatedFiles.contains( qMakePair(fileName,size) ) ) {
         m_waitCounter--;
+        return imageName;
     }
-    else {
+    m_generatedFiles.insert( qMakePair( fileName, size ) );
+
+    const QString targetFile = QString::fromLatin1( "%1/%2" ).arg( folderImage( size ) ).arg( imageName );
+    const ManifestEntry entry = manifestEntry( fileName, size );
+    m_manifest.insert( targetFile, entry );
+    if ( m_previousManifest.isUpToDate( targetFile, entry ) && m_targetDir.exists( targetFile ) ) {
+        // unchanged since the gallery was last generated
+        m_waitCounter--;
+        return imageName;
+    }
+    m_previousManifest.remove( targetFile );
+
+    if ( Utilities::isVideo( fileName ) ) {
+        // Video frames are extracted by the background jobs of the AsyncLoader.
+        DB::ImageInfoPtr info = fileName.info();
         ImageManager::ImageRequest* request =
             new ImageManager::ImageRequest( fileName, QSize( size, size ),
                                             info->angle(), this );
         request->setPriority( ImageManager::BatchTask );
         ImageManager::AsyncLoader::instance()->load( request );
-        m_generatedFiles.insert( qMakePair( fileName, size ) );
     }
+    else {
+        // Images are collected and scaled in one go by startImageScaling(),
+        // so that each image only needs to be decoded once for all sizes.
+        if ( !m_pendingSizes.contains( fileName ) )
+            m_imagesToScale.append( fileName );
+        m_pendingSizes[fileName].append( size );
+    }
+
+    return imageName;
+}
 
-    return nameImage( fileName, size );
+HTMLGenerator::ManifestEntry HTMLGenerator::Generator::manifestEntry( const DB::FileName& fileName, int size )
+{
+    const DB::ImageInfoPtr info = fileName.info();
+    ManifestEntry entry;
+    entry.source = fileName.relative();
+    entry.md5 = info->MD5Sum().toHexString();
+    entry.angle = info->angle();
+    entry.size = size;
+    // the description is written to the Exif information of the scaled images
+    entry.checksum = checksum( info->description().toUtf8() );
+    return entry;
+}
+
+void HTMLGenerator::Generator::finishManifest()
+{
+    for ( const QString& orphan : m_previousManifest.filesMissingIn( m_manifest ) ) {
+        qCDebug(HTMLGeneratorLog) << "Removing file no longer part of the gallery:" << orphan;
+        QFile::remove( m_targetDir.filePath( orphan ) );
+    }
+
+    if ( !m_manifest.save( m_targetDir ) )
+        qCWarning(HTMLGeneratorLog) << "Unable to write gallery manifest to" << m_targetDir.path();
+    m_galleryCompleted = true;
+}
+
+bool HTMLGenerator::Generator::startImageScaling()
+{
+    // Create all folders up front, so the worker threads only need to write files
+    QSet<int> sizes;
+    for ( const QList<int>& imageSizes : m_pendingSizes )
+        sizes += imageSizes.toSet();
+    for ( int size : sizes ) {
+        const QString photoFolder = folderImage( size );
+        if ( !m_targetDir.exists( photoFolder ) && !m_targetDir.mkdir( photoFolder ) ) {
+            KMessageBox::error( this, i18n("Unable to create folder '%1' / %2 .", m_targetDir.path(), photoFolder ) );
+            return false;
+        }
+    }
+
+    for ( const DB::FileName& fileName : m_imagesToScale ) {
+        QList<ScaleTarget> targets;
+        for ( int size : m_pendingSizes[fileName] ) {
+            QDir photosDir = m_targetDir;
+            photosDir.cd( folderImage( size ) );
+            targets.append( { size, photosDir.filePath( nameImage( fileName, size ) ) } );
+        }
+        m_scalePool.start( new ImageScaleTask( this, &m_cancelScaling, fileName, fileName.info()->angle(), targets ) );
+    }
+    m_imagesToScale.clear();
+    m_pendingSizes.clear();
+    return true;
+}
+
+void HTMLGenerator::Generator::imagesWritten( const DB::FileName& fileName, int count, const QStringList& written, const QString& errorFile )
+{
+    if ( m_cancelScaling.load() )
+        return;
+
+    // Exiv2 and the database are only used from the GUI thread, so the Exif information is copied here.
+    for ( const QString& file : written ) {
+        try {
+            Exif::Info::instance()->writeInfoToFile( fileName, file );
+        }
+        catch (...)
+        {
+        }
+    }
+
+    setValue( m_total - m_waitCounter );
+    m_waitCounter -= count;
+
+    if ( !errorFile.isEmpty() ) {
+        // See pixmapLoaded() for why we stop right away.
+        slotCancelGenerate();
+        KMessageBox::error( this, i18n("Unable to write image '%1'.", errorFile) );
+    }
+
+    if ( m_waitCounter == 0 && m_hasEnteredLoop) {
+        m_eventLoop->exit();
+    }
 }
 
 bool HTMLGenerator::Generator::generateJSDatabase(){
@@ -751,7 +903,7 @@ bool HTMLGenerator::Generator::generateJSDatabase(){
     content = content.replace( QString::fromLatin1( "**CONFIG**" ), JSConfig );
 
     // -------------------------------------------------- write to file
-    QString fileName = m_tempDir.filePath(
+    QString fileName = m_targetDir.filePath(
                 QString::fromLatin1("photos.js" )
                 );
     qCDebug(HTMLGeneratorLog) << QString::fromLatin1("File: ") + fileName;
@@ -769,9 +921,19 @@ QString HTMLGenerator::Generator::createVideo( const DB::FileName& fileName )
     qApp->processEvents();
 
     QString baseName = nameImage( fileName, maxImageSize() );
-    QDir video_dest = m_tempDir;
+    QDir video_dest = m_targetDir;
     video_dest.cd( folderImage(maxImageSize()) );
     QString destName = video_dest.filePath(baseName);
+    if ( !m_copiedVideos.contains( fileName ) && !m_setup.html5VideoGenerate() ) {
+        // Only plain copies are tracked in the manifest, converted videos are always regenerated.
+        const QString targetFile = m_targetDir.relativeFilePath( destName );
+        const ManifestEntry entry = manifestEntry( fileName, -1 );
+        m_manifest.insert( targetFile, entry );
+        if ( m_previousManifest.isUpToDate( targetFile, entry ) && QFile::exists( destName ) )
+            m_copiedVideos.insert( fileName );
+        else
+            m_previousManifest.remove( targetFile );
+    }
     if ( !m_copiedVideos.contains( fileName )) {
         if ( m_setup.html5VideoGenerate() ) {
             // TODO: shouldn't we use avconv library directly instead of KRun
@@ -797,22 +959,31 @@ QString HTMLGenerator::Generator::kimFileName( bool relative )
     if ( relative )
         return QString::fromLatin1( "%2.kim" ).arg( m_setup.outputDir() );
     else
-        return m_tempDir.filePath( QString::fromLatin1("%2.kim").arg( m_setup.outputDir()));
+        return m_targetDir.filePath( QString::fromLatin1("%2.kim").arg( m_setup.outputDir()));
 }
 
 bool HTMLGenerator::Generator::writeToFile( const QString& fileName, const QString& str, bool toHTML)
 {
+    QByteArray data;
+    if (toHTML)
+        data = translateToHTML(str).toUtf8();
+    else
+        data = str.toUtf8();
+
+    const QString targetFile = m_targetDir.relativeFilePath( fileName );
+    ManifestEntry entry;
+    entry.checksum = checksum( data );
+    m_manifest.insert( targetFile, entry );
+    if ( m_previousManifest.isUpToDate( targetFile, entry ) && QFile::exists( fileName ) )
+        return true;
+    m_previousManifest.remove( targetFile );
+
     QFile file(fileName);
     if ( !file.open(QIODevice::WriteOnly) ) {
         KMessageBox::error( this, i18n("Could not create file '%1'.",fileName),
                             i18n("Could Not Create File") );
         return false;
     }
-    QByteArray data;
-    if (toHTML)
-        data = translateToHTML(str).toUtf8();
-    else
-        data = str.toUtf8();
     file.write( data );
     file.close();
     return true;
@@ -837,8 +1008,8 @@ bool HTMLGenerator::Generator::linkIndexFile()
     ImageSizeCheckBox* resolution = m_setup.activeResolutions()[0];
     QString fromFile = QString::fromLatin1("index-%1.html" )
                        .arg(resolution->text(true));
-    fromFile = m_tempDir.filePath(fromFile);
-    QString destFile = m_tempDir.filePath( QString::fromLatin1("index.html") );
+    fromFile = m_targetDir.filePath(fromFile);
+    QString destFile = m_targetDir.filePath( QString::fromLatin1("index.html") );
     bool ok = Utilities::copy( fromFile, destFile );
     if ( !ok ) {
         KMessageBox::error( this, i18n("<p>Unable to copy %1 to %2</p>"
@@ -852,6 +1023,8 @@ bool HTMLGenerator::Generator::linkIndexFile()
 void HTMLGenerator::Generator::slotCancelGenerate()
 {
     ImageManager::AsyncLoader::instance()->stop( this );
+    m_cancelScaling.store( 1 );
+    m_scalePool.clear();
     m_waitCounter = 0;
     if ( m_hasEnteredLoop )
         m_eventLoop->exit();
@@ -876,13 +1049,13 @@ void HTMLGenerator::Generator::pixmapLoaded(ImageManager::ImageRequest* request,
     // Build folder name
     photoFolder = folderImage( size );
 	// Create folder if needed
-	if (!m_tempDir.exists(photoFolder)){
-		if(!m_tempDir.mkdir(photoFolder)){
+	if (!m_targetDir.exists(photoFolder)){
+		if(!m_targetDir.mkdir(photoFolder)){
 			slotCancelGenerate();
-			KMessageBox::error( this, i18n("Unable to create folder '%1' / %2 .", m_tempDir.path(), QString::fromLatin1( "photos") ) );
+			KMessageBox::error( this, i18n("Unable to create folder '%1' / %2 .", m_targetDir.path(), QString::fromLatin1( "photos") ) );
 		}
 	}
-	QDir tempPhotosDir = m_tempDir;
+	QDir tempPhotosDir = m_targetDir;
 	tempPhotosDir.cd(photoFolder);
 	file = tempPhotosDir.filePath( nameImage( fileName, size ) );
 
@@ -19,15 +19,21 @@
 #define HTMLGENERATOR_GENERATOR_H
 
 #include <DB/CategoryPtr.h>
+#include <DB/FileName.h>
 #include <ImageManager/ImageClientInterface.h>
 #include <Utilities/UniqFilenameMapper.h>
+#include "GalleryManifest.h"
 #include "Setup.h"
 
+#include <QAtomicInt>
 #include <QEventLoop>
+#include <QHash>
 #include <QPointer>
 #include <QProgressDialog>
 #include <QString>
+#include <QStringList>
 #include <QTemporaryDir>
+#include <QThreadPool>
 
 namespace DB { class Id; }
 
@@ -46,6 +52,7 @@ public:
 protected slots:
     void slotCancelGenerate();
     void showBrowser();
+    void imagesWritten( const DB::FileName& fileName, int count, const QStringList& written, const QString& errorFile );
 
 protected:
     bool generateIndexPage( int width, int height );
@@ -62,6 +69,9 @@ public:
 
     QString createImage( const DB::FileName& id, int size );
     QString createVideo( const DB::FileName& fileName );
+    bool startImageScaling();
+    ManifestEntry manifestEntry( const DB::FileName& fileName, int size );
+    void finishManifest();
 
     QDir getHTMLFolder(QDir tempDir);
 
@@ -81,13 +91,24 @@ private:
     int m_waitCounter;
     int m_total;
     QTemporaryDir m_tempDirHandle;
-    QDir m_tempDir;
+    // the directory all files are written to; this is either the output directory itself or a temporary directory
+    QDir m_targetDir;
+    bool m_writeDirectly;
+    // manifest of a previous run into the same directory; entries are removed when their file is rewritten
+    GalleryManifest m_previousManifest;
+    GalleryManifest m_manifest;
+    bool m_isUpdate;
+    bool m_galleryCompleted;
     Utilities::UniqFilenameMapper m_filenameMapper;
     QSet< QPair<DB::FileName,int> > m_generatedFiles;
+    DB::FileNameList m_imagesToScale;
+    QHash<DB::FileName, QList<int>> m_pendingSizes;
     DB::FileNameSet m_copiedVideos;
     bool m_hasEnteredLoop;
     QPointer<QEventLoop> m_eventLoop;
     QString m_avconv;
+    QAtomicInt m_cancelScaling;
+    QThreadPool m_scalePool;
 };
 
 }
@@ -38,6 +38,7 @@
 #include <KConfig>
 #include <KConfigGroup>
 #include <KFileItem>
+#include <KGuiItem>
 #include <KIO/DeleteJob>
 #include <KIO/StatJob>
 #include <KJob>
@@ -51,6 +52,7 @@
 #include <MainWindow/Window.h>
 #include <Settings/SettingsData.h>
 
+#include "GalleryManifest.h"
 #include "Generator.h"
 #include "ImageSizeCheckBox.h"
 
@@ -452,6 +454,24 @@ bool HTMLDialog::checkVars()
     KJobWidgets::setWindow( existsJob.data(), MainWindow::Window::theMainWindow() );
     if ( existsJob->exec() )
     {
+        const QUrl outputURL = QUrl::fromUserInput(outputDir);
+        if ( outputURL.isLocalFile() && GalleryManifest::exists( QDir( outputURL.toLocalFile() ) ) ) {
+            // a gallery generated by us: offer to only update what has changed
+            const int answer = KMessageBox::questionYesNoCancel( this,
+                                                                 i18n("<p>Output directory %1 already contains a gallery.</p>"
+                                                                      "<p>Do you want to update the existing gallery, or delete it and generate it from scratch?</p>", outputDir ),
+                                                                 i18n("Gallery Exists"),
+                                                                 KGuiItem( i18n("Update") ), KGuiItem( i18n("Delete") ) );
+            if ( answer == KMessageBox::Yes )
+                return true;
+            if ( answer == KMessageBox::Cancel )
+                return false;
+            QScopedPointer<KJob> delJob (KIO::del(outputURL));
+            KJobWidgets::setWindow( delJob.data(), MainWindow::Window::theMainWindow() );
+            delJob->exec();
+            return true;
+        }
+
         int answer = KMessageBox::warningYesNo( this,
                                                 i18n("<p>Output directory %1 already exists. "
                                                      "Usually, this means you should specify a new directory.</p>"
@@ -588,6 +608,10 @@ void HTMLDialog::slotUpdateOutputLabel()
     {
         m_outputLabel->setStyleSheet(QString::fromLatin1("QLabel { color : darkred; }"));
         outputDir.append(i18n("<p>Gallery directory cannot be empty.</p>"));
+    } else if ( GalleryManifest::exists( QDir(outputDir) ) )
+    {
+        m_outputLabel->setStyleSheet(QString::fromLatin1("QLabel { color : darkgreen; }"));
+        outputDir.append(i18n("<p>The existing gallery in this directory can be updated.</p>"));
     } else if ( QDir(outputDir).exists())
     {
         m_outputLabel->setStyleSheet(QString::fromLatin1("QLabel { color : darkorange; }"));
@@ -0,0 +1,107 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "ImageScaleTask.h"
+#include "Logging.h"
+
+#include <ImageManager/ImageDecoder.h>
+#include <Utilities/FastJpeg.h>
+#include <Utilities/Util.h>
+
+#include <QImage>
+#include <QMetaObject>
+#include <QObject>
+#include <QTransform>
+
+#include <algorithm>
+
+HTMLGenerator::ImageScaleTask::ImageScaleTask( QObject* receiver, const QAtomicInt* cancelled,
+                                               const DB::FileName& fileName, int angle, const QList<ScaleTarget>& targets )
+    : m_receiver( receiver )
+    , m_cancelled( cancelled )
+    , m_fileName( fileName )
+    , m_angle( angle )
+    , m_targets( targets )
+{
+    // Largest first, so every variant can be scaled down from the previous one.
+    // Full size (-1) goes in front of everything else.
+    std::sort( m_targets.begin(), m_targets.end(), [](const ScaleTarget& a, const ScaleTarget& b) {
+        if ( a.size == -1 || b.size == -1 )
+            return a.size == -1 && b.size != -1;
+        return a.size > b.size;
+    });
+}
+
+void HTMLGenerator::ImageScaleTask::run()
+{
+    if ( m_cancelled->load() )
+        return;
+
+    QStringList written;
+    const QString errorFile = scaleAndSave( &written );
+    QMetaObject::invokeMethod( m_receiver, "imagesWritten", Qt::QueuedConnection,
+                               Q_ARG( DB::FileName, m_fileName ), Q_ARG( int, m_targets.size() ),
+                               Q_ARG( QStringList, written ), Q_ARG( QString, errorFile ) );
+}
+
+QString HTMLGenerator::ImageScaleTask::scaleAndSave( QStringList* written )
+{
+    if ( m_targets.isEmpty() )
+        return QString();
+
+    // sorted in the constructor, so the first target tells how big the decoded image needs to be:
+    const int dim = m_targets.first().size;
+
+    QImage image;
+    QSize fullSize;
+    bool ok = false;
+    if ( m_fileName.exists() ) {
+        if ( Utilities::isJPEG( m_fileName ) )
+            ok = Utilities::loadJPEG( &image, m_fileName, &fullSize, dim );
+        else
+            ok = ImageManager::ImageDecoder::decode( &image, m_fileName, &fullSize, dim );
+        if ( !ok )
+            ok = image.load( m_fileName.absolute() );
+    }
+    if ( !ok ) {
+        qCWarning(HTMLGeneratorLog) << "Unable to load image" << m_fileName.absolute();
+        return m_targets.first().fileName;
+    }
+
+    if ( m_angle != 0 ) {
+        QTransform transform;
+        transform.rotate( m_angle );
+        image = image.transformed( transform );
+    }
+
+    for ( const ScaleTarget& target : m_targets ) {
+        if ( m_cancelled->load() )
+            return QString();
+
+        // Never scale up; this mirrors what ImageLoaderThread does for the request the generator used to send.
+        if ( target.size != -1 && ( image.width() > target.size || image.height() > target.size ) )
+            image = Utilities::scaleImage( image, target.size, target.size, Qt::KeepAspectRatio );
+
+        if ( !image.save( target.fileName, "JPEG" ) )
+            return target.fileName;
+        written->append( target.fileName );
+    }
+    return QString();
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
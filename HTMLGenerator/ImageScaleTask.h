@@ -0,0 +1,80 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef HTMLGENERATOR_IMAGESCALETASK_H
+#define HTMLGENERATOR_IMAGESCALETASK_H
+
+#include <DB/FileName.h>
+
+#include <QAtomicInt>
+#include <QList>
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+
+class QObject;
+
+namespace HTMLGenerator
+{
+
+/**
+ * \brief One output image of an ImageScaleTask.
+ * A size of -1 means "full size", i.e. the decoded image is written without scaling.
+ */
+struct ScaleTarget {
+    int size;
+    QString fileName;
+};
+
+/**
+ * \brief Produce all scaled variants of a single image on a worker thread.
+ *
+ * The source image is decoded exactly once (at the largest requested size),
+ * rotated, and then successively scaled down to each of the requested sizes.
+ * Every variant is encoded as JPEG into its target file.
+ *
+ * When done, the task calls the slot <tt>imagesWritten(DB::FileName, int, QStringList, QString)</tt>
+ * on the receiver using a queued connection, passing the source image, the number of targets that were
+ * handled, the files that were written and the name of the file that could not be written
+ * (or an empty string on success).
+ * Copying the Exif information of the source into the written files is left to the receiver,
+ * as it needs the database and Exiv2, which must only be used from the GUI thread.
+ *
+ * The task must not outlive the receiver or the cancel flag.
+ */
+class ImageScaleTask : public QRunnable
+{
+public:
+    ImageScaleTask( QObject* receiver, const QAtomicInt* cancelled,
+                    const DB::FileName& fileName, int angle, const QList<ScaleTarget>& targets );
+    void run() override;
+
+private:
+    QString scaleAndSave( QStringList* written );
+
+    QObject* m_receiver;
+    const QAtomicInt* m_cancelled;
+    DB::FileName m_fileName;
+    int m_angle;
+    QList<ScaleTarget> m_targets;
+};
+
+}
+
+#endif /* HTMLGENERATOR_IMAGESCALETASK_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
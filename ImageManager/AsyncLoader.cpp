@@ -23,7 +23,9 @@
 
 #include <BackgroundJobs/HandleVideoThumbnailRequestJob.h>
 #include <BackgroundTaskManager/JobManager.h>
+#include <DB/ImageInfo.h>
 #include <ImageManager/ImageClientInterface.h>
+#include <MainWindow/DirtyIndicator.h>
 #include <MainWindow/FeatureDialog.h>
 #include <Utilities/Util.h>
 
@@ -231,8 +233,17 @@ void ImageManager::AsyncLoader::customEvent( QEvent* ev )
             image = m_brokenImage;
         }
 
-        if ( request->isThumbnailRequest() )
+        if ( request->isThumbnailRequest() ) {
             ImageManager::ThumbnailCache::instance()->insert( request->databaseFileName(), image );
+            if ( request->perceptualHash() != 0 ) {
+                const DB::ImageInfoPtr info = request->databaseFileName().info();
+                // Only mark dirty if it is required
+                if ( info && info->perceptualHash() != request->perceptualHash() ) {
+                    info->setPerceptualHash( request->perceptualHash() );
+                    MainWindow::DirtyIndicator::markDirty();
+                }
+            }
+        }
 
 
         if ( requestStillNeeded && request->client() ) {
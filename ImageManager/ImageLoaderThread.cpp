@@ -23,6 +23,7 @@
 #include "AsyncLoader.h"
 #include "RawImageDecoder.h"
 #include "Utilities/FastJpeg.h"
+#include "Utilities/PerceptualHash.h"
 #include "Utilities/Util.h"
 
 #include <qapplication.h>
@@ -73,6 +74,9 @@ void ImageManager::ImageLoaderThread::run()
 
         if ( ok ) {
             img = scaleAndRotate( request, img );
+            // Hashing the thumbnail here is far cheaper than decoding the image again for finding similar images.
+            if ( request->isThumbnailRequest() && !Utilities::isVideo( request->databaseFileName() ) )
+                request->setPerceptualHash( Utilities::perceptualHash( img ) );
         }
 
         request->setLoadedOK( ok );
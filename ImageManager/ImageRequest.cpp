@@ -49,6 +49,16 @@ bool ImageManager::ImageRequest::loadedOK() const
     return m_loadedOK;
 }
 
+void ImageManager::ImageRequest::setPerceptualHash( quint64 hash )
+{
+    m_perceptualHash = hash;
+}
+
+quint64 ImageManager::ImageRequest::perceptualHash() const
+{
+    return m_perceptualHash;
+}
+
 bool ImageManager::ImageRequest::isNull() const
 {
     return m_null;
@@ -68,6 +68,12 @@ public:
     void setLoadedOK( bool ok );
     bool loadedOK() const;
 
+    /**
+     * The perceptual hash of the loaded thumbnail, or 0 if none was computed.
+     */
+    void setPerceptualHash( quint64 hash );
+    quint64 perceptualHash() const;
+
     void setPriority( const Priority prio );
     Priority priority() const;
 
@@ -94,6 +100,7 @@ private:
     QSize m_fullSize;
     Priority m_priority;
     bool m_loadedOK;
+    quint64 m_perceptualHash = 0;
     bool m_dontUpScale;
     bool m_isThumbnailRequest;
     bool m_isExitRequest;
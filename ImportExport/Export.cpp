@@ -26,7 +26,9 @@
 #include <QLayout>
 #include <QProgressDialog>
 #include <QRadioButton>
+#include <QSet>
 #include <QSpinBox>
+#include <QThread>
 #include <QVBoxLayout>
 #include <QFileDialog>
 
@@ -43,10 +45,28 @@
 #include <QDialogButtonBox>
 #include <QPushButton>
 
+#include "Logging.h"
+#include "ScaleImageTask.h"
 #include "XMLHandler.h"
 
 using namespace ImportExport;
 
+namespace
+{
+/**
+ * @brief isCompressedFormat
+ * @return \c true if the file is in a format that is already compressed, and would not get any smaller when deflated.
+ */
+bool isCompressedFormat( const QString& fileName )
+{
+    static const QSet<QString> compressedImageFormats {
+        QString::fromLatin1( "jpg" ), QString::fromLatin1( "jpeg" ), QString::fromLatin1( "png" ),
+        QString::fromLatin1( "gif" ), QString::fromLatin1( "webp" ), QString::fromLatin1( "jp2" ) };
+    const QString suffix = QFileInfo( fileName ).suffix().toLower();
+    return compressedImageFormats.contains( suffix ) || Utilities::supportedVideoExtensions().contains( suffix );
+}
+}
+
 void Export::imageExport(const DB::FileNameList& list)
 {
     ExportConfig config;
@@ -204,6 +224,10 @@ void ExportConfig::showHelp()
 
 Export::~Export()
 {
+    // the scale tasks reference m_cancelScaling and call back into this object
+    m_cancelScaling.store( 1 );
+    m_scalePool.clear();
+    m_scalePool.waitForDone();
     delete m_eventLoop;
 }
 
@@ -218,13 +242,18 @@ Export::Export(
     bool *ok)
     : m_internalOk(true)
     , m_ok( ok )
+    , m_compress( compress )
     , m_maxSize( maxSize )
     , m_location( location )
     , m_eventLoop( new QEventLoop )
+    , m_scalesInFlight( 0 )
+    , m_cancelScaling( 0 )
 {
     if (ok == nullptr)
         ok = &m_internalOk;
     *ok = true;
+    qRegisterMetaType<DB::FileName>();
+    m_scalePool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() ) );
     m_destdir = QFileInfo( zipFile ).path();
     m_zip = new KZip( zipFile );
     m_zip->setCompression( compress ? KZip::DeflateCompression : KZip::NoCompression );
@@ -264,7 +293,7 @@ Export::Export(
         // Create the index.xml file
         m_progressDialog->setLabelText(i18n("Creating index file"));
         QByteArray indexml = XMLHandler().createIndexXML( list, baseUrl, m_location, &m_filenameMapper );
-        m_zip->writeFile( QString::fromLatin1( "index.xml" ), indexml.data() );
+        writeDataToZip( QString::fromLatin1( "index.xml" ), indexml );
 
        m_steps++;
        m_progressDialog->setValue( m_steps );
@@ -278,11 +307,19 @@ void Export::generateThumbnails(const DB::FileNameList& list)
     m_progressDialog->setLabelText( i18n("Creating thumbnails") );
     m_loopEntered = false;
     m_subdir = QString::fromLatin1( "Thumbnails/" );
-    m_filesRemaining = list.size(); // Used to break the event loop.
+    m_filesRemaining = 0; // Used to break the event loop.
     for (const DB::FileName& fileName : list) {
-        ImageManager::ImageRequest* request = new ImageManager::ImageRequest( fileName, QSize( 128, 128 ), fileName.info()->angle(), this );
-        request->setPriority( ImageManager::BatchTask );
-        ImageManager::AsyncLoader::instance()->load( request );
+        if ( Utilities::isVideo( fileName ) ) {
+            // Video frames are extracted by the background jobs of the AsyncLoader.
+            ImageManager::ImageRequest* request = new ImageManager::ImageRequest( fileName, QSize( 128, 128 ), fileName.info()->angle(), this );
+            request->setPriority( ImageManager::BatchTask );
+            if ( ImageManager::AsyncLoader::instance()->load( request ) )
+                m_filesRemaining++;
+            else
+                delete request;
+        }
+        else
+            queueScaling( fileName, 128, fileName.info()->angle() );
     }
     if ( m_filesRemaining > 0 ) {
         m_loopEntered = true;
@@ -309,7 +346,7 @@ void Export::copyImages(const DB::FileNameList& list)
                 file = QFileInfo(file).readLink();
 
             if ( m_location == Inline )
-                m_zip->addLocalFile( file, QString::fromLatin1( "Images/" ) + zippedName );
+                addLocalFileToZip( file, QString::fromLatin1( "Images/" ) + zippedName );
             else if ( m_location == AutoCopy )
                 Utilities::copy( file, m_destdir + QString::fromLatin1( "/" ) + zippedName );
             else if ( m_location == Link )
@@ -321,11 +358,8 @@ void Export::copyImages(const DB::FileNameList& list)
             m_progressDialog->setValue( m_steps );
         }
         else {
-            m_filesRemaining++;
-            ImageManager::ImageRequest* request =
-                new ImageManager::ImageRequest( DB::FileName::fromAbsolutePath(file), QSize( m_maxSize, m_maxSize ), 0, this );
-            request->setPriority( ImageManager::BatchTask );
-            ImageManager::AsyncLoader::instance()->load( request );
+            // Scaling happens on the thread pool while we continue copying the other files.
+            queueScaling( DB::FileName::fromAbsolutePath(file), m_maxSize, 0 );
         }
 
         // Test if the cancel button was pressed.
@@ -333,6 +367,8 @@ void Export::copyImages(const DB::FileNameList& list)
 
         if ( m_progressDialog->wasCanceled() ) {
             *m_ok = false;
+            m_cancelScaling.store( 1 );
+            m_scalePool.clear();
             return;
         }
     }
@@ -342,41 +378,97 @@ void Export::copyImages(const DB::FileNameList& list)
     }
 }
 
-void Export::pixmapLoaded(ImageManager::ImageRequest* request, const QImage& image)
+void Export::addLocalFileToZip( const QString& file, const QString& zipName )
 {
-    const DB::FileName fileName = request->databaseFileName();
-    if ( !request->loadedOK() )
-        return;
+    // KZip reads the file in chunks, so this does not need to hold the file in memory.
+    // Deflating already compressed formats only costs time, so those are always stored.
+    m_zip->setCompression( ( m_compress && !isCompressedFormat( file ) ) ? KZip::DeflateCompression : KZip::NoCompression );
+    m_zip->addLocalFile( file, zipName );
+}
+
+void Export::writeDataToZip( const QString& zipName, const QByteArray& data )
+{
+    m_zip->setCompression( ( m_compress && !isCompressedFormat( zipName ) ) ? KZip::DeflateCompression : KZip::NoCompression );
+    m_zip->writeFile( zipName, data );
+}
+
+void Export::queueScaling( const DB::FileName& fileName, int maxSize, int angle )
+{
+    m_filesRemaining++;
+    m_scaleQueue.enqueue( { fileName, maxSize, angle } );
+    startScaling();
+}
+
+void Export::startScaling()
+{
+    // Only keep a few images per thread in memory, no matter how large the export is.
+    const int maxInFlight = 2 * m_scalePool.maxThreadCount();
+    while ( m_scalesInFlight < maxInFlight && !m_scaleQueue.isEmpty() ) {
+        const ScaleRequest request = m_scaleQueue.dequeue();
+        const QByteArray format = QFileInfo( zipFileNameFor( request.fileName ) ).suffix().toLower().toLatin1();
+        m_scalePool.start( new ScaleImageTask( this, &m_cancelScaling, request.fileName, request.maxSize, request.angle, format ) );
+        m_scalesInFlight++;
+    }
+}
 
+QString Export::zipFileNameFor( const DB::FileName& fileName )
+{
     const QString ext = (Utilities::isVideo( fileName ) || Utilities::isRAW( fileName )) ? QString::fromLatin1( "jpg" ) : QFileInfo( m_filenameMapper.uniqNameFor(fileName) ).completeSuffix();
 
-    // Add the file to the zip archive
-    QString zipFileName = QString::fromLatin1( "%1/%2.%3" ).arg( Utilities::stripEndingForwardSlash(m_subdir))
+    return QString::fromLatin1( "%1/%2.%3" ).arg( Utilities::stripEndingForwardSlash(m_subdir))
         .arg(QFileInfo( m_filenameMapper.uniqNameFor(fileName) ).baseName()).arg( ext );
+}
+
+void Export::imageScaled( const DB::FileName& fileName, const QByteArray& data )
+{
+    m_scalesInFlight--;
+    if ( m_cancelScaling.load() )
+        return;
+
+    if ( data.isEmpty() )
+        qCWarning(ImportExportLog) << "Skipping image that could not be loaded:" << fileName.absolute();
+    storeImage( fileName, data );
+    startScaling();
+}
+
+void Export::pixmapLoaded(ImageManager::ImageRequest* request, const QImage& image)
+{
+    const DB::FileName fileName = request->databaseFileName();
+    if ( !request->loadedOK() ) {
+        storeImage( fileName, QByteArray() );
+        return;
+    }
+
     QByteArray data;
     QBuffer buffer( &data );
     buffer.open( QIODevice::WriteOnly );
-    image.save( &buffer,  QFileInfo(zipFileName).suffix().toLower().toLatin1().constData() );
-
-    if ( m_location == Inline || !m_copyingFiles )
-        m_zip->writeFile( zipFileName, data.constData() );
-    else {
-        QString file = m_destdir + QString::fromLatin1( "/" ) + m_filenameMapper.uniqNameFor(fileName);
-        QFile out( file );
-        if ( !out.open( QIODevice::WriteOnly ) ) {
-            KMessageBox::error( nullptr, i18n("Error writing file %1", file ) );
-            *m_ok = false;
+    image.save( &buffer,  QFileInfo(zipFileNameFor( fileName )).suffix().toLower().toLatin1().constData() );
+    storeImage( fileName, data );
+}
+
+void Export::storeImage( const DB::FileName& fileName, const QByteArray& data )
+{
+    if ( !data.isEmpty() ) {
+        if ( m_location == Inline || !m_copyingFiles )
+            writeDataToZip( zipFileNameFor( fileName ), data );
+        else {
+            QString file = m_destdir + QString::fromLatin1( "/" ) + m_filenameMapper.uniqNameFor(fileName);
+            QFile out( file );
+            if ( !out.open( QIODevice::WriteOnly ) ) {
+                KMessageBox::error( nullptr, i18n("Error writing file %1", file ) );
+                *m_ok = false;
+            }
+            out.write( data.constData(), data.size() );
+            out.close();
         }
-        out.write( data.constData(), data.size() );
-        out.close();
     }
 
-    qApp->processEvents( QEventLoop::AllEvents );
-
     bool canceled = (!*m_ok ||  m_progressDialog->wasCanceled());
 
     if ( canceled ) {
         *m_ok = false;
+        m_cancelScaling.store( 1 );
+        m_scalePool.clear();
         m_eventLoop->exit();
         ImageManager::AsyncLoader::instance()->stop( this );
         return;
@@ -386,9 +478,8 @@ void Export::pixmapLoaded(ImageManager::ImageRequest* request, const QImage& ima
     m_filesRemaining--;
     m_progressDialog->setValue( m_steps );
 
-
-        if ( m_filesRemaining == 0 && m_loopEntered )
-            m_eventLoop->exit();
+    if ( m_filesRemaining == 0 && m_loopEntered )
+        m_eventLoop->exit();
 }
 
 void Export::showUsageDialog()
@@ -19,9 +19,14 @@
 #ifndef IMPORTEXPORT_H
 #define IMPORTEXPORT_H
 
+#include <QAtomicInt>
 #include <QDialog>
 #include <QEventLoop>
 #include <QPointer>
+#include <QQueue>
+#include <QThreadPool>
+
+#include <DB/FileName.h>
 
 #include <ImageManager/ImageClientInterface.h>
 #include <Utilities/UniqFilenameMapper.h>
@@ -39,7 +44,8 @@ namespace ImportExport
 
 enum ImageFileLocation { Inline, ManualCopy, AutoCopy, Link, Symlink };
 
-class Export :public ImageManager::ImageClientInterface {
+class Export :public QObject, public ImageManager::ImageClientInterface {
+    Q_OBJECT
 
 public:
     static void imageExport(const DB::FileNameList& list);
@@ -59,14 +65,30 @@ public:
 protected:
     void generateThumbnails(const DB::FileNameList& list);
     void copyImages(const DB::FileNameList& list);
+    void addLocalFileToZip( const QString& file, const QString& zipName );
+    void writeDataToZip( const QString& zipName, const QByteArray& data );
+    void queueScaling( const DB::FileName& fileName, int maxSize, int angle );
+    void startScaling();
+    void storeImage( const DB::FileName& fileName, const QByteArray& data );
+    QString zipFileNameFor( const DB::FileName& fileName );
+
+protected slots:
+    void imageScaled( const DB::FileName& fileName, const QByteArray& data );
 
 private:
+    struct ScaleRequest {
+        DB::FileName fileName;
+        int maxSize;
+        int angle;
+    };
+
     bool m_internalOk; // used in case m_ok is null
     bool* m_ok;
     int m_filesRemaining;
     int m_steps;
     QProgressDialog* m_progressDialog;
     KZip* m_zip;
+    bool m_compress;
     int m_maxSize;
     QString m_subdir;
     bool m_loopEntered;
@@ -75,6 +97,11 @@ private:
     bool m_copyingFiles;
     QString m_destdir;
     const QPointer <QEventLoop> m_eventLoop;
+    // images waiting to be scaled; only a few are handed to the thread pool at a time to bound memory usage
+    QQueue<ScaleRequest> m_scaleQueue;
+    int m_scalesInFlight;
+    QAtomicInt m_cancelScaling;
+    QThreadPool m_scalePool;
 };
 
 class ExportConfig :public QDialog {
@@ -20,16 +20,19 @@
 
 #include <QApplication>
 #include <QFile>
+#include <QFileInfo>
 #include <QProgressDialog>
 #include <KLocalizedString>
-#include <KIO/StatJob>
+#include <KIO/FileCopyJob>
 #include <KJobWidgets>
 #include <KJobUiDelegate>
 #include <kmessagebox.h>
 #include <KConfigGroup>
 
+#include "ImportJournal.h"
 #include "KimFileReader.h"
 #include "ImportSettings.h"
+#include "VerifyCopyTask.h"
 #include "MainWindow/Window.h"
 #include "DB/ImageDB.h"
 #include "Browser/BrowserWidget.h"
@@ -44,14 +47,24 @@
 
 using namespace ImportExport;
 
+namespace
+{
+// Copying is bound by I/O, not by the CPU. A few parallel jobs hide the latency
+// of remote sources without making a local disk seek back and forth too much.
+constexpr int MAX_PARALLEL_COPIES = 4;
+}
+
 ImportExport::ImportHandler::ImportHandler()
-    : m_fileMapper(nullptr), m_finishedPressed(false), m_progress(0), m_reportUnreadableFiles( true )
-    , m_eventLoop( new QEventLoop )
+    : m_fileMapper(nullptr), m_finishedPressed(false), m_progress(0), m_totalCopied(0), m_reportUnreadableFiles( true )
+    , m_stopped( false ), m_eventLoop( new QEventLoop )
 
 {
 }
 
 ImportHandler::~ImportHandler() {
+    m_cancelVerification.store( 1 );
+    m_verifyPool.clear();
+    m_verifyPool.waitForDone();
     delete m_fileMapper;
     delete m_eventLoop;
 }
@@ -63,22 +76,27 @@ bool ImportExport::ImportHandler::exec( const ImportSettings& settings, KimFileR
     m_finishedPressed = true;
     delete m_fileMapper;
     m_fileMapper = new Utilities::UniqFilenameMapper(m_settings.destination());
+    m_journal.reset( new ImportJournal( m_settings.destination(), m_settings.kimFile() ) );
+    m_journal->open();
+    if ( m_journal->isResumed() )
+        qCDebug(ImportExportLog) << "Resuming a previous import of" << m_settings.kimFile();
+
     bool ok;
     // copy images
     if ( m_settings.externalSource() ) {
         copyFromExternal();
 
-        // If none of the images were to be copied, then we flushed the loop before we got started, in that case, don't start the loop.
-        qCDebug(ImportExportLog) << "Copying" << m_pendingCopies.count() << "files from external source...";
-        if ( m_pendingCopies.count() > 0 )
-            ok = m_eventLoop->exec();
+        // If none of the images had to be copied, then we are done before we got started, in that case, don't start the loop.
+        qCDebug(ImportExportLog) << "Copying" << m_runningCopies.count() + m_pendingCopies.count() << "files from external source...";
+        if ( isCopyingFinished() )
+            ok = finishCopying();
         else
-            ok = false;
+            ok = m_eventLoop->exec();
     }
     else {
         ok = copyFilesFromZipFile();
         if ( ok )
-            updateDB();
+            ok = finishCopying();
     }
     if ( m_progress )
         delete m_progress;
@@ -96,52 +114,62 @@ void ImportExport::ImportHandler::copyFromExternal()
     m_progress->setMaximum( 2 * m_pendingCopies.count() );
     m_progress->show();
     connect(m_progress, &QProgressDialog::canceled, this, &ImportHandler::stopCopyingImages);
-    copyNextFromExternal();
 
+    // First search for images next to the .kim file
+    // Second search for images base on the image root as specified in the .kim file
+    m_searchUrls = {
+        m_settings.kimFile().adjusted(QUrl::RemoveFilename)
+        , m_settings.baseURL().adjusted(QUrl::RemoveFilename)
+    };
+    startNextCopies();
 }
 
-void ImportExport::ImportHandler::copyNextFromExternal()
+void ImportExport::ImportHandler::startNextCopies()
 {
-    DB::ImageInfoPtr info = m_pendingCopies[0];
+    while ( !m_stopped && m_runningCopies.count() < MAX_PARALLEL_COPIES && !m_pendingCopies.isEmpty() ) {
+        const DB::ImageInfoPtr info = m_pendingCopies.takeFirst();
 
-    if ( isImageAlreadyInDB( info ) ) {
-        qCDebug(ImportExportLog) << info->fileName().relative() << "is already in database.";
-        aCopyJobCompleted(0);
-        return;
+        if ( isImageAlreadyInDB( info ) ) {
+            qCDebug(ImportExportLog) << info->fileName().relative() << "is already in database.";
+            m_progress->setValue( ++m_totalCopied );
+            continue;
+        }
+        if ( skipVerifiedCopy( info ) )
+            continue;
+
+        startCopy( CopyRequest { info, 0, QString(), QStringList() } );
     }
+}
 
-    const DB::FileName fileName = info->fileName();
+void ImportExport::ImportHandler::startCopy( CopyRequest request )
+{
+    const QString relativeName = request.info->fileName().relative();
+    QUrl src( m_searchUrls[request.searchUrlIndex] );
+    src.setPath( src.path() + relativeName );
+    request.tried << src.toDisplayString();
+
+    if ( request.destination.isNull() ) {
+        request.destination = destinationFor( request.info );
+        m_journal->copyStarted( relativeName, request.destination );
+    }
 
-    bool succeeded = false;
-    QStringList tried;
+    // Rather than asking whether the source exists before every copy, just copy it
+    // and try the next location if that fails. This saves a round trip per file.
+    KIO::FileCopyJob* job = KIO::file_copy( src, QUrl::fromLocalFile( request.destination ), -1, KIO::HideProgressInfo | KIO::Overwrite );
+    KJobWidgets::setWindow( job, MainWindow::Window::theMainWindow() );
+    connect(job, &KIO::FileCopyJob::result, this, &ImportHandler::aCopyJobCompleted);
+    m_runningCopies.insert( job, request );
+    qCDebug(ImportExportLog) << "Copying" << src << "to" << request.destination;
+}
 
-    // First search for images next to the .kim file
-    // Second search for images base on the image root as specified in the .kim file
-    QList<QUrl> searchUrls {
-        m_settings.kimFile().adjusted(QUrl::RemoveFilename)
-        , m_settings.baseURL().adjusted(QUrl::RemoveFilename)
-    };
-    Q_FOREACH(const QUrl& url, searchUrls)
-    {
-        QUrl src (url);
-        src.setPath(src.path() + fileName.relative() );
-
-        std::unique_ptr<KIO::StatJob> statJob { KIO::stat(src, KIO::StatJob::SourceSide, 0 /* just query for existence */ ) };
-        KJobWidgets::setWindow(statJob.get(), MainWindow::Window::theMainWindow());
-        if ( statJob->exec() )
-        {
-            QUrl dest = QUrl::fromLocalFile( m_fileMapper->uniqNameFor(fileName) );
-            m_job = KIO::file_copy( src, dest, -1, KIO::HideProgressInfo );
-            connect(m_job, &KIO::FileCopyJob::result, this, &ImportHandler::aCopyJobCompleted);
-            succeeded = true;
-            qCDebug(ImportExportLog) << "Copying" << src << "to" << dest;
-            break;
-        } else
-            tried << src.toDisplayString();
-    }
+void ImportExport::ImportHandler::continueCopying()
+{
+    if ( m_stopped )
+        return;
 
-    if (!succeeded)
-        aCopyFailed( tried );
+    startNextCopies();
+    if ( isCopyingFinished() )
+        m_eventLoop->exit( finishCopying() );
 }
 
 bool ImportExport::ImportHandler::copyFilesFromZipFile()
@@ -152,35 +180,118 @@ bool ImportExport::ImportHandler::copyFilesFromZipFile()
     m_progress = new QProgressDialog( MainWindow::Window::theMainWindow());
     m_progress->setWindowTitle(i18nc("@title:window", "Copying Images") );
     m_progress->setMinimum( 0 );
-    m_progress->setMaximum( 2 * m_pendingCopies.count() );
+    m_progress->setMaximum( 2 * images.count() );
     m_progress->show();
 
+    // KZip can only be read from this thread, but writing the data and calculating its checksum
+    // is left to the verification threads. Only keep a few images in memory while doing so.
+    const int maxUnverified = 2 * m_verifyPool.maxThreadCount();
+
     for( DB::ImageInfoListConstIterator it = images.constBegin(); it != images.constEnd(); ++it ) {
-        if ( !isImageAlreadyInDB( *it ) ) {
+        if ( isImageAlreadyInDB( *it ) ) {
+            m_progress->setValue( ++m_totalCopied );
+        } else if ( !skipVerifiedCopy( *it ) ) {
             const DB::FileName fileName = (*it)->fileName();
             QByteArray data = m_kimFileReader->loadImage( fileName.relative() );
-            if ( data.isNull() )
-                return false;
-            QString newName = m_fileMapper->uniqNameFor(fileName);
-
-            QFile out( newName );
-            if ( !out.open( QIODevice::WriteOnly ) ) {
-                KMessageBox::error( MainWindow::Window::theMainWindow(), i18n("Error when writing image %1", newName ) );
+            if ( data.isNull() ) {
+                abortCopying();
                 return false;
             }
-            out.write( data.constData(), data.size() );
-            out.close();
+            const QString newName = destinationFor( *it );
+            m_journal->copyStarted( fileName.relative(), newName );
+            verifyCopy( *it, newName, data );
         }
 
+        while ( m_unverifiedCopies.count() >= maxUnverified )
+            qApp->processEvents( QEventLoop::WaitForMoreEvents );
         qApp->processEvents();
-        m_progress->setValue( ++m_totalCopied );
-        if ( m_progress->wasCanceled() ) {
-            return false;
-        }
+        if ( m_progress->wasCanceled() || !m_writeError.isNull() )
+            break;
+    }
+
+    while ( !m_unverifiedCopies.isEmpty() && !m_progress->wasCanceled() && m_writeError.isNull() )
+        qApp->processEvents( QEventLoop::WaitForMoreEvents );
+
+    if ( m_progress->wasCanceled() ) {
+        abortCopying();
+        return false;
+    }
+    if ( !m_writeError.isNull() ) {
+        abortCopying();
+        KMessageBox::error( MainWindow::Window::theMainWindow(), i18n("Error when writing image %1", m_writeError ) );
+        return false;
+    }
+    return true;
+}
+
+bool ImportExport::ImportHandler::isCopyingFinished() const
+{
+    return m_pendingCopies.isEmpty() && m_runningCopies.isEmpty() && m_unverifiedCopies.isEmpty();
+}
+
+bool ImportExport::ImportHandler::finishCopying()
+{
+    m_stopped = true;
+
+    if ( !m_checksumMismatches.isEmpty() ) {
+        KMessageBox::informationList( m_progress,
+                                      i18n("The following images do not match the checksum in the import file. They have not been imported:"),
+                                      m_checksumMismatches, i18n("Checksum Mismatch") );
     }
+
+    updateDB();
+    m_journal->remove();
+    return true;
+}
+
+void ImportExport::ImportHandler::abortCopying()
+{
+    // This might be late -- if we managed to copy some files, we will
+    // just throw away any changes to the DB, but some new image files
+    // might be in the image directory. The journal remembers them, so
+    // importing the same file again does not need to copy them again.
+    m_stopped = true;
+    const QList<KJob*> jobs = m_runningCopies.keys();
+    m_runningCopies.clear();
+    for ( KJob* job : jobs )
+        job->kill();
+    m_cancelVerification.store( 1 );
+    m_verifyPool.clear();
+}
+
+void ImportExport::ImportHandler::verifyCopy( const DB::ImageInfoPtr& info, const QString& destination, const QByteArray& data )
+{
+    const QString relativeName = info->fileName().relative();
+    m_unverifiedCopies.insert( relativeName, info );
+    m_verifyPool.start( new VerifyCopyTask( this, &m_cancelVerification, relativeName, destination, data ) );
+}
+
+bool ImportExport::ImportHandler::skipVerifiedCopy( const DB::ImageInfoPtr& info )
+{
+    const QString relativeName = info->fileName().relative();
+    if ( !m_journal->isVerified( relativeName ) )
+        return false;
+
+    const DB::MD5 md5 = m_journal->md5For( relativeName );
+    if ( !info->MD5Sum().isNull() && info->MD5Sum() != md5 )
+        return false;
+
+    qCDebug(ImportExportLog) << relativeName << "has already been copied by a previous import.";
+    m_destinations.insert( relativeName, m_journal->destinationFor( relativeName ) );
+    m_verifiedMD5Sums.insert( relativeName, md5 );
+    m_progress->setValue( ++m_totalCopied );
     return true;
 }
 
+QString ImportExport::ImportHandler::destinationFor( const DB::ImageInfoPtr& info )
+{
+    // Overwrite what an interrupted import left behind, instead of copying to yet another name:
+    const QString previous = m_journal->destinationFor( info->fileName().relative() );
+    if ( !previous.isNull() && QFileInfo::exists( previous ) )
+        return previous;
+    return m_fileMapper->uniqNameFor( info->fileName() );
+}
+
 void ImportExport::ImportHandler::updateDB()
 {
     disconnect(m_progress, &QProgressDialog::canceled, this, &ImportHandler::stopCopyingImages);
@@ -196,9 +307,18 @@ void ImportExport::ImportHandler::updateDB()
 
     // Run though all images
     DB::ImageInfoList images = m_settings.selectedImages();
+    DB::ImageInfoList newImages;
     for( DB::ImageInfoListConstIterator it = images.constBegin(); it != images.constEnd(); ++it ) {
         DB::ImageInfoPtr info = *it;
-        if ( len != 0) {
+        const QString relativeName = info->fileName().relative();
+        if ( m_checksumMismatches.contains( relativeName ) ) {
+            m_progress->setValue( ++m_totalCopied );
+            continue;
+        }
+
+        if ( m_destinations.contains( relativeName ) ) {
+            info->setFileName( DB::FileName::fromAbsolutePath( m_destinations[relativeName] ) );
+        } else if ( len != 0) {
             // exchange prefix:
             QString name = m_settings.destination() + info->fileName().absolute().mid(len);
             qCDebug(ImportExportLog) << info->fileName().absolute() << " -> " << name;
@@ -210,7 +330,7 @@ void ImportExport::ImportHandler::updateDB()
             updateInfo( matchingInfoFromDB( info ), info );
         } else {
             qCDebug(ImportExportLog) << "Adding ImageInfo for " << info->fileName().absolute();
-            addNewRecord( info );
+            newImages.append( createNewRecord( info, m_verifiedMD5Sums.value( relativeName ) ) );
         }
 
         m_progress->setValue( ++m_totalCopied );
@@ -218,12 +338,16 @@ void ImportExport::ImportHandler::updateDB()
             break;
     }
 
+    // Adding all images at once sorts and merges the image list only once:
+    DB::ImageDB::instance()->addImages( newImages );
+
     Browser::BrowserWidget::instance()->home();
 }
 
 void ImportExport::ImportHandler::stopCopyingImages()
 {
-    m_job->kill();
+    abortCopying();
+    m_eventLoop->exit(false);
 }
 
 void ImportExport::ImportHandler::aCopyFailed( QStringList files )
@@ -233,42 +357,77 @@ void ImportExport::ImportHandler::aCopyFailed( QStringList files )
                                                       i18n("Cannot copy from any of the following locations:"),
                                                       files, QString(), KStandardGuiItem::cont(), KGuiItem( i18n("Continue without Asking") )) : KMessageBox::Yes;
 
+    // other copies may have been finished while the message box was shown:
+    if ( m_stopped )
+        return;
+
     switch (result) {
     case KMessageBox::Cancel:
-        // This might be late -- if we managed to copy some files, we will
-        // just throw away any changes to the DB, but some new image files
-        // might be in the image directory...
+        abortCopying();
         m_eventLoop->exit(false);
-        m_pendingCopies.pop_front();
         break;
 
     case KMessageBox::No:
         m_reportUnreadableFiles = false;
         // fall through
     default:
-        aCopyJobCompleted( 0 );
+        m_progress->setValue( ++m_totalCopied );
     }
 }
 
 void ImportExport::ImportHandler::aCopyJobCompleted( KJob* job )
 {
     qCDebug(ImportExportLog) << "CopyJob" << job << "completed.";
-    m_pendingCopies.pop_front();
-    if ( job && job->error() ) {
+    if ( !m_runningCopies.contains( job ) )
+        return;
+    CopyRequest request = m_runningCopies.take( job );
+
+    if ( job->error() && request.searchUrlIndex + 1 < m_searchUrls.count() ) {
+        ++request.searchUrlIndex;
+        startCopy( request );
+        return;
+    }
+
+    if ( job->error() == KIO::ERR_DOES_NOT_EXIST || job->error() == KIO::ERR_CANNOT_OPEN_FOR_READING ) {
+        QFile::remove( request.destination );
+        aCopyFailed( request.tried );
+    }
+    else if ( job->error() ) {
         job->uiDelegate()->showErrorMessage();
+        abortCopying();
         m_eventLoop->exit(false);
     }
-    else if ( m_pendingCopies.count() == 0 ) {
-        updateDB();
-        m_eventLoop->exit(true);
+    else {
+        verifyCopy( request.info, request.destination );
     }
-    else if ( m_progress->wasCanceled() ) {
-        m_eventLoop->exit(false);
+    continueCopying();
+}
+
+void ImportExport::ImportHandler::copyVerified( const QString& relativeName, const QString& destination, const QString& md5, bool written )
+{
+    const DB::ImageInfoPtr info = m_unverifiedCopies.take( relativeName );
+    if ( !info )
+        return;
+
+    const DB::MD5 sum( md5 );
+    if ( !written ) {
+        if ( m_writeError.isNull() )
+            m_writeError = destination;
+    }
+    else if ( sum.isNull() || ( !info->MD5Sum().isNull() && sum != info->MD5Sum() ) ) {
+        qCWarning(ImportExportLog) << "Checksum of" << destination << "does not match the checksum of" << relativeName;
+        m_checksumMismatches.append( relativeName );
+        QFile::remove( destination );
     }
     else {
-        m_progress->setValue( ++m_totalCopied );
-        copyNextFromExternal();
+        m_destinations.insert( relativeName, destination );
+        m_verifiedMD5Sums.insert( relativeName, sum );
+        m_journal->copyVerified( relativeName, destination, sum );
     }
+
+    m_progress->setValue( ++m_totalCopied );
+    if ( m_settings.externalSource() )
+        continueCopying();
 }
 
 bool ImportExport::ImportHandler::isImageAlreadyInDB( const DB::ImageInfoPtr& info )
@@ -308,7 +467,7 @@ void ImportExport::ImportHandler::updateInfo( DB::ImageInfoPtr dbInfo, DB::Image
     updateCategories( newInfo, dbInfo, false );
 }
 
-void ImportExport::ImportHandler::addNewRecord( DB::ImageInfoPtr info )
+DB::ImageInfoPtr ImportExport::ImportHandler::createNewRecord( DB::ImageInfoPtr info, const DB::MD5& md5 )
 {
     const DB::FileName importName = info->fileName();
 
@@ -317,14 +476,11 @@ void ImportExport::ImportHandler::addNewRecord( DB::ImageInfoPtr info )
     updateInfo->setDescription( info->description() );
     updateInfo->setDate( info->date() );
     updateInfo->setAngle( info->angle() );
-    updateInfo->setMD5Sum( DB::MD5Sum( updateInfo->fileName() ) );
-
-
-    DB::ImageInfoList list;
-    list.append(updateInfo);
-    DB::ImageDB::instance()->addImages( list );
+    // the checksum of verified copies is known already:
+    updateInfo->setMD5Sum( md5.isNull() ? DB::MD5Sum( updateInfo->fileName() ) : md5 );
 
     updateCategories( info, updateInfo, true );
+    return updateInfo;
 }
 
 void ImportExport::ImportHandler::updateCategories( DB::ImageInfoPtr XMLInfo, DB::ImageInfoPtr DBInfo, bool forceReplace )
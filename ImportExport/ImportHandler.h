@@ -19,20 +19,31 @@
 #define IMPORTHANDLER_H
 
 #include "ImportSettings.h"
+#include <QAtomicInt>
 #include <QEventLoop>
+#include <QHash>
 #include <QPointer>
+#include <QQueue>
+#include <QThreadPool>
 #include "DB/ImageInfoPtr.h"
+#include "DB/MD5.h"
+
+#include <memory>
 
-namespace KIO { class FileCopyJob; }
 class KJob;
 namespace Utilities { class UniqFilenameMapper; }
 class QProgressDialog;
 
 namespace ImportExport {
 class KimFileReader;
+class ImportJournal;
 
 /**
  * This class contains the business logic for the import process
+ *
+ * Images are copied by several KIO jobs at a time, and every copy is verified against the MD5 sum
+ * stored in the .kim file on a worker thread. Verified copies are recorded in an ImportJournal,
+ * so an import that is interrupted does not have to copy the same files again.
  */
 class ImportHandler :public QObject
 {
@@ -44,21 +55,37 @@ public:
     bool exec( const ImportSettings& settings, KimFileReader* kimFileReader );
 
 private:
+    struct CopyRequest {
+        DB::ImageInfoPtr info;
+        int searchUrlIndex;
+        QString destination;
+        QStringList tried;
+    };
+
     void copyFromExternal();
-    void copyNextFromExternal();
+    void startNextCopies();
+    void startCopy( CopyRequest request );
+    void continueCopying();
     bool copyFilesFromZipFile();
+    bool isCopyingFinished() const;
+    bool finishCopying();
+    void abortCopying();
+    void verifyCopy( const DB::ImageInfoPtr& info, const QString& destination, const QByteArray& data = QByteArray() );
+    bool skipVerifiedCopy( const DB::ImageInfoPtr& info );
+    QString destinationFor( const DB::ImageInfoPtr& info );
     void updateDB();
 
 private slots:
     void stopCopyingImages();
     void aCopyFailed( QStringList files );
     void aCopyJobCompleted( KJob* );
+    void copyVerified( const QString& relativeName, const QString& destination, const QString& md5, bool written );
 
 private:
     bool isImageAlreadyInDB( const DB::ImageInfoPtr& info );
     DB::ImageInfoPtr matchingInfoFromDB( const DB::ImageInfoPtr& info );
     void updateInfo( DB::ImageInfoPtr dbInfo, DB::ImageInfoPtr newInfo );
-    void addNewRecord( DB::ImageInfoPtr newInfo );
+    DB::ImageInfoPtr createNewRecord( DB::ImageInfoPtr newInfo, const DB::MD5& md5 );
     void updateCategories( DB::ImageInfoPtr XMLInfo, DB::ImageInfoPtr DBInfo, bool forceReplace );
 
 private:
@@ -67,8 +94,20 @@ private:
     DB::ImageInfoList m_pendingCopies;
     QProgressDialog* m_progress;
     int m_totalCopied;
-    KIO::FileCopyJob* m_job;
+    QHash<KJob*, CopyRequest> m_runningCopies;
+    QList<QUrl> m_searchUrls;
     bool m_reportUnreadableFiles;
+    bool m_stopped;
+    /// copies and writes that have not been verified yet, by relative file name:
+    QHash<QString, DB::ImageInfoPtr> m_unverifiedCopies;
+    /// verified copies, by relative file name:
+    QHash<QString, QString> m_destinations;
+    QHash<QString, DB::MD5> m_verifiedMD5Sums;
+    QStringList m_checksumMismatches;
+    QString m_writeError;
+    std::unique_ptr<ImportJournal> m_journal;
+    QAtomicInt m_cancelVerification;
+    QThreadPool m_verifyPool;
     QPointer<QEventLoop> m_eventLoop;
     ImportSettings m_settings;
     KimFileReader* m_kimFileReader;
@@ -0,0 +1,125 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "ImportJournal.h"
+#include "Logging.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QUrl>
+
+namespace
+{
+// One line per action, all fields percent encoded and separated by a single space:
+// "copy <relative name> <destination>" or "done <relative name> <destination> <md5>"
+const char COPY_ACTION[] = "copy";
+const char DONE_ACTION[] = "done";
+
+QString journalFileName( const QString& destination, const QUrl& kimFile )
+{
+    const QByteArray hash = QCryptographicHash::hash( kimFile.toEncoded(), QCryptographicHash::Md5 ).toHex();
+    return QDir( destination ).filePath( QString::fromLatin1( ".kphotoalbum-import-%1.journal" ).arg( QString::fromLatin1( hash ) ) );
+}
+}
+
+ImportExport::ImportJournal::ImportJournal( const QString& destination, const QUrl& kimFile )
+    : m_file( journalFileName( destination, kimFile ) )
+{
+}
+
+bool ImportExport::ImportJournal::open()
+{
+    m_entries.clear();
+    if ( m_file.open( QIODevice::ReadOnly ) ) {
+        while ( !m_file.atEnd() ) {
+            const QList<QByteArray> fields = m_file.readLine().trimmed().split( ' ' );
+            if ( fields.size() < 3 )
+                continue;
+            const QString relativeName = QUrl::fromPercentEncoding( fields[1] );
+            Entry& entry = m_entries[relativeName];
+            entry.destination = QUrl::fromPercentEncoding( fields[2] );
+            if ( fields[0] == DONE_ACTION && fields.size() == 4 )
+                entry.md5 = DB::MD5( QString::fromLatin1( fields[3] ) );
+            else
+                entry.md5 = DB::MD5();
+        }
+        m_file.close();
+        qCDebug(ImportExportLog) << "Resuming import with" << m_entries.size() << "entries from journal" << m_file.fileName();
+    }
+
+    if ( !m_file.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+        qCWarning(ImportExportLog) << "Unable to open import journal" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void ImportExport::ImportJournal::remove()
+{
+    m_file.close();
+    m_file.remove();
+    m_entries.clear();
+}
+
+bool ImportExport::ImportJournal::isResumed() const
+{
+    return !m_entries.isEmpty();
+}
+
+QString ImportExport::ImportJournal::destinationFor( const QString& relativeName ) const
+{
+    return m_entries.value( relativeName ).destination;
+}
+
+bool ImportExport::ImportJournal::isVerified( const QString& relativeName ) const
+{
+    const auto it = m_entries.constFind( relativeName );
+    return it != m_entries.constEnd() && !it->md5.isNull() && QFileInfo::exists( it->destination );
+}
+
+DB::MD5 ImportExport::ImportJournal::md5For( const QString& relativeName ) const
+{
+    return m_entries.value( relativeName ).md5;
+}
+
+void ImportExport::ImportJournal::copyStarted( const QString& relativeName, const QString& destination )
+{
+    append( QString::fromLatin1( COPY_ACTION ), relativeName, destination );
+}
+
+void ImportExport::ImportJournal::copyVerified( const QString& relativeName, const QString& destination, const DB::MD5& md5 )
+{
+    append( QString::fromLatin1( DONE_ACTION ), relativeName, destination, md5.toHexString() );
+}
+
+void ImportExport::ImportJournal::append( const QString& action, const QString& relativeName, const QString& destination, const QString& md5 )
+{
+    if ( !m_file.isOpen() )
+        return;
+
+    QByteArray line = action.toLatin1() + ' ' + QUrl::toPercentEncoding( relativeName ) + ' ' + QUrl::toPercentEncoding( destination );
+    if ( !md5.isEmpty() )
+        line += ' ' + md5.toLatin1();
+    line += '\n';
+    m_file.write( line );
+    // the journal is only useful if it survives a crash of the application:
+    m_file.flush();
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,94 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef IMPORTEXPORT_IMPORTJOURNAL_H
+#define IMPORTEXPORT_IMPORTJOURNAL_H
+
+#include <DB/MD5.h>
+
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+class QUrl;
+
+namespace ImportExport
+{
+
+/**
+ * \brief Record of the files an import has already copied into the image directory.
+ *
+ * The journal is kept as a hidden file in the destination directory of the import, named after
+ * the .kim file it belongs to. Every copy is logged twice: once when it is started, and once
+ * when the MD5 sum of the copy has been verified.
+ *
+ * If an import is interrupted and the same .kim file is imported into the same directory again,
+ * verified files are not copied again, and files that were in the middle of being copied are
+ * overwritten instead of being copied to a new unique name.
+ *
+ * The journal is removed when the database has been updated with the imported images.
+ */
+class ImportJournal
+{
+public:
+    ImportJournal( const QString& destination, const QUrl& kimFile );
+
+    /**
+     * Read the entries of a previous import of the same file, and open the journal for writing.
+     * @return \c false if the journal could not be opened; imports work nevertheless, they just can't be resumed.
+     */
+    bool open();
+    /**
+     * Delete the journal file.
+     */
+    void remove();
+
+    /**
+     * @return \c true if a previous import of the file has been interrupted.
+     */
+    bool isResumed() const;
+
+    /**
+     * @return the destination file for \p relativeName that was used by a previous import, or a null string.
+     */
+    QString destinationFor( const QString& relativeName ) const;
+    /**
+     * @return \c true if a previous import already copied and verified \p relativeName,
+     * and the copy still exists.
+     */
+    bool isVerified( const QString& relativeName ) const;
+    DB::MD5 md5For( const QString& relativeName ) const;
+
+    void copyStarted( const QString& relativeName, const QString& destination );
+    void copyVerified( const QString& relativeName, const QString& destination, const DB::MD5& md5 );
+
+private:
+    struct Entry {
+        QString destination;
+        DB::MD5 md5;
+    };
+    void append( const QString& action, const QString& relativeName, const QString& destination, const QString& md5 = QString() );
+
+    QFile m_file;
+    QHash<QString, Entry> m_entries;
+};
+
+}
+
+#endif /* IMPORTEXPORT_IMPORTJOURNAL_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,87 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "ScaleImageTask.h"
+#include "Logging.h"
+
+#include <ImageManager/ImageDecoder.h>
+#include <Utilities/FastJpeg.h>
+#include <Utilities/Util.h>
+
+#include <QBuffer>
+#include <QImage>
+#include <QMetaObject>
+#include <QObject>
+#include <QTransform>
+
+ImportExport::ScaleImageTask::ScaleImageTask( QObject* receiver, const QAtomicInt* cancelled,
+                                              const DB::FileName& fileName, int maxSize, int angle, const QByteArray& format )
+    : m_receiver( receiver )
+    , m_cancelled( cancelled )
+    , m_fileName( fileName )
+    , m_maxSize( maxSize )
+    , m_angle( angle )
+    , m_format( format )
+{
+}
+
+void ImportExport::ScaleImageTask::run()
+{
+    if ( m_cancelled->load() )
+        return;
+
+    const QByteArray data = scaleAndEncode();
+    QMetaObject::invokeMethod( m_receiver, "imageScaled", Qt::QueuedConnection,
+                               Q_ARG( DB::FileName, m_fileName ), Q_ARG( QByteArray, data ) );
+}
+
+QByteArray ImportExport::ScaleImageTask::scaleAndEncode() const
+{
+    QImage image;
+    QSize fullSize;
+    bool ok = false;
+    if ( m_fileName.exists() ) {
+        if ( Utilities::isJPEG( m_fileName ) )
+            ok = Utilities::loadJPEG( &image, m_fileName, &fullSize, m_maxSize );
+        else
+            ok = ImageManager::ImageDecoder::decode( &image, m_fileName, &fullSize, m_maxSize );
+        if ( !ok )
+            ok = image.load( m_fileName.absolute() );
+    }
+    if ( !ok ) {
+        qCWarning(ImportExportLog) << "Unable to load image" << m_fileName.absolute();
+        return QByteArray();
+    }
+
+    if ( m_angle != 0 ) {
+        QTransform transform;
+        transform.rotate( m_angle );
+        image = image.transformed( transform );
+    }
+
+    if ( image.width() > m_maxSize || image.height() > m_maxSize )
+        image = Utilities::scaleImage( image, m_maxSize, m_maxSize, Qt::KeepAspectRatio );
+
+    QByteArray data;
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+    image.save( &buffer, m_format.constData() );
+    return data;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,63 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef IMPORTEXPORT_SCALEIMAGETASK_H
+#define IMPORTEXPORT_SCALEIMAGETASK_H
+
+#include <DB/FileName.h>
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QRunnable>
+
+class QObject;
+
+namespace ImportExport
+{
+
+/**
+ * \brief Decode, scale and encode one image for the Export on a worker thread.
+ *
+ * The encoded data is handed back to the receiver by calling its slot
+ * <tt>imageScaled(DB::FileName, QByteArray)</tt> through a queued connection.
+ * An empty byte array means the image could not be loaded.
+ *
+ * Writing the data is left to the receiver, as KZip must only be used from one thread.
+ */
+class ScaleImageTask : public QRunnable
+{
+public:
+    ScaleImageTask( QObject* receiver, const QAtomicInt* cancelled,
+                    const DB::FileName& fileName, int maxSize, int angle, const QByteArray& format );
+    void run() override;
+
+private:
+    QByteArray scaleAndEncode() const;
+
+    QObject* m_receiver;
+    const QAtomicInt* m_cancelled;
+    DB::FileName m_fileName;
+    int m_maxSize;
+    int m_angle;
+    QByteArray m_format;
+};
+
+}
+
+#endif /* IMPORTEXPORT_SCALEIMAGETASK_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
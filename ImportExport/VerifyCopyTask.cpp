@@ -0,0 +1,63 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "VerifyCopyTask.h"
+#include "Logging.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QMetaObject>
+#include <QObject>
+
+ImportExport::VerifyCopyTask::VerifyCopyTask( QObject* receiver, const QAtomicInt* cancelled,
+                                              const QString& relativeName, const QString& destination, const QByteArray& data )
+    : m_receiver( receiver )
+    , m_cancelled( cancelled )
+    , m_relativeName( relativeName )
+    , m_destination( destination )
+    , m_data( data )
+{
+}
+
+void ImportExport::VerifyCopyTask::run()
+{
+    if ( m_cancelled->load() )
+        return;
+
+    bool written = true;
+    QString md5;
+    if ( m_data.isNull() ) {
+        QFile in( m_destination );
+        QCryptographicHash md5calculator( QCryptographicHash::Md5 );
+        if ( in.open( QIODevice::ReadOnly ) && md5calculator.addData( &in ) )
+            md5 = QString::fromLatin1( md5calculator.result().toHex() );
+    } else {
+        QFile out( m_destination );
+        written = out.open( QIODevice::WriteOnly ) && out.write( m_data ) == m_data.size();
+        if ( written )
+            md5 = QString::fromLatin1( QCryptographicHash::hash( m_data, QCryptographicHash::Md5 ).toHex() );
+        else
+            qCWarning(ImportExportLog) << "Unable to write" << m_destination << out.errorString();
+    }
+
+    QMetaObject::invokeMethod( m_receiver, "copyVerified", Qt::QueuedConnection,
+                               Q_ARG( QString, m_relativeName ), Q_ARG( QString, m_destination ),
+                               Q_ARG( QString, md5 ), Q_ARG( bool, written ) );
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
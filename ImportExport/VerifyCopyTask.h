@@ -0,0 +1,62 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef IMPORTEXPORT_VERIFYCOPYTASK_H
+#define IMPORTEXPORT_VERIFYCOPYTASK_H
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QRunnable>
+#include <QString>
+
+class QObject;
+
+namespace ImportExport
+{
+
+/**
+ * \brief Calculate the MD5 sum of an imported file on a worker thread.
+ *
+ * If the task is given the content of the file (i.e. for images that are stored inside the .kim file),
+ * the data is written to the destination first, and the checksum is calculated from the data in memory.
+ * Otherwise the destination file is read back from disk.
+ *
+ * The result is handed back to the receiver by calling its slot
+ * <tt>copyVerified(QString relativeName, QString destination, QString md5, bool written)</tt>
+ * through a queued connection. \c written is \c false if the data could not be written,
+ * and the MD5 sum is empty if the file could not be read.
+ */
+class VerifyCopyTask : public QRunnable
+{
+public:
+    VerifyCopyTask( QObject* receiver, const QAtomicInt* cancelled,
+                    const QString& relativeName, const QString& destination, const QByteArray& data = QByteArray() );
+    void run() override;
+
+private:
+    QObject* m_receiver;
+    const QAtomicInt* m_cancelled;
+    QString m_relativeName;
+    QString m_destination;
+    QByteArray m_data;
+};
+
+}
+
+#endif /* IMPORTEXPORT_VERIFYCOPYTASK_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -94,6 +94,10 @@ AutoStackImages::AutoStackImages( QWidget* parent, const DB::FileNameList& list
     QLabel* sec = new QLabel( i18nc( "The whole sentence should read: *Stack images that are shot within x seconds of each other*. (This being the text after x.)", "seconds" ), containerContinuous );
     hlayContinuous->addWidget( sec );
 
+    // how many images the current settings would stack:
+    m_continuousPreview = new QLabel( containerContinuous );
+    hlayContinuous->addWidget( m_continuousPreview );
+
     QGroupBox* grpOptions = new QGroupBox( i18n("AutoStacking Options") );
     QVBoxLayout* grpLayOptions = new QVBoxLayout( grpOptions );
     lay1->addWidget( grpOptions );
@@ -117,6 +121,12 @@ AutoStackImages::AutoStackImages( QWidget* parent, const DB::FileNameList& list
     connect(buttonBox, &QDialogButtonBox::accepted, this, &AutoStackImages::accept);
     connect(buttonBox, &QDialogButtonBox::rejected, this, &AutoStackImages::reject);
     lay1->addWidget(buttonBox);
+
+    connect( m_continuousShooting, &QCheckBox::toggled, this, &AutoStackImages::updateContinuousPreview );
+    connect( m_continuousThreshold, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &AutoStackImages::updateContinuousPreview );
+    connect( m_autostackDefault, &QRadioButton::toggled, this, &AutoStackImages::updateContinuousPreview );
+    connect( m_autostackUnstack, &QRadioButton::toggled, this, &AutoStackImages::updateContinuousPreview );
+    connect( m_autostackSkip, &QRadioButton::toggled, this, &AutoStackImages::updateContinuousPreview );
 }
 
 /*
@@ -259,53 +269,30 @@ void AutoStackImages::matchingFile( DB::FileNameList& toBeShown )
 
 void AutoStackImages::continuousShooting(DB::FileNameList &toBeShown )
 {
-    DB::ImageInfoPtr prev;
-    Q_FOREACH(const DB::FileName& fileName, m_list) {
-        DB::ImageInfoPtr info = fileName.info();
-        // Skipping images that do not have exact time stamp
-        if ( info->date().start() != info->date().end() )
-            continue;
-        if ( prev && ( prev->date().start().secsTo( info->date().start() ) < m_continuousThreshold->value() ) ) {
-            DB::FileNameList stack;
-
-            if ( !DB::ImageDB::instance()->getStackFor( prev->fileName() ).isEmpty() ) {
-                if ( m_autostackUnstack->isChecked() )
-                    DB::ImageDB::instance()->unstack( DB::FileNameList() << prev->fileName());
-                else if ( m_autostackSkip->isChecked() )
-                    continue;
-            }
-
-            if ( !DB::ImageDB::instance()->getStackFor(fileName).isEmpty() ) {
-                if ( m_autostackUnstack->isChecked() )
-                    DB::ImageDB::instance()->unstack( DB::FileNameList() << fileName);
-                else if ( m_autostackSkip->isChecked() )
-                    continue;
-            }
+    ContinuousShootingStacker stacker( m_list, m_continuousThreshold->value(), stackedImages() );
+    toBeShown.append( stacker.apply() );
+}
 
-            stack.append(prev->fileName());
-            stack.append(info->fileName());
-            if ( !toBeShown.isEmpty() ) {
-                if ( toBeShown.at( toBeShown.size() - 1 ).info()->fileName() != prev->fileName() )
-                    toBeShown.append(prev->fileName());
-            } else {
-                // if this is first insert, we have to include also the stacked images from previuous image
-                if ( !DB::ImageDB::instance()->getStackFor( info->fileName() ).isEmpty() )
-                    Q_FOREACH( const DB::FileName& a, DB::ImageDB::instance()->getStackFor( prev->fileName() ) )
-                        toBeShown.append( a );
-                else
-                    toBeShown.append(prev->fileName());
-            }
-            // Inserting stacked images from the current image
-            if ( !DB::ImageDB::instance()->getStackFor( info->fileName() ).isEmpty() )
-                Q_FOREACH( const DB::FileName& a, DB::ImageDB::instance()->getStackFor(fileName))
-                    toBeShown.append( a );
-            else
-                toBeShown.append(info->fileName());
-            DB::ImageDB::instance()->stack(stack);
-        }
+ContinuousShootingStacker::StackedImages AutoStackImages::stackedImages() const
+{
+    if ( m_autostackUnstack->isChecked() )
+        return ContinuousShootingStacker::Unstack;
+    if ( m_autostackSkip->isChecked() )
+        return ContinuousShootingStacker::Skip;
+    return ContinuousShootingStacker::AddToStack;
+}
 
-        prev = info;
+void AutoStackImages::updateContinuousPreview()
+{
+    if ( !m_continuousShooting->isChecked() ) {
+        m_continuousPreview->clear();
+        return;
     }
+
+    const ContinuousShootingStacker stacker( m_list, m_continuousThreshold->value(), stackedImages() );
+    m_continuousPreview->setText( i18np( "1 stack", "%1 stacks", stacker.stackCount() )
+                                  + QString::fromLatin1( ", " )
+                                  + i18np( "1 image", "%1 images", stacker.imageCount() ) );
 }
 
 void AutoStackImages::accept()
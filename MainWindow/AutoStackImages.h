@@ -19,9 +19,12 @@
 #ifndef AUTOSTACKIMAGES_H
 #define AUTOSTACKIMAGES_H
 
+#include "ContinuousShootingStacker.h"
+
 #include <QDialog>
 
 class QCheckBox;
+class QLabel;
 class QSpinBox;
 class QRadioButton;
 
@@ -39,6 +42,9 @@ public:
 protected slots:
     virtual void accept();
 
+private slots:
+    void updateContinuousPreview();
+
 private:
     QCheckBox* m_matchingMD5;
     QCheckBox* m_matchingFile;
@@ -48,10 +54,12 @@ private:
     QRadioButton* m_autostackSkip;
     QRadioButton* m_autostackDefault;
     QSpinBox* m_continuousThreshold;
+    QLabel* m_continuousPreview;
     const DB::FileNameList& m_list;
     virtual void matchingMD5( DB::FileNameList &toBeShown );
     virtual void matchingFile( DB::FileNameList &toBeShown );
     virtual void continuousShooting( DB::FileNameList &toBeShown );
+    ContinuousShootingStacker::StackedImages stackedImages() const;
 };
 
 }
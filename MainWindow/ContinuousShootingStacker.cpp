@@ -0,0 +1,110 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "ContinuousShootingStacker.h"
+
+#include <DB/ImageDB.h>
+#include <DB/ImageInfo.h>
+
+#include <QDateTime>
+#include <QVector>
+
+#include <algorithm>
+
+namespace
+{
+struct Shot {
+    QDateTime time;
+    DB::FileName fileName;
+    DB::StackID stackId;
+};
+}
+
+MainWindow::ContinuousShootingStacker::ContinuousShootingStacker( const DB::FileNameList& images, int thresholdSeconds, StackedImages stackedImages )
+    : m_imageCount( 0 )
+    , m_stackedImages( stackedImages )
+{
+    QVector<Shot> shots;
+    shots.reserve( images.size() );
+    Q_FOREACH( const DB::FileName& fileName, images ) {
+        const DB::ImageInfoPtr info = fileName.info();
+        // Skipping images that do not have exact time stamp
+        if ( !info || info->date().start() != info->date().end() )
+            continue;
+
+        DB::StackID stackId = DB::ImageDB::instance()->getStackId( fileName );
+        if ( stackId != 0 && stackedImages == Skip )
+            continue;
+        if ( stackedImages == Unstack )
+            stackId = 0;
+        shots.append( Shot { info->date().start(), fileName, stackId } );
+    }
+
+    std::stable_sort( shots.begin(), shots.end(), []( const Shot& a, const Shot& b ) { return a.time < b.time; } );
+
+    // A burst can only go into one existing stack, so an image of a second stack starts a new one.
+    DB::FileNameList burst;
+    DB::StackID burstStackId = 0;
+    int unstackedInBurst = 0;
+    for ( int i = 0; i <= shots.size(); ++i ) {
+        const bool endsBurst = ( i == shots.size() )
+                || ( i > 0 && shots[i-1].time.secsTo( shots[i].time ) >= thresholdSeconds )
+                || ( burstStackId != 0 && shots[i].stackId != 0 && shots[i].stackId != burstStackId );
+        if ( endsBurst ) {
+            if ( burst.size() > 1 && unstackedInBurst > 0 ) {
+                m_stacks.append( burst );
+                m_imageCount += unstackedInBurst;
+            }
+            burst.clear();
+            burstStackId = 0;
+            unstackedInBurst = 0;
+        }
+        if ( i == shots.size() )
+            break;
+
+        burst.append( shots[i].fileName );
+        if ( shots[i].stackId == 0 )
+            ++unstackedInBurst;
+        else
+            burstStackId = shots[i].stackId;
+    }
+}
+
+int MainWindow::ContinuousShootingStacker::stackCount() const
+{
+    return m_stacks.size();
+}
+
+int MainWindow::ContinuousShootingStacker::imageCount() const
+{
+    return m_imageCount;
+}
+
+DB::FileNameList MainWindow::ContinuousShootingStacker::apply()
+{
+    DB::FileNameList result;
+    if ( m_stacks.isEmpty() )
+        return result;
+
+    DB::ImageDB::instance()->stackAll( m_stacks, m_stackedImages == Unstack );
+    Q_FOREACH( const DB::FileNameList& stack, m_stacks )
+        result.append( DB::ImageDB::instance()->getStackFor( stack.first() ) );
+    return result;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
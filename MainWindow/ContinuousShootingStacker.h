@@ -0,0 +1,75 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef CONTINUOUSSHOOTINGSTACKER_H
+#define CONTINUOUSSHOOTINGSTACKER_H
+
+#include <DB/FileNameList.h>
+
+#include <QList>
+
+namespace MainWindow
+{
+
+/**
+ * \brief Find the images that were shot in one burst, and stack them together.
+ *
+ * The images with an exact time stamp are sorted by it once. Every run of images
+ * that were each shot within the threshold of the previous one becomes one stack.
+ *
+ * Finding the stacks does not change the database, so stackCount() and imageCount()
+ * can be shown before anything is stacked. apply() then creates all stacks at once.
+ */
+class ContinuousShootingStacker
+{
+public:
+    /**
+     * What to do with images that are already in a stack.
+     */
+    enum StackedImages {
+        AddToStack, ///< add the other images of the burst to the stack, unless the burst has images of several stacks
+        Unstack, ///< take the image out of its stack, and make a new one for the burst
+        Skip ///< leave the image alone
+    };
+
+    ContinuousShootingStacker( const DB::FileNameList& images, int thresholdSeconds, StackedImages stackedImages );
+
+    /**
+     * @return the number of stacks that apply() would create or add images to.
+     */
+    int stackCount() const;
+    /**
+     * @return the number of images that apply() would add to a stack.
+     */
+    int imageCount() const;
+
+    /**
+     * Stack the images.
+     * @return all images of the stacks that were created or added to.
+     */
+    DB::FileNameList apply();
+
+private:
+    QList<DB::FileNameList> m_stacks;
+    int m_imageCount;
+    StackedImages m_stackedImages;
+};
+
+}
+
+#endif /* CONTINUOUSSHOOTINGSTACKER_H */
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -33,7 +33,9 @@
 #include <DB/ImageDB.h>
 #include <DB/ImageInfo.h>
 #include <DB/ImageInfoPtr.h>
+#include <DB/MD5.h>
 #include <ImageManager/AsyncLoader.h>
+#include <ImageManager/ImageRequest.h>
 #include <Utilities/DeleteFiles.h>
 
 #include "MergeToolTip.h"
@@ -44,17 +46,37 @@ DuplicateMatch::DuplicateMatch(const DB::FileNameList& files )
 {
     QVBoxLayout* topLayout = new QVBoxLayout(this);
 
+    // Similar images may still differ, so every one of them is shown:
+    QHBoxLayout* imagesLayout = new QHBoxLayout;
+    topLayout->addLayout(imagesLayout);
+    const QSize imageSize = files.size() > 2 ? QSize(150,150) : QSize(300,300);
+    Q_FOREACH(const DB::FileName& fileName, files) {
+        QLabel* image = new QLabel;
+        image->setMinimumSize(imageSize);
+        imagesLayout->addWidget(image);
+        m_images.insert(fileName, image);
+    }
+    imagesLayout->addStretch(1);
+
     QHBoxLayout* horizontalLayout = new QHBoxLayout;
     topLayout->addLayout(horizontalLayout);
-    m_image = new QLabel;
-    horizontalLayout->addWidget(m_image);
 
     QVBoxLayout* rightSideLayout = new QVBoxLayout;
-    horizontalLayout->addSpacing(20);
     horizontalLayout->addLayout(rightSideLayout);
     horizontalLayout->addStretch(1);
     rightSideLayout->addStretch(1);
 
+    const DB::MD5 md5 = DB::ImageDB::instance()->info(files.first())->MD5Sum();
+    m_identical = true;
+    Q_FOREACH(const DB::FileName& fileName, files) {
+        if (DB::ImageDB::instance()->info(fileName)->MD5Sum() != md5)
+            m_identical = false;
+    }
+    if (!m_identical) {
+        QLabel* warning = new QLabel(i18n("<b>These images are only similar, not identical.</b> Compare them before merging."));
+        rightSideLayout->addWidget(warning);
+    }
+
     m_merge = new QCheckBox(i18n("Merge these images"));
     rightSideLayout->addWidget(m_merge);
     m_merge->setChecked(false);
@@ -92,15 +114,19 @@ DuplicateMatch::DuplicateMatch(const DB::FileNameList& files )
     line->setFrameStyle(QFrame::HLine);
     topLayout->addWidget(line);
 
-    const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(files.first());
-    const int angle = info->angle();
-    ImageManager::ImageRequest* request = new ImageManager::ImageRequest(files.first(), QSize(300,300), angle, this);
-    ImageManager::AsyncLoader::instance()->load(request);
+    Q_FOREACH(const DB::FileName& fileName, files) {
+        const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
+        const int angle = info->angle();
+        ImageManager::ImageRequest* request = new ImageManager::ImageRequest(fileName, imageSize, angle, this);
+        ImageManager::AsyncLoader::instance()->load(request);
+    }
 }
 
-void DuplicateMatch::pixmapLoaded(ImageManager::ImageRequest* /*request*/, const QImage& image)
+void DuplicateMatch::pixmapLoaded(ImageManager::ImageRequest* request, const QImage& image)
 {
-    m_image->setPixmap(QPixmap::fromImage(image));
+    QLabel* label = m_images.value(request->databaseFileName());
+    if (label)
+        label->setPixmap(QPixmap::fromImage(image));
 }
 
 void DuplicateMatch::setSelected(bool b)
@@ -113,6 +139,11 @@ bool DuplicateMatch::selected() const
     return m_merge->isChecked();
 }
 
+bool DuplicateMatch::isIdentical() const
+{
+    return m_identical;
+}
+
 void DuplicateMatch::execute(Utilities::DeleteMethod method)
 {
     if (!m_merge->isChecked())
@@ -20,6 +20,7 @@
 #ifndef MAINWINDOW_DUPLICATEMATCH_H
 #define MAINWINDOW_DUPLICATEMATCH_H
 
+#include <QHash>
 #include <QList>
 #include <QWidget>
 
@@ -44,6 +45,10 @@ public:
     void pixmapLoaded(ImageManager::ImageRequest* request, const QImage& image) override;
     void setSelected(bool);
     bool selected() const;
+    /**
+     * @return \c true if all images of the match are the same file, and not just similar.
+     */
+    bool isIdentical() const;
     void execute(Utilities::DeleteMethod);
     bool eventFilter(QObject *, QEvent *) override;
 
@@ -51,8 +56,9 @@ signals:
     void selectionChanged();
 
 private:
-    QLabel* m_image;
+    QHash<DB::FileName, QLabel*> m_images;
     QCheckBox* m_merge;
+    bool m_identical;
     QList<QRadioButton*> m_buttons;
 };
 
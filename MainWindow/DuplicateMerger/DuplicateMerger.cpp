@@ -17,7 +17,12 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <QCheckBox>
+#include <QHash>
+#include <QImage>
+#include <QRunnable>
 #include <QScrollArea>
+#include <QThreadPool>
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QRadioButton>
@@ -37,6 +42,39 @@
 #include "DB/FileNameList.h"
 #include "DB/ImageInfo.h"
 #include "DB/MD5.h"
+#include "DB/PerceptualHashIndex.h"
+#include "ImageManager/ThumbnailCache.h"
+#include "MainWindow/DirtyIndicator.h"
+#include "Utilities/PerceptualHash.h"
+#include "Utilities/Util.h"
+
+namespace
+{
+// How many bits the perceptual hashes of two images may differ in for them to be considered similar.
+constexpr int SIMILAR_DISTANCE = 6;
+// How many thumbnails to decode at once when hashing the ones from before perceptual hashes existed.
+constexpr int HASH_BATCH_SIZE = 1000;
+
+class HashThumbnailTask : public QRunnable
+{
+public:
+    HashThumbnailTask(const QByteArray* data, quint64* hash)
+        : m_data(data), m_hash(hash)
+    {
+    }
+
+    void run() override
+    {
+        QImage image;
+        if (image.loadFromData(*m_data, "JPG"))
+            *m_hash = Utilities::perceptualHash(image);
+    }
+
+private:
+    const QByteArray* m_data;
+    quint64* m_hash;
+};
+}
 
 namespace MainWindow {
 
@@ -59,6 +97,10 @@ DuplicateMerger::DuplicateMerger(QWidget *parent) : QDialog(parent)
     label->setFont(fnt);
     topLayout->addWidget(label);
 
+    m_includeSimilar = new QCheckBox(i18n("Also find &similar images, like resized or re-encoded copies"));
+    topLayout->addWidget(m_includeSimilar);
+    connect(m_includeSimilar, &QCheckBox::toggled, this, &DuplicateMerger::findDuplicates);
+
     m_trash = new QRadioButton(i18n("Move to &trash"));
     m_deleteFromDisk = new QRadioButton(i18n("&Delete from disk"));
     QRadioButton* blockFromDB = new QRadioButton(i18n("&Block from database"));
@@ -84,6 +126,7 @@ DuplicateMerger::DuplicateMerger(QWidget *parent) : QDialog(parent)
     QDialogButtonBox* buttonBox = new QDialogButtonBox();
 
     m_selectAllButton = buttonBox->addButton(i18n("Select &All"), QDialogButtonBox::YesRole);
+    m_selectAllButton->setToolTip(i18n("Select all identical images. Images that are only similar have to be selected one by one."));
     m_selectNoneButton = buttonBox->addButton(i18n("Select &None"), QDialogButtonBox::NoRole);
     m_okButton = buttonBox->addButton(QDialogButtonBox::Ok);
     m_cancelButton = buttonBox->addButton(QDialogButtonBox::Cancel);
@@ -148,52 +191,147 @@ void DuplicateMerger::updateSelectionCount()
 void DuplicateMerger::findDuplicates()
 {
     Utilities::ShowBusyCursor dummy;
+    clearRows();
 
-    Q_FOREACH( const DB::FileName& fileName, DB::ImageDB::instance()->images() ) {
+    const DB::FileNameList images = DB::ImageDB::instance()->images();
+    const QList<DB::FileNameList> groups = m_includeSimilar->isChecked() ? similarImages(images) : identicalImages(images);
+    Q_FOREACH( const DB::FileNameList& group, groups ) {
+        addRow(group);
+    }
+
+    if (groups.isEmpty()) {
+        tellThatNoDuplicatesWereFound();
+    }
+
+    updateSelectionCount();
+}
+
+QList<DB::FileNameList> DuplicateMerger::identicalImages(const DB::FileNameList& images) const
+{
+    QMap<DB::MD5, DB::FileNameList> matches;
+    Q_FOREACH( const DB::FileName& fileName, images ) {
         const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
-        const DB::MD5 md5 = info->MD5Sum();
-        m_matches[md5].append(fileName);
+        matches[info->MD5Sum()].append(fileName);
     }
 
-    bool anyFound = false;
-    for (QMap<DB::MD5, DB::FileNameList>::const_iterator it = m_matches.constBegin();
-         it != m_matches.constEnd(); ++it)
+    QList<DB::FileNameList> result;
+    for (QMap<DB::MD5, DB::FileNameList>::const_iterator it = matches.constBegin();
+         it != matches.constEnd(); ++it)
     {
-        if (it.value().count() > 1) {
-            addRow(it.key());
-            anyFound = true;
-        }
+        if (it.value().count() > 1)
+            result.append(it.value());
     }
+    return result;
+}
 
-    if (! anyFound) {
-        tellThatNoDuplicatesWereFound();
+QList<DB::FileNameList> DuplicateMerger::similarImages(const DB::FileNameList& images) const
+{
+    hashCachedThumbnails(images);
+
+    // Identical files look identical, even if only one of them has a thumbnail yet.
+    QHash<DB::MD5, quint64> hashOfMD5;
+    Q_FOREACH( const DB::FileName& fileName, images ) {
+        const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
+        if (info->perceptualHash() != 0)
+            hashOfMD5.insert(info->MD5Sum(), info->perceptualHash());
     }
 
-    updateSelectionCount();
+    QVector<quint64> hashes;
+    hashes.reserve(images.size());
+    Q_FOREACH( const DB::FileName& fileName, images ) {
+        const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
+        hashes.append(info->perceptualHash() != 0 ? info->perceptualHash() : hashOfMD5.value(info->MD5Sum()));
+    }
+
+    QList<DB::FileNameList> result;
+    const DB::PerceptualHashIndex index(hashes);
+    for ( const QVector<int>& cluster : index.clusters(SIMILAR_DISTANCE) ) {
+        DB::FileNameList group;
+        for ( int i : cluster )
+            group.append(images.at(i));
+        result.append(group);
+    }
+
+    // Images without any hash can still be identical:
+    Q_FOREACH( const DB::FileNameList& group, identicalImages(images) ) {
+        if (group.first().info()->perceptualHash() == 0 && !hashOfMD5.contains(group.first().info()->MD5Sum()))
+            result.append(group);
+    }
+    return result;
+}
+
+/**
+ * Images get their perceptual hash when their thumbnail is built.
+ * Images whose thumbnail was built before that get it from the thumbnail cache here.
+ */
+void DuplicateMerger::hashCachedThumbnails(const DB::FileNameList& images) const
+{
+    ImageManager::ThumbnailCache* cache = ImageManager::ThumbnailCache::instance();
+    DB::FileNameList missing;
+    Q_FOREACH( const DB::FileName& fileName, images ) {
+        const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
+        if (info->perceptualHash() == 0 && !Utilities::isVideo(fileName) && cache->contains(fileName))
+            missing.append(fileName);
+    }
+
+    QThreadPool pool;
+    for ( int begin = 0; begin < missing.size(); begin += HASH_BATCH_SIZE ) {
+        const int end = qMin(begin + HASH_BATCH_SIZE, missing.size());
+
+        // the thumbnail cache must only be used from this thread, decoding and hashing may go anywhere:
+        QVector<QByteArray> data(end - begin);
+        QVector<quint64> hashes(end - begin, 0);
+        for ( int i = begin; i < end; ++i ) {
+            data[i - begin] = cache->lookupRawData(missing.at(i));
+            pool.start(new HashThumbnailTask(&data[i - begin], &hashes[i - begin]));
+        }
+        pool.waitForDone();
+
+        for ( int i = begin; i < end; ++i ) {
+            if (hashes[i - begin] != 0) {
+                DB::ImageDB::instance()->info(missing.at(i))->setPerceptualHash(hashes[i - begin]);
+                MainWindow::DirtyIndicator::markDirty();
+            }
+        }
+    }
 }
 
-void DuplicateMerger::addRow(const DB::MD5 &md5)
+void DuplicateMerger::addRow(const DB::FileNameList& files)
 {
-    DuplicateMatch* match = new DuplicateMatch( m_matches[md5]);
+    DuplicateMatch* match = new DuplicateMatch(files);
     connect( match, SIGNAL(selectionChanged()), this, SLOT(updateSelectionCount()));
     m_scrollLayout->addWidget(match);
     m_selectors.append(match);
 }
 
+void DuplicateMerger::clearRows()
+{
+    qDeleteAll(m_selectors);
+    m_selectors.clear();
+    delete m_noDuplicatesLabel;
+    m_noDuplicatesLabel = nullptr;
+
+    m_selectAllButton->setEnabled(true);
+    m_selectNoneButton->setEnabled(true);
+    m_okButton->setEnabled(true);
+}
+
 void DuplicateMerger::selectAll(bool b)
 {
     Q_FOREACH( DuplicateMatch* selector, m_selectors) {
-        selector->setSelected(b);
+        // merging similar images throws one of them away, so they have to be selected one by one:
+        if (!b || selector->isIdentical())
+            selector->setSelected(b);
     }
 }
 
 void DuplicateMerger::tellThatNoDuplicatesWereFound()
 {
-    QLabel* label = new QLabel(i18n("No duplicates found"));
+    m_noDuplicatesLabel = new QLabel(i18n("No duplicates found"));
     QFont fnt = font();
     fnt.setPixelSize(30);
-    label->setFont(fnt);
-    m_scrollLayout->addWidget(label);
+    m_noDuplicatesLabel->setFont(fnt);
+    m_scrollLayout->addWidget(m_noDuplicatesLabel);
 
     m_selectAllButton->setEnabled(false);
     m_selectNoneButton->setEnabled(false);
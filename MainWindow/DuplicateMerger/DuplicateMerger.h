@@ -27,6 +27,7 @@
 #include <DB/MD5.h>
 #include <DB/FileNameList.h>
 
+class QCheckBox;
 class QVBoxLayout;
 class QRadioButton;
 class QLabel;
@@ -49,21 +50,25 @@ private slots:
     void selectNone();
     void go();
     void updateSelectionCount();
+    void findDuplicates();
 
 private:
-    void findDuplicates();
-    void addRow(const DB::MD5&);
+    QList<DB::FileNameList> identicalImages(const DB::FileNameList& images) const;
+    QList<DB::FileNameList> similarImages(const DB::FileNameList& images) const;
+    void hashCachedThumbnails(const DB::FileNameList& images) const;
+    void addRow(const DB::FileNameList& files);
+    void clearRows();
     void selectAll(bool b);
     void tellThatNoDuplicatesWereFound();
 
-    QMap<DB::MD5, DB::FileNameList> m_matches;
-
     QWidget* m_container;
     QVBoxLayout* m_scrollLayout;
     QList<DuplicateMatch*> m_selectors;
     QRadioButton* m_trash;
     QRadioButton *m_deleteFromDisk;
+    QCheckBox* m_includeSimilar;
     QLabel* m_selectionCount;
+    QLabel* m_noDuplicatesLabel = nullptr;
 
     QPushButton* m_selectAllButton;
     QPushButton* m_selectNoneButton;
@@ -74,6 +74,7 @@
 #include <Browser/BrowserWidget.h>
 #include <DateBar/DateBarWidget.h>
 #include <DB/CategoryCollection.h>
+#include <DB/CategoryImageCache.h>
 #include <DB/ImageDateCollection.h>
 #include <DB/ImageDB.h>
 #include <DB/ImageInfo.h>
@@ -213,6 +214,8 @@ MainWindow::Window::Window( QWidget* parent )
 
     connect(m_thumbnailView, &ThumbnailView::ThumbnailFacade::fileIdUnderCursorChanged, this, &Window::slotSetFileName);
     connect( DB::ImageDB::instance(), SIGNAL(totalChanged(uint)), this, SLOT(updateDateBar()) );
+    connect( DB::ImageDB::instance(), &DB::ImageDB::saveProgress, this, &Window::slotSaveProgress );
+    connect( DB::ImageDB::instance(), &DB::ImageDB::saveFinished, this, &Window::slotSaveFinished );
     connect( DB::ImageDB::instance()->categoryCollection(), SIGNAL(categoryCollectionChanged()), this, SLOT(slotOptionGroupChanged()) );
     connect( m_browser, SIGNAL(imageCount(uint)), m_statusBar->mp_partial, SLOT(showBrowserMatches(uint)) );
     connect(m_thumbnailView, &ThumbnailView::ThumbnailFacade::selectionChanged, this, &Window::updateContextMenuFromSelectionSize);
@@ -234,6 +237,7 @@ MainWindow::Window::~Window()
 {
     DB::ImageDB::deleteInstance();
     ImageManager::ThumbnailCache::deleteInstance();
+    DB::CategoryImageCache::deleteInstance();
     Exif::Database::deleteInstance();
 }
 
@@ -302,6 +306,7 @@ bool MainWindow::Window::slotExit()
         if ( ret == KMessageBox::Cancel )
             return false;
         else if ( ret == KMessageBox::Yes ) {
+            DB::ImageDB::instance()->waitForSaves();
             Utilities::deleteDemo();
             goto doQuit;
         }
@@ -320,9 +325,10 @@ bool MainWindow::Window::slotExit()
             slotSave();
         }
         if ( ret == KMessageBox::No ) {
-            QDir().remove( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1(".#index.xml") );
+            DB::ImageDB::instance()->discardAutoSave();
         }
     }
+    DB::ImageDB::instance()->waitForSaves();
     // Flush any remaining thumbnails
     ImageManager::ThumbnailCache::instance()->save();
 
@@ -485,13 +491,11 @@ void MainWindow::Window::createAnnotationDialog()
 
 void MainWindow::Window::slotSave()
 {
-    Utilities::ShowBusyCursor dummy;
-    m_statusBar->showMessage(i18n("Saving..."), 5000 );
-    DB::ImageDB::instance()->save( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1("index.xml"), false );
+    m_statusBar->showMessage(i18n("Saving...") );
+    DB::ImageDB::instance()->saveInBackground( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1("index.xml"), false );
     ImageManager::ThumbnailCache::instance()->save();
+    // The database is saved as it is now. Changes made while the file is being written mark it dirty again.
     m_statusBar->mp_dirtyIndicator->saved();
-    QDir().remove( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1(".#index.xml") );
-    m_statusBar->showMessage(i18n("Saving... Done"), 5000 );
 }
 
 void MainWindow::Window::slotDeleteSelected()
@@ -992,15 +996,38 @@ void MainWindow::Window::startAutoSaveTimer()
 void MainWindow::Window::slotAutoSave()
 {
     if ( m_statusBar->mp_dirtyIndicator->isAutoSaveDirty() ) {
-        Utilities::ShowBusyCursor dummy;
+        // While index.xml is being saved, the auto save waits for the next round.
+        if ( !DB::ImageDB::instance()->autoSave() )
+            return;
         m_statusBar->showMessage(i18n("Auto saving...."));
-        DB::ImageDB::instance()->save( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1(".#index.xml"), true );
         ImageManager::ThumbnailCache::instance()->save();
-        m_statusBar->showMessage(i18n("Auto saving.... Done"), 5000);
         m_statusBar->mp_dirtyIndicator->autoSaved();
     }
 }
 
+void MainWindow::Window::slotSaveProgress( int percent )
+{
+    m_statusBar->showMessage( i18n("Saving... %1%", percent) );
+}
+
+void MainWindow::Window::slotSaveFinished( bool isAutoSave, bool success )
+{
+    if ( !success ) {
+        // The changes are still not on disk.
+        DirtyIndicator::markDirty();
+        m_statusBar->showMessage( i18n("Saving failed"), 5000 );
+        return;
+    }
+
+    if ( isAutoSave ) {
+        m_statusBar->showMessage(i18n("Auto saving.... Done"), 5000);
+    } else {
+        // Saves are written in order, so any earlier auto save is on disk by now and can go.
+        QDir().remove( Settings::SettingsData::instance()->imageDirectory() + QString::fromLatin1(".#index.xml") );
+        m_statusBar->showMessage(i18n("Saving... Done"), 5000 );
+    }
+}
+
 
 void MainWindow::Window::showThumbNails()
 {
@@ -119,6 +119,8 @@ protected slots:
     void slotLimitToSelected();
     void slotExportToHTML();
     void slotAutoSave();
+    void slotSaveProgress( int percent );
+    void slotSaveFinished( bool isAutoSave, bool success );
     void showBrowser();
     void slotOptionGroupChanged();
     void showTipOfDay();
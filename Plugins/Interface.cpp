@@ -115,7 +115,10 @@ QAbstractItemModel * Plugins::Interface::getTagTree() const
     if ( !rootCategory )
         rootCategory = DB::ImageDB::instance()->categoryCollection()->categoryForSpecial( DB::Category::TokensCategory );
 
-    return new Browser::TreeCategoryModel( rootCategory , matchAll );
+    Browser::TreeCategoryModel* model = new Browser::TreeCategoryModel( rootCategory , matchAll );
+    // plugins expect the complete tree right away:
+    model->finishCounting();
+    return model;
 }
 
 bool Plugins::Interface::addImage( const QUrl &url, QString& errmsg )
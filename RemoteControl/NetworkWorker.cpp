@@ -0,0 +1,192 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "NetworkWorker.h"
+
+#include <QDataStream>
+#include <QTcpSocket>
+
+using namespace RemoteControl;
+
+namespace
+{
+// Only hand new frames to the socket while less than this is waiting to go out;
+// everything else waits in our own queue, where it can be reordered and dropped.
+constexpr qint64 MAX_PENDING_SOCKET_BYTES = 256 * 1024;
+}
+
+NetworkWorker::NetworkWorker(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void NetworkWorker::connectToHost(const QHostAddress& address, quint16 port)
+{
+    createSocket();
+    connect(m_socket, &QTcpSocket::connected, this, &NetworkWorker::connected);
+    connect(m_socket, &QTcpSocket::connected, this, &NetworkWorker::writeFrames);
+    m_socket->connectToHost(address, port);
+}
+
+void NetworkWorker::takeOverSocket(qintptr socketDescriptor)
+{
+    createSocket();
+    if (!m_socket->setSocketDescriptor(socketDescriptor)) {
+        closeSocket();
+        emit disconnected();
+        return;
+    }
+    emit connected();
+    readData();
+}
+
+void NetworkWorker::createSocket()
+{
+    disconnectFromHost();
+    m_socket = new QTcpSocket(this);
+    connect(m_socket, &QTcpSocket::disconnected, this, &NetworkWorker::lostConnection);
+    connect(m_socket, &QTcpSocket::readyRead, this, &NetworkWorker::readData);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &NetworkWorker::writeFrames);
+}
+
+void NetworkWorker::disconnectFromHost()
+{
+    if (!m_socket)
+        return;
+
+    const bool wasConnected = m_socket->state() == QAbstractSocket::ConnectedState;
+    closeSocket();
+    if (wasConnected)
+        emit disconnected();
+}
+
+void NetworkWorker::lostConnection()
+{
+    closeSocket();
+    emit disconnected();
+}
+
+void NetworkWorker::closeSocket()
+{
+    m_socket->disconnect(this);
+    m_socket->abort();
+    m_socket->deleteLater();
+    m_socket = nullptr;
+    for (QList<Entry>& queue : m_queues)
+        queue.clear();
+    m_state = WaitingForLength;
+}
+
+void NetworkWorker::enqueue(quint64 sequence, int priority, int imageId, int viewType, const QByteArray& frame)
+{
+    if (!m_socket)
+        return;
+
+    Q_ASSERT(priority >= 0 && priority <= static_cast<int>(SendPriority::Prefetch));
+    m_queues[priority].append(Entry{sequence, imageId, viewType, frame});
+    writeFrames();
+}
+
+void NetworkWorker::frameEncoded(quint64 sequence, const QByteArray& frame)
+{
+    for (QList<Entry>& queue : m_queues) {
+        for (Entry& entry : queue) {
+            if (entry.sequence == sequence) {
+                entry.frame = frame;
+                writeFrames();
+                return;
+            }
+        }
+    }
+    // Not found: the request was canceled while its answer was encoded.
+}
+
+void NetworkWorker::cancel(int imageId, int viewType)
+{
+    for (QList<Entry>& queue : m_queues) {
+        for (auto it = queue.begin(); it != queue.end(); ) {
+            if (it->imageId == imageId && it->viewType == viewType)
+                it = queue.erase(it);
+            else
+                ++it;
+        }
+    }
+}
+
+bool NetworkWorker::takeNextFrame(QByteArray* frame)
+{
+    // Control commands must arrive in order, so only the first of them is eligible
+    QList<Entry>& control = m_queues[static_cast<int>(SendPriority::Control)];
+    if (!control.isEmpty()) {
+        if (control.first().frame.isNull())
+            return false;
+        *frame = control.takeFirst().frame;
+        return true;
+    }
+
+    for (int priority = static_cast<int>(SendPriority::Visible); priority <= static_cast<int>(SendPriority::Prefetch); ++priority) {
+        QList<Entry>& queue = m_queues[priority];
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (!it->frame.isNull()) {
+                *frame = it->frame;
+                queue.erase(it);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void NetworkWorker::writeFrames()
+{
+    if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState)
+        return;
+
+    QByteArray frame;
+    while (m_socket->bytesToWrite() < MAX_PENDING_SOCKET_BYTES && takeNextFrame(&frame))
+        m_socket->write(frame);
+}
+
+void NetworkWorker::readData()
+{
+    if (!m_socket)
+        return;
+
+    QDataStream stream(m_socket);
+
+    while (m_socket->bytesAvailable()) {
+        if (m_state == WaitingForLength) {
+            if (m_socket->bytesAvailable() < (qint64) sizeof(qint32))
+                return;
+
+            stream >> m_length;
+            m_length -= sizeof(qint32);
+            m_state = WaitingForData;
+        }
+
+        if (m_state == WaitingForData) {
+            if (m_socket->bytesAvailable() < m_length)
+                return;
+
+            m_state = WaitingForLength;
+            const QByteArray data = m_socket->read(m_length);
+            Q_ASSERT(data.length() == m_length);
+            emit frameReceived(data);
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef REMOTECONTROL_NETWORKWORKER_H
+#define REMOTECONTROL_NETWORKWORKER_H
+
+#include <QByteArray>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+
+#include "Types.h"
+
+class QTcpSocket;
+
+namespace RemoteControl
+{
+
+/**
+ * \brief Owns the TCP socket of a RemoteConnection, and lives in its network thread.
+ *
+ * Outgoing commands are handed over as encoded frames, each with a priority. Frames are only
+ * written to the socket while the socket has less than a few hundred KB pending, so a slow
+ * network holds them back in the queue, where high priority frames can overtake low priority ones,
+ * and where they can still be dropped when the remote cancels the request they answer.
+ *
+ * Frames of SendPriority::Control are sent in the order they were queued. Frames of the other priorities
+ * may be queued before they have been encoded; they are sent in the order their encoding finishes.
+ *
+ * Incoming data is split into frames, which are handed to the GUI thread via frameReceived().
+ */
+class NetworkWorker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NetworkWorker(QObject* parent = nullptr);
+
+public slots:
+    void connectToHost(const QHostAddress& address, quint16 port);
+    /** Take over a socket that a QTcpServer in another thread accepted. */
+    void takeOverSocket(qintptr socketDescriptor);
+    void disconnectFromHost();
+
+    /**
+     * Queue a frame for sending. If \p frame is null, the frame is still being encoded,
+     * and will be passed to frameEncoded() with the same \p sequence number later.
+     * \p priority is a SendPriority. Frames with a \p viewType >= 0 can be dropped using cancel().
+     */
+    void enqueue(quint64 sequence, int priority, int imageId, int viewType, const QByteArray& frame);
+    void frameEncoded(quint64 sequence, const QByteArray& frame);
+    void cancel(int imageId, int viewType);
+
+signals:
+    void connected();
+    void disconnected();
+    void frameReceived(const QByteArray& frame);
+
+private slots:
+    void readData();
+    void writeFrames();
+    void lostConnection();
+
+private:
+    struct Entry {
+        quint64 sequence;
+        int imageId;
+        int viewType;
+        QByteArray frame;
+    };
+    void createSocket();
+    void closeSocket();
+    bool takeNextFrame(QByteArray* frame);
+
+    QTcpSocket* m_socket = nullptr;
+    QList<Entry> m_queues[3]; // one per SendPriority
+
+    enum ReadingState {WaitingForLength, WaitingForData};
+    ReadingState m_state = WaitingForLength;
+    qint32 m_length = 0;
+};
+
+}
+
+#endif // REMOTECONTROL_NETWORKWORKER_H
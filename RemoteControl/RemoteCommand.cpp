@@ -99,6 +99,8 @@ std::unique_ptr<RemoteCommand> RemoteCommand::create(CommandType id)
         ADDFACTORY(StaticImageRequest);
         ADDFACTORY(StaticImageResult);
         ADDFACTORY(ToggleTokenRequest);
+        ADDFACTORY(ThumbnailBatchResult);
+        ADDFACTORY(SearchResultPage);
     }
     Q_ASSERT(factories.contains(id));
     return factories[id]();
@@ -113,6 +115,24 @@ ThumbnailResult::ThumbnailResult(ImageId _imageId, const QString& _label, const
     addSerializer(new Serializer<ViewType>(type));
 }
 
+QDataStream& operator<<(QDataStream& stream, const CachedThumbnail& thumbnail)
+{
+    stream << thumbnail.imageId << thumbnail.data;
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, CachedThumbnail& thumbnail)
+{
+    stream >> thumbnail.imageId >> thumbnail.data;
+    return stream;
+}
+
+ThumbnailBatchResult::ThumbnailBatchResult(const QList<CachedThumbnail>& _thumbnails)
+    :RemoteCommand(CommandType::ThumbnailBatchResult), thumbnails(_thumbnails)
+{
+    addSerializer(new Serializer<QList<CachedThumbnail>>(thumbnails));
+}
+
 QDataStream& operator<<(QDataStream& stream, const Category& category)
 {
     stream << category.name << category.enabled << (int) category.viewType;
@@ -150,6 +170,14 @@ SearchResult::SearchResult(SearchType _type, const QList<int>& _result)
     addSerializer(new Serializer<QList<int>>(result));
 }
 
+SearchResultPage::SearchResultPage(const QList<int>& _result, bool _isFirstPage, bool _isLastPage)
+    :RemoteCommand(CommandType::SearchResultPage), result(_result), isFirstPage(_isFirstPage), isLastPage(_isLastPage)
+{
+    addSerializer(new Serializer<QList<int>>(result));
+    addSerializer(new Serializer<bool>(isFirstPage));
+    addSerializer(new Serializer<bool>(isLastPage));
+}
+
 ThumbnailRequest::ThumbnailRequest(ImageId _imageId, const QSize& _size, ViewType _type)
     :RemoteCommand(CommandType::ThumbnailRequest), imageId(_imageId), size(_size), type(_type)
 {
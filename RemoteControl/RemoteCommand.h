@@ -36,7 +36,7 @@ namespace RemoteControl
 {
 class SerializerInterface;
 
-const int VERSION = 7;
+const int VERSION = 8;
 
 enum class CommandType {
     ThumbnailResult,
@@ -51,7 +51,9 @@ enum class CommandType {
     CategoryItemsResult,
     StaticImageRequest,
     StaticImageResult,
-    ToggleTokenRequest
+    ToggleTokenRequest,
+    ThumbnailBatchResult,
+    SearchResultPage
 };
 
 
@@ -82,6 +84,22 @@ public:
     ViewType type;
 };
 
+struct CachedThumbnail {
+    ImageId imageId;
+    QByteArray data; // JPEG data, at the thumbnail size of the desktop, i.e. possibly larger than requested
+};
+
+/**
+ * Thumbnails taken directly from the thumbnail cache, without decoding and encoding them again.
+ * Many thumbnails are sent in one command, so scrolling on the remote is limited by the network only.
+ */
+class ThumbnailBatchResult :public RemoteCommand
+{
+public:
+    ThumbnailBatchResult(const QList<CachedThumbnail>& thumbnails = {});
+    QList<CachedThumbnail> thumbnails;
+};
+
 struct Category {
     QString name;
     QImage icon;
@@ -113,6 +131,19 @@ public:
     QList<int> result;
 };
 
+/**
+ * The result of an image search, sent in pages. The first page replaces any previous result,
+ * the following ones extend it, until the page with \c isLastPage set.
+ */
+class SearchResultPage :public RemoteCommand
+{
+public:
+    SearchResultPage(const QList<int>& result = {}, bool isFirstPage = {}, bool isLastPage = {});
+    QList<int> result;
+    bool isFirstPage;
+    bool isLastPage;
+};
+
 class ThumbnailRequest :public RemoteCommand
 {
 public:
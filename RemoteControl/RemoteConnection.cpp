@@ -17,12 +17,13 @@
 */
 
 #include "RemoteConnection.h"
+#include "NetworkWorker.h"
 #include "RemoteCommand.h"
 
 #include <QBuffer>
-#include <QTcpSocket>
 #include <QApplication>
-#include <QThread>
+#include <QMetaObject>
+#include <QRunnable>
 #include <QTime>
 
 #if 0
@@ -33,20 +34,10 @@
 
 using namespace RemoteControl;
 
-RemoteConnection::RemoteConnection(QObject *parent) :
-    QObject(parent)
+namespace
 {
-}
-
-void RemoteConnection::sendCommand(const RemoteCommand& command)
+QByteArray encodeFrame(const RemoteCommand& command)
 {
-    protocolDebug() << qPrintable(QTime::currentTime().toString(QString::fromUtf8("hh:mm:ss.zzz")))
-                    << ": Sending " << QString::number((int) command.commandType());
-    Q_ASSERT(QThread::currentThread() == qApp->thread());
-
-    if (!isConnected())
-        return;
-
     // Stream into a buffer so we can send length of buffer over
     // this is to ensure the remote side gets all data before it
     // starts to demarshal the data.
@@ -65,55 +56,132 @@ void RemoteConnection::sendCommand(const RemoteCommand& command)
     stream.device()->seek(0);
     stream << (qint32) buffer.size();
 
-    // Send the data.
-    socket()->write(buffer.data());
-    socket()->flush();
+    return buffer.data();
 }
 
-void RemoteConnection::dataReceived()
+class EncodeTask : public QRunnable
 {
-    QTcpSocket* socket = this->socket();
-    if (!socket)
-        return;
+public:
+    EncodeTask(QObject* worker, quint64 sequence, std::unique_ptr<RemoteCommand> command)
+        : m_worker(worker), m_sequence(sequence), m_command(std::move(command)) {}
+
+    void run() override
+    {
+        const QByteArray frame = encodeFrame(*m_command);
+        m_command.reset();
+        QMetaObject::invokeMethod(m_worker, "frameEncoded", Qt::QueuedConnection,
+                                  Q_ARG(quint64, m_sequence), Q_ARG(QByteArray, frame));
+    }
 
-    QDataStream stream(socket);
+private:
+    QObject* m_worker;
+    quint64 m_sequence;
+    std::unique_ptr<RemoteCommand> m_command;
+};
+}
+
+RemoteConnection::RemoteConnection(QObject *parent) :
+    QObject(parent), m_worker(new NetworkWorker)
+{
+    qRegisterMetaType<QHostAddress>();
+    qRegisterMetaType<qintptr>("qintptr");
+
+    m_worker->moveToThread(&m_networkThread);
+    connect(&m_networkThread, &QThread::finished, m_worker, &QObject::deleteLater);
+    connect(m_worker, &NetworkWorker::frameReceived, this, &RemoteConnection::frameReceived);
+    connect(m_worker, &NetworkWorker::connected, this, &RemoteConnection::connectionEstablished);
+    connect(m_worker, &NetworkWorker::disconnected, this, &RemoteConnection::connectionLost);
+    m_networkThread.setObjectName(QString::fromLatin1("RemoteControl network"));
+    m_networkThread.start();
+}
+
+RemoteConnection::~RemoteConnection()
+{
+    m_encodePool.clear();
+    m_encodePool.waitForDone();
+    m_networkThread.quit();
+    m_networkThread.wait();
+}
+
+void RemoteConnection::sendCommand(const RemoteCommand& command, SendPriority priority)
+{
+    protocolDebug() << qPrintable(QTime::currentTime().toString(QString::fromUtf8("hh:mm:ss.zzz")))
+                    << ": Sending " << QString::number((int) command.commandType());
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-    while (socket->bytesAvailable()) {
-        if (m_state == WaitingForLength) {
-            if (socket->bytesAvailable() < (qint64) sizeof(qint32))
-                return;
+    if (!isConnected())
+        return;
 
-            stream >> m_length;
-            m_length -= sizeof(qint32);
-            m_state = WaitingForData;
-        }
+    enqueue(command, priority, encodeFrame(command));
+}
 
-        if (m_state == WaitingForData) {
-            if (socket->bytesAvailable() < m_length)
-                return;
+void RemoteConnection::sendCommand(std::unique_ptr<RemoteCommand> command, SendPriority priority)
+{
+    protocolDebug() << qPrintable(QTime::currentTime().toString(QString::fromUtf8("hh:mm:ss.zzz")))
+                    << ": Sending " << QString::number((int) command->commandType()) << "(encoding in background)";
+    Q_ASSERT(QThread::currentThread() == qApp->thread());
 
-            m_state = WaitingForLength;
-            QByteArray data = socket->read(m_length);
-            Q_ASSERT(data.length() == m_length);
+    if (!isConnected())
+        return;
 
-            QBuffer buffer(&data);
-            buffer.open(QIODevice::ReadOnly);
-            QDataStream stream(&buffer);
-            qint32 id;
-            stream >> id;
+    const quint64 sequence = enqueue(*command, priority, QByteArray());
+    m_encodePool.start(new EncodeTask(m_worker, sequence, std::move(command)));
+}
 
-            std::unique_ptr<RemoteCommand> command = RemoteCommand::create(static_cast<CommandType>(id));
-            command->decode(stream);
-            protocolDebug() << qPrintable(QTime::currentTime().toString(QString::fromUtf8("hh:mm:ss.zzz")))
-                               << ": Received " << id;
+void RemoteConnection::cancelThumbnail(ImageId imageId, ViewType type)
+{
+    QMetaObject::invokeMethod(m_worker, "cancel", Qt::QueuedConnection,
+                              Q_ARG(int, imageId), Q_ARG(int, static_cast<int>(type)));
+}
 
-            emit gotCommand(*command);
-        }
+quint64 RemoteConnection::enqueue(const RemoteCommand& command, SendPriority priority, const QByteArray& frame)
+{
+    // Only answers to thumbnail requests can be canceled by the remote
+    int imageId = 0;
+    int viewType = -1;
+    if (command.commandType() == CommandType::ThumbnailResult) {
+        const ThumbnailResult& result = static_cast<const ThumbnailResult&>(command);
+        imageId = result.imageId;
+        viewType = static_cast<int>(result.type);
     }
+
+    const quint64 sequence = ++m_sequence;
+    QMetaObject::invokeMethod(m_worker, "enqueue", Qt::QueuedConnection,
+                              Q_ARG(quint64, sequence), Q_ARG(int, static_cast<int>(priority)),
+                              Q_ARG(int, imageId), Q_ARG(int, viewType), Q_ARG(QByteArray, frame));
+    return sequence;
 }
 
+void RemoteConnection::connectToHost(const QHostAddress& address, quint16 port)
+{
+    QMetaObject::invokeMethod(m_worker, "connectToHost", Qt::QueuedConnection,
+                              Q_ARG(QHostAddress, address), Q_ARG(quint16, port));
+}
 
+void RemoteConnection::takeOverSocket(qintptr socketDescriptor)
+{
+    QMetaObject::invokeMethod(m_worker, "takeOverSocket", Qt::QueuedConnection,
+                              Q_ARG(qintptr, socketDescriptor));
+}
 
+void RemoteConnection::disconnectFromHost()
+{
+    QMetaObject::invokeMethod(m_worker, "disconnectFromHost", Qt::QueuedConnection);
+}
 
+void RemoteConnection::frameReceived(const QByteArray& frame)
+{
+    QByteArray data(frame);
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    qint32 id;
+    stream >> id;
 
+    std::unique_ptr<RemoteCommand> command = RemoteCommand::create(static_cast<CommandType>(id));
+    command->decode(stream);
+    protocolDebug() << qPrintable(QTime::currentTime().toString(QString::fromUtf8("hh:mm:ss.zzz")))
+                       << ": Received " << id;
 
+    emit gotCommand(*command);
+}
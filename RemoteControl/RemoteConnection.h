@@ -15,20 +15,28 @@
    the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
    Boston, MA 02110-1301, USA.
 */
-
 #ifndef REMOTECONNECTION_H
 #define REMOTECONNECTION_H
 
+#include "Types.h"
 #include <QObject>
 #include <QHostAddress>
-
-class QUdpSocket;
-class QTcpSocket;
+#include <QThread>
+#include <QThreadPool>
+#include <memory>
 
 namespace RemoteControl
 {
 class RemoteCommand;
+class NetworkWorker;
 
+/**
+ * The socket of the connection is owned by a NetworkWorker running in a thread of its own,
+ * so neither a slow network nor large commands block the GUI thread.
+ *
+ * Commands with images are best handed over using the std::unique_ptr overload of sendCommand,
+ * which encodes them on a thread pool.
+ */
 class RemoteConnection : public QObject
 {
     Q_OBJECT
@@ -36,22 +44,41 @@ public:
     const int UDPPORT = 23455;
     const int TCPPORT = 23456;
     explicit RemoteConnection(QObject *parent = 0);
+    ~RemoteConnection() override;
     virtual bool isConnected() const = 0;
-    void sendCommand( const RemoteCommand& );
+
+    /** Encode the command right away, and queue it for sending. */
+    void sendCommand( const RemoteCommand&, SendPriority priority = SendPriority::Control );
+    /** Queue the command for sending, and encode it on a worker thread. */
+    void sendCommand( std::unique_ptr<RemoteCommand> command, SendPriority priority = SendPriority::Control );
+    /** Drop all ThumbnailResults for the image that are still waiting to be sent. */
+    void cancelThumbnail( ImageId imageId, ViewType type );
 
 signals:
     void gotCommand(const RemoteCommand&);
 
+protected:
+    void connectToHost(const QHostAddress& address, quint16 port);
+    /** Hand a socket accepted by a QTcpServer over to the network thread. */
+    void takeOverSocket(qintptr socketDescriptor);
+    void disconnectFromHost();
+
 protected slots:
-    void dataReceived();
+    /** Called once the network thread has a connected socket. */
+    virtual void connectionEstablished() = 0;
+    /** Called when the connection is closed, by either side. */
+    virtual void connectionLost() = 0;
 
-protected:
-    virtual QTcpSocket* socket() = 0;
+private slots:
+    void frameReceived(const QByteArray& frame);
 
 private:
-    enum ReadingState {WaitingForLength, WaitingForData};
-    ReadingState m_state = WaitingForLength;
-    qint32 m_length;
+    quint64 enqueue(const RemoteCommand& command, SendPriority priority, const QByteArray& frame);
+
+    QThread m_networkThread;
+    NetworkWorker* m_worker;
+    QThreadPool m_encodePool;
+    quint64 m_sequence = 0;
 };
 
 }
@@ -39,7 +39,9 @@
 #include "DB/ImageInfoPtr.h"
 #include "DB/ImageSearchInfo.h"
 #include "ImageManager/AsyncLoader.h"
+#include "ImageManager/ThumbnailCache.h"
 #include "MainWindow/DirtyIndicator.h"
+#include "Settings/SettingsData.h"
 #include "Utilities/DescriptionUtil.h"
 
 #include "RemoteCommand.h"
@@ -49,6 +51,14 @@
 
 using namespace RemoteControl;
 
+namespace
+{
+// Upper bound for the size of a single ThumbnailBatchResult. Thumbnails are around 10-20 KB each.
+constexpr int MAX_THUMBNAIL_BATCH_BYTES = 1024 * 1024;
+// Number of images searched for each SearchResultPage. Each of them is checked to be on disk before the page is sent.
+constexpr int SEARCH_RESULT_PAGE_SIZE = 500;
+}
+
 RemoteInterface& RemoteInterface::instance()
 {
     static RemoteInterface instance;
@@ -56,8 +66,18 @@ RemoteInterface& RemoteInterface::instance()
 }
 
 RemoteInterface::RemoteInterface(QObject *parent) :
-    QObject(parent), m_connection(new Server(this))
+    QObject(parent), m_connection(new Server(this)), m_cachedThumbnailTimer(new QTimer(this))
+    , m_searchResultTimer(new QTimer(this))
 {
+    // Collect all thumbnail requests that arrive in one go into a single command:
+    m_cachedThumbnailTimer->setSingleShot(true);
+    m_cachedThumbnailTimer->setInterval(0);
+    connect(m_cachedThumbnailTimer, &QTimer::timeout, this, &RemoteInterface::sendCachedThumbnails);
+
+    // Pages of search results are sent one per event loop iteration:
+    m_searchResultTimer->setSingleShot(true);
+    m_searchResultTimer->setInterval(0);
+    connect(m_searchResultTimer, &QTimer::timeout, this, &RemoteInterface::sendSearchResultPage);
     connect(m_connection, SIGNAL(gotCommand(RemoteCommand)), this, SLOT(handleCommand(RemoteCommand)));
     connect(m_connection, SIGNAL(connected()), this, SIGNAL(connected()));
     connect(m_connection, SIGNAL(disConnected()), this, SIGNAL(disConnected()));
@@ -76,10 +96,21 @@ DB::ImageSearchInfo RemoteInterface::convert(const SearchInfo& searchInfo) const
     return dbSearchInfo;
 }
 
+SendPriority RemoteInterface::priorityFor(ViewType type)
+{
+    // Full size images are requested by the image viewer, both for the image shown and for
+    // the ones the remote prefetches. They are big, so let the thumbnails go first.
+    // The remote does not tell which of them it is showing, so none of them may be dropped;
+    // the remote cancels those it no longer needs.
+    return type == ViewType::Images ? SendPriority::Prefetch : SendPriority::Visible;
+}
+
 void RemoteInterface::pixmapLoaded(ImageManager::ImageRequest* request, const QImage& image)
 {
-    m_connection->sendCommand(ThumbnailResult(m_imageNameStore[request->databaseFileName()], QString(),
-                              image, static_cast<RemoteImageRequest*>(request)->type()));
+    const ViewType type = static_cast<RemoteImageRequest*>(request)->type();
+    m_connection->sendCommand(std::unique_ptr<RemoteCommand>(
+                                  new ThumbnailResult(m_imageNameStore[request->databaseFileName()], QString(), image, type)),
+                              priorityFor(type));
 }
 
 bool RemoteInterface::requestStillNeeded(const DB::FileName& fileName)
@@ -131,22 +162,30 @@ void RemoteInterface::sendCategoryNames(const SearchRequest& search)
 {
     const DB::ImageSearchInfo dbSearchInfo = convert(search.searchInfo);
 
-    CategoryListResult command;
+    QList<DB::CategoryPtr> categories;
+    QStringList categoryNames;
     for (const DB::CategoryPtr& category : DB::ImageDB::instance()->categoryCollection()->categories()) {
         if (category->type() == DB::Category::MediaTypeCategory)
             continue;
-        QMap<QString, uint> images = DB::ImageDB::instance()->classify( dbSearchInfo, category->name(), DB::Image );
+        categories.append(category);
+        categoryNames.append(category->name());
+    }
+    const QMap<QString, DB::CategoryClassification> classification
+            = DB::ImageDB::instance()->classifyCategories(dbSearchInfo, categoryNames);
 
-        QMap<QString, uint> videos = DB::ImageDB::instance()->classify( dbSearchInfo, category->name(), DB::Video );
+    std::unique_ptr<CategoryListResult> command(new CategoryListResult);
+    for (const DB::CategoryPtr& category : categories) {
+        const QMap<QString, uint> images = classification[category->name()].images;
+        const QMap<QString, uint> videos = classification[category->name()].videos;
         const bool enabled = (images.count() /*+ videos.count()*/ > 1);
         CategoryViewType type =
                 (category->viewType() == DB::Category::IconView || category->viewType() == DB::Category::ThumbedIconView)
                 ? Types::CategoryIconView : Types::CategoryListView;
 
         const QImage icon = category->icon(search.size, enabled ? KIconLoader::DefaultState : KIconLoader::DisabledState).toImage();
-        command.categories.append({category->name(), icon, enabled, type});
+        command->categories.append({category->name(), icon, enabled, type});
     }
-    m_connection->sendCommand(command);
+    m_connection->sendCommand(std::move(command));
 }
 
 void RemoteInterface::sendCategoryValues(const SearchRequest& search)
@@ -157,6 +196,7 @@ void RemoteInterface::sendCategoryValues(const SearchRequest& search)
     const DB::CategoryPtr category = DB::ImageDB::instance()->categoryCollection()->categoryForName(search.searchInfo.currentCategory());
 
     Browser::FlatCategoryModel model(category, dbSearchInfo);
+    model.finishCounting();
 
     if (category->viewType() == DB::Category::IconView || category->viewType() == DB::Category::ThumbedIconView) {
         QList<int> result;
@@ -173,24 +213,38 @@ void RemoteInterface::sendCategoryValues(const SearchRequest& search)
 
 void RemoteInterface::sendImageSearchResult(const SearchInfo& search)
 {
-    const DB::FileNameList files = DB::ImageDB::instance()->search(convert(search), true /* Require on disk */);
-    DB::FileNameList stacksRemoved;
-    QList<int> result;
-
-    std::remove_copy_if(files.begin(), files.end(), std::back_inserter(stacksRemoved),
-                        [] (const DB::FileName& file) {
-        // Only include unstacked images, and the top of stacked images.
-        // And also exclude videos
-        return DB::ImageDB::instance()->info(file)->stackOrder() > 1 ||
-                DB::ImageDB::instance()->info(file)->isVideo();
-    });
-
-    std::transform(stacksRemoved.begin(), stacksRemoved.end(), std::back_inserter(result),
-                   [this](const DB::FileName& fileName) {
-        return m_imageNameStore[fileName];
-    });
-
-    m_connection->sendCommand(SearchResult(SearchType::Images, result));
+    // Only unstacked images, and the top of stacked images. And also exclude videos.
+    // The search itself, and the check whether the files are on disk, are only done for each page as it is sent.
+    m_searchInfo = convert(search);
+    m_searchPosition = 0;
+    sendSearchResultPage();
+}
+
+void RemoteInterface::sendSearchResultPage()
+{
+    m_searchResultTimer->stop();
+    if (m_searchPosition < 0)
+        return;
+    if (!m_connection->isConnected()) {
+        m_searchPosition = -1;
+        return;
+    }
+
+    const bool isFirstPage = (m_searchPosition == 0);
+    const DB::FileNameList files = DB::ImageDB::instance()->searchStackTops(m_searchInfo, DB::Image,
+                                                                             &m_searchPosition, SEARCH_RESULT_PAGE_SIZE);
+    QList<int> page;
+    page.reserve(files.size());
+    for (const DB::FileName& fileName : files) {
+        if (DB::ImageInfo::imageOnDisk(fileName))
+            page.append(m_imageNameStore[fileName]);
+    }
+
+    const bool isLastPage = (m_searchPosition < 0);
+    m_connection->sendCommand(SearchResultPage(page, isFirstPage, isLastPage));
+
+    if (!isLastPage)
+        m_searchResultTimer->start();
 }
 
 void RemoteInterface::requestThumbnail(const ThumbnailRequest& command)
@@ -202,7 +256,9 @@ void RemoteInterface::requestThumbnail(const ThumbnailRequest& command)
 
         const DB::CategoryPtr category = DB::ImageDB::instance()->categoryCollection()->categoryForName(categoryName);
         QImage image = category->categoryImage( categoryName, itemName, command.size.width(), command.size.height()).toImage();
-        m_connection->sendCommand(ThumbnailResult(command.imageId, itemName, image,ViewType::CategoryItems));
+        m_connection->sendCommand(std::unique_ptr<RemoteCommand>(
+                                      new ThumbnailResult(command.imageId, itemName, image, ViewType::CategoryItems)),
+                                  SendPriority::Visible);
     }
     else {
         const DB::FileName fileName = m_imageNameStore[command.imageId];
@@ -211,6 +267,9 @@ void RemoteInterface::requestThumbnail(const ThumbnailRequest& command)
 
         m_activeReuqest.insert(fileName);
 
+        if (command.type == ViewType::Thumbnails && queueCachedThumbnail(command, fileName))
+            return;
+
         QSize size = command.size;
         if (!size.isValid()) {
             // Request for full screen image.
@@ -223,20 +282,64 @@ void RemoteInterface::requestThumbnail(const ThumbnailRequest& command)
     }
 }
 
+bool RemoteInterface::queueCachedThumbnail(const ThumbnailRequest& command, const DB::FileName& fileName)
+{
+    // The thumbnail cache holds JPEG data at the thumbnail size of the desktop. Whenever that is large
+    // enough for the remote, it gets those bytes as they are, and scales them down itself if needed.
+    const int cachedSize = Settings::SettingsData::instance()->thumbnailSize();
+    if (!command.size.isValid() || command.size.width() > cachedSize || command.size.height() > cachedSize)
+        return false;
+
+    ImageManager::ThumbnailCache* cache = ImageManager::ThumbnailCache::instance();
+    if (!cache->contains(fileName))
+        return false;
+
+    const QByteArray data = cache->lookupRawData(fileName);
+    if (data.isEmpty())
+        return false;
+
+    m_cachedThumbnails.append(CachedThumbnail{command.imageId, data});
+    m_cachedThumbnailBytes += data.size();
+    if (m_cachedThumbnailBytes >= MAX_THUMBNAIL_BATCH_BYTES)
+        sendCachedThumbnails();
+    else if (!m_cachedThumbnailTimer->isActive())
+        m_cachedThumbnailTimer->start();
+    return true;
+}
+
+void RemoteInterface::sendCachedThumbnails()
+{
+    m_cachedThumbnailTimer->stop();
+
+    QList<CachedThumbnail> thumbnails;
+    thumbnails.reserve(m_cachedThumbnails.size());
+    for (const CachedThumbnail& thumbnail : m_cachedThumbnails) {
+        // Skip what the remote canceled while the batch was collected
+        if (m_activeReuqest.contains(m_imageNameStore[thumbnail.imageId]))
+            thumbnails.append(thumbnail);
+    }
+    m_cachedThumbnails.clear();
+    m_cachedThumbnailBytes = 0;
+
+    if (!thumbnails.isEmpty())
+        m_connection->sendCommand(ThumbnailBatchResult(thumbnails), SendPriority::Visible);
+}
+
 void RemoteInterface::cancelRequest(const ThumbnailCancelRequest& command)
 {
     m_activeReuqest.remove(m_imageNameStore[command.imageId]);
+    m_connection->cancelThumbnail(command.imageId, command.type);
 }
 
 void RemoteInterface::sendImageDetails(const ImageDetailsRequest& command)
 {
     const DB::FileName fileName = m_imageNameStore[command.imageId];
     const DB::ImageInfoPtr info = DB::ImageDB::instance()->info(fileName);
-    ImageDetailsResult result;
-    result.fileName = fileName.relative();
-    result.date = info->date().toString();
-    result.description = info->description();
-    result.categories.clear();
+    std::unique_ptr<ImageDetailsResult> result(new ImageDetailsResult);
+    result->fileName = fileName.relative();
+    result->date = info->date().toString();
+    result->description = info->description();
+    result->categories.clear();
     for (const QString& categoryName : info->availableCategories()) {
         DB::CategoryPtr category = DB::ImageDB::instance()->categoryCollection()->categoryForName(categoryName);
         CategoryItemDetailsList list;
@@ -244,10 +347,10 @@ void RemoteInterface::sendImageDetails(const ImageDetailsRequest& command)
             const QString age = Utilities::formatAge(category, item, info);
             list.append(CategoryItemDetails(item, age));
         }
-        result.categories[categoryName] = list;
+        result->categories[categoryName] = list;
     }
 
-    m_connection->sendCommand(result);
+    m_connection->sendCommand(std::move(result));
 }
 
 void RemoteInterface::sendHomePageImages(const StaticImageRequest& command)
@@ -258,7 +361,8 @@ void RemoteInterface::sendHomePageImages(const StaticImageRequest& command)
     QPixmap kphotoalbumIcon = KIconLoader::global()->loadIcon( QString::fromUtf8("kphotoalbum"), KIconLoader::Desktop, size);
     QPixmap discoverIcon = KIconLoader::global()->loadIcon( QString::fromUtf8("edit-find"), KIconLoader::Desktop, size);
 
-    m_connection->sendCommand(StaticImageResult(homeIcon.toImage(), kphotoalbumIcon.toImage(), discoverIcon.toImage()));
+    m_connection->sendCommand(std::unique_ptr<RemoteCommand>(
+                                  new StaticImageResult(homeIcon.toImage(), kphotoalbumIcon.toImage(), discoverIcon.toImage())));
 }
 
 void RemoteInterface::setToken(const ToggleTokenRequest& command)
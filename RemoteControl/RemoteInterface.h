@@ -24,6 +24,7 @@
 #include "DB/ImageSearchInfo.h"
 #include <QObject>
 #include <QHostAddress>
+#include <QTimer>
 #include "ImageManager/ImageClientInterface.h"
 
 class QHostAddress;
@@ -45,6 +46,8 @@ public:
 
 private slots:
     void handleCommand(const RemoteCommand&);
+    void sendCachedThumbnails();
+    void sendSearchResultPage();
 
 signals:
     void connected();
@@ -59,14 +62,22 @@ private:
     void sendCategoryValues(const SearchRequest& search);
     void sendImageSearchResult(const SearchInfo& search);
     void requestThumbnail(const ThumbnailRequest& command);
+    bool queueCachedThumbnail(const ThumbnailRequest& command, const DB::FileName& fileName);
     void cancelRequest(const ThumbnailCancelRequest& command);
     void sendImageDetails(const ImageDetailsRequest& command);
     void sendHomePageImages(const StaticImageRequest& command);
     void setToken(const ToggleTokenRequest& command);
 
     DB::ImageSearchInfo convert(const RemoteControl::SearchInfo&) const;
+    static SendPriority priorityFor(ViewType type);
     Server* m_connection;
     QSet<DB::FileName> m_activeReuqest;
+    QList<CachedThumbnail> m_cachedThumbnails;
+    int m_cachedThumbnailBytes = 0;
+    QTimer* m_cachedThumbnailTimer;
+    DB::ImageSearchInfo m_searchInfo;
+    int m_searchPosition = -1; // where the next page of the image search starts, -1 if none is pending
+    QTimer* m_searchResultTimer;
     ImageNameStore m_imageNameStore;
 };
 
@@ -19,7 +19,6 @@
 #include "Server.h"
 
 #include <QUdpSocket>
-#include <QTcpSocket>
 #include <QMessageBox>
 #include "RemoteCommand.h"
 #include <KLocalizedString>
@@ -54,16 +53,10 @@ void Server::stopListening()
 {
     delete m_socket;
     m_socket = nullptr;
-    delete m_tcpSocket;
-    m_tcpSocket = nullptr;
+    disconnectFromHost();
     emit stoppedListening();
 }
 
-QTcpSocket*Server::socket()
-{
-    return m_tcpSocket;
-}
-
 void Server::readIncommingUDP()
 {
     Q_ASSERT(m_socket->hasPendingDatagrams());
@@ -92,20 +85,16 @@ void Server::readIncommingUDP()
 
 void Server::connectToTcpServer(const QHostAddress& address)
 {
-    m_tcpSocket = new QTcpSocket;
-    connect(m_tcpSocket, SIGNAL(connected()), this, SLOT(gotConnected()));
-    connect(m_tcpSocket, SIGNAL(readyRead()), this, SLOT(dataReceived()));
-    m_tcpSocket->connectToHost(address, TCPPORT);
-    connect(m_tcpSocket, SIGNAL(disconnected()), this, SLOT(lostConnection()));
+    connectToHost(address, TCPPORT);
 }
 
-void Server::gotConnected()
+void Server::connectionEstablished()
 {
     m_isConnected = true;
     emit connected();
 }
 
-void Server::lostConnection()
+void Server::connectionLost()
 {
     m_isConnected = false;
     emit disConnected();
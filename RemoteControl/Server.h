@@ -21,7 +21,6 @@
 
 #include "RemoteConnection.h"
 class QUdpSocket;
-class QTcpSocket;
 
 namespace RemoteControl
 {
@@ -33,7 +32,6 @@ public:
     bool isConnected() const override;
     void listen(QHostAddress address);
     void stopListening();
-    QTcpSocket* socket() override;
     void connectToTcpServer(const QHostAddress& address);
 
 signals:
@@ -41,14 +39,15 @@ signals:
     void disConnected();
     void stoppedListening();
 
+protected slots:
+    void connectionEstablished() override;
+    void connectionLost() override;
+
 private slots:
     void readIncommingUDP();
-    void gotConnected();
-    void lostConnection();
 
 private:
     QUdpSocket* m_socket = nullptr;
-    QTcpSocket* m_tcpSocket = nullptr;
     bool m_isConnected = false;
 };
 
@@ -42,6 +42,12 @@ using CategoryViewType = Types::CategoryViewType;
 
 enum class SearchType { Categories, CategoryItems, Images };
 
+/**
+ * Order in which queued commands are sent to the remote.
+ * Control commands are answers to anything but image requests, and are always sent first.
+ */
+enum class SendPriority { Control, Visible, Prefetch };
+
 using ImageId = int;
 
 const ImageId DISCOVERYID = -1000;
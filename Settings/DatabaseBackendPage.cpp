@@ -35,6 +35,10 @@ Settings::DatabaseBackendPage::DatabaseBackendPage( QWidget* parent )
     topLayout->addWidget(m_compressedIndexXML);
     connect(m_compressedIndexXML, &QCheckBox::clicked, this, &DatabaseBackendPage::markDirty);
 
+    m_indentIndexXML = new QCheckBox( i18n("Indent index.xml file"), this );
+    topLayout->addWidget(m_indentIndexXML);
+    connect(m_indentIndexXML, &QCheckBox::clicked, this, &DatabaseBackendPage::markDirty);
+
     m_compressBackup = new QCheckBox( i18n( "Compress backup file" ), this );
     topLayout->addWidget(m_compressBackup);
 
@@ -79,11 +83,16 @@ Settings::DatabaseBackendPage::DatabaseBackendPage( QWidget* parent )
                 "a long time to read this file. You may cut down this time to approximately half, by checking this check box. "
                 "The disadvantage is that the index.xml file is less readable by human eyes.</p>");
     m_compressedIndexXML->setWhatsThis( txt );
+
+    txt = i18n( "<p>Indenting the elements of the index.xml file makes it easier to read and to compare with a backup, "
+                "but makes the file larger and a bit slower to save.</p>" );
+    m_indentIndexXML->setWhatsThis( txt );
 }
 
 void Settings::DatabaseBackendPage::loadSettings( Settings::SettingsData* opt )
 {
     m_compressedIndexXML->setChecked( opt->useCompressedIndexXML() );
+    m_indentIndexXML->setChecked( opt->indentIndexXML() );
     m_autosave->setValue( opt->autoSave() );
     m_backupCount->setValue( opt->backupCount() );
     m_compressBackup->setChecked( opt->compressBackup() );
@@ -94,6 +103,7 @@ void Settings::DatabaseBackendPage::saveSettings( Settings::SettingsData* opt )
     opt->setBackupCount( m_backupCount->value() );
     opt->setCompressBackup( m_compressBackup->isChecked() );
     opt->setUseCompressedIndexXML( m_compressedIndexXML->isChecked() );
+    opt->setIndentIndexXML( m_indentIndexXML->isChecked() );
     opt->setAutoSave( m_autosave->value() );
 }
 
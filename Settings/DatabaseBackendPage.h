@@ -41,6 +41,7 @@ private:
     QSpinBox* m_backupCount;
     QCheckBox* m_compressBackup;
     QCheckBox* m_compressedIndexXML;
+    QCheckBox* m_indentIndexXML;
 };
 
 }
@@ -154,6 +154,7 @@ property_copy( skipRawIfOtherMatches , setSkipRawIfOtherMatches , bool
 property_copy( useRawThumbnail       , setUseRawThumbnail       , bool          , General, true                       )
 property_copy( useRawThumbnailSize   , setUseRawThumbnailSize   , QSize         , General, QSize(1024,768)            )
 property_copy( useCompressedIndexXML , setUseCompressedIndexXML , bool          , General, true                       )
+property_copy( indentIndexXML        , setIndentIndexXML        , bool          , General, true                       )
 property_copy( compressBackup        , setCompressBackup        , bool          , General, true                       )
 property_copy( showSplashScreen      , setShowSplashScreen      , bool          , General, true                       )
 property_copy( showHistogram         , setShowHistogram         , bool          , General, true                       )
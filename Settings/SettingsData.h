@@ -75,6 +75,7 @@ public:
     property_copy( useRawThumbnail       , setUseRawThumbnail       , bool );
     property_copy( useRawThumbnailSize   , setUseRawThumbnailSize   , QSize );
     property_copy( useCompressedIndexXML , setUseCompressedIndexXML , bool );
+    property_copy( indentIndexXML        , setIndentIndexXML        , bool );
     property_copy( compressBackup        , setCompressBackup        , bool );
     property_copy( showSplashScreen      , setShowSplashScreen      , bool );
     property_copy( showHistogram         , setShowHistogram         , bool );
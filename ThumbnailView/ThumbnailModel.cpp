@@ -44,118 +44,248 @@ ThumbnailView::ThumbnailModel::ThumbnailModel( ThumbnailFactory* factory)
     m_VideoPlaceholder = QIcon::fromTheme( QLatin1String("video-x-generic") ).pixmap( cellGeometryInfo()->preferredIconSize() );
 }
 
-static bool stackOrderComparator(const DB::FileName& a, const DB::FileName& b) {
-    return a.info()->stackOrder() < b.info()->stackOrder();
-}
-
 void ThumbnailView::ThumbnailModel::updateDisplayModel()
 {
-    beginResetModel();
-    ImageManager::AsyncLoader::instance()->stop( model(), ImageManager::StopOnlyNonPriorityLoads );
+    // the stacks might have changed in the database:
+    const QHash<DB::FileName, DB::StackID> oldStackOf = m_stackOf;
+    updateStacks();
+    setDisplayList( createDisplayList() );
 
-    // Note, this can be simplified, if we make the database backend already
-    // return things in the right order. Then we only need one pass while now
-    // we need to go through the list two times.
+    // images that joined or left a stack are drawn differently:
+    for ( auto it = m_stackOf.constBegin(); it != m_stackOf.constEnd(); ++it ) {
+        if ( oldStackOf.value( it.key() ) != it.value() )
+            updateCell( it.key() );
+    }
+    for ( auto it = oldStackOf.constBegin(); it != oldStackOf.constEnd(); ++it ) {
+        if ( !m_stackOf.contains( it.key() ) )
+            updateCell( it.key() );
+    }
+    emitStackActionStates();
+}
+
+void ThumbnailView::ThumbnailModel::updateStacks()
+{
+    m_stackOf.clear();
+    m_stackContents.clear();
+    m_allStacks.clear();
 
-    /* Extract all stacks we have first. Different stackid's might be
-     * intermingled in the result so we need to know this ahead before
-     * creating the display list.
-     */
-    typedef QList<DB::FileName> StackList;
-    typedef QMap<DB::StackID, StackList> StackMap;
-    StackMap stackContents;
     Q_FOREACH(const DB::FileName& fileName, m_imageList) {
-        DB::ImageInfoPtr imageInfo = fileName.info();
-        if ( imageInfo && imageInfo->isStacked() ) {
-            DB::StackID stackid = imageInfo->stackId();
-            stackContents[stackid].append(fileName);
+        const DB::StackID stackid = DB::ImageDB::instance()->getStackId( fileName );
+        if ( stackid != 0 ) {
+            m_stackOf.insert( fileName, stackid );
+            m_allStacks.insert( stackid );
         }
     }
 
-    /*
-     * All stacks need to be ordered in their stack order. We don't rely that
-     * the images actually came in the order necessary.
+    /* The database has the stacks in their stack order already.
+     * Only the images given to us are shown, though.
      */
-    for (StackMap::iterator it = stackContents.begin(); it != stackContents.end(); ++it) {
-        std::stable_sort(it->begin(), it->end(), stackOrderComparator);
+    for ( auto it = m_stackOf.constBegin(); it != m_stackOf.constEnd(); ++it ) {
+        if ( m_stackContents.contains( it.value() ) )
+            continue;
+        DB::FileNameList& orderedStack = m_stackContents[it.value()];
+        Q_FOREACH( const DB::FileName& member, DB::ImageDB::instance()->getStackFor( it.key() ) ) {
+            if ( m_stackOf.contains( member ) )
+                orderedStack.append( member );
+        }
     }
+}
 
+DB::FileNameList ThumbnailView::ThumbnailModel::createDisplayList() const
+{
     /* Build the final list to be displayed. That is basically the sequence
      * we got from the original, but the stacks shown with all images together
      * in the right sequence or collapsed showing only the top image.
      */
-    m_displayList = DB::FileNameList();
+    DB::FileNameList displayList;
     QSet<DB::StackID> alreadyShownStacks;
     Q_FOREACH( const DB::FileName& fileName, m_imageList) {
-        DB::ImageInfoPtr imageInfo = fileName.info();
-        if ( imageInfo && imageInfo->isStacked()) {
-            DB::StackID stackid = imageInfo->stackId();
-            if (alreadyShownStacks.contains(stackid))
-                continue;
-            StackMap::iterator found = stackContents.find(stackid);
-            Q_ASSERT(found != stackContents.end());
-            const StackList& orderedStack = *found;
-            if (m_expandedStacks.contains(stackid)) {
-                Q_FOREACH( const DB::FileName& fileName, orderedStack) {
-                    m_displayList.append(fileName);
-                }
-            } else {
-                m_displayList.append(orderedStack.at(0));
-            }
-            alreadyShownStacks.insert(stackid);
-        }
-        else {
-            m_displayList.append(fileName);
+        const auto found = m_stackOf.constFind( fileName );
+        if ( found == m_stackOf.constEnd() ) {
+            displayList.append(fileName);
+            continue;
         }
+        const DB::StackID stackid = found.value();
+        if (alreadyShownStacks.contains(stackid))
+            continue;
+        const DB::FileNameList& orderedStack = m_stackContents[stackid];
+        if (m_expandedStacks.contains(stackid))
+            displayList.append(orderedStack);
+        else
+            displayList.append(orderedStack.at(0));
+        alreadyShownStacks.insert(stackid);
     }
 
     if ( m_sortDirection != OldestFirst )
-        m_displayList = m_displayList.reversed();
+        return displayList.reversed();
+    return displayList;
+}
 
-    updateIndexCache();
+void ThumbnailView::ThumbnailModel::setDisplayList( const DB::FileNameList& displayList )
+{
+    QHash<DB::FileName, int> newRows;
+    newRows.reserve( displayList.size() );
+    for ( int row = 0; row < displayList.size(); ++row )
+        newRows.insert( displayList.at(row), row );
+
+    /* Images that are shown both before and after usually stay in the same order,
+     * as only stacks were expanded or collapsed, or images were deleted or added.
+     * Then the view is told about the rows that went away or came in, and keeps
+     * its scroll position and the thumbnails it has got.
+     * Anything else is a new list altogether.
+     */
+    int keptCount = 0;
+    int previousRow = -1;
+    bool inOrder = ( newRows.size() == displayList.size() );
+    for ( int row = 0; inOrder && row < m_displayList.size(); ++row ) {
+        const auto found = newRows.constFind( m_displayList.at(row) );
+        if ( found == newRows.constEnd() )
+            continue;
+        inOrder = ( found.value() > previousRow );
+        previousRow = found.value();
+        ++keptCount;
+    }
+
+    if ( !inOrder || ( keptCount == 0 && !m_displayList.isEmpty() ) ) {
+        beginResetModel();
+        ImageManager::AsyncLoader::instance()->stop( model(), ImageManager::StopOnlyNonPriorityLoads );
+        m_displayList = displayList;
+        updateIndexCache();
+        endResetModel();
+        return;
+    }
+
+    int firstChangedRow = m_displayList.size();
+    for ( int row = m_displayList.size() - 1; row >= 0; ) {
+        if ( newRows.contains( m_displayList.at(row) ) ) {
+            --row;
+            continue;
+        }
+        const int last = row;
+        while ( row >= 0 && !newRows.contains( m_displayList.at(row) ) )
+            --row;
+        const int first = row + 1;
+
+        beginRemoveRows( QModelIndex(), first, last );
+        for ( int i = last; i >= first; --i ) {
+            m_fileNameToIndex.remove( m_displayList.at(i) );
+            m_displayList.removeAt(i);
+        }
+        invalidateIndexCache( first );
+        endRemoveRows();
+        firstChangedRow = first;
+    }
 
+    // m_fileNameToIndex now only knows the images that were there before, and those already inserted:
+    for ( int row = 0; row < displayList.size(); ) {
+        if ( m_fileNameToIndex.contains( displayList.at(row) ) ) {
+            ++row;
+            continue;
+        }
+        const int first = row;
+        while ( row < displayList.size() && !m_fileNameToIndex.contains( displayList.at(row) ) )
+            ++row;
+
+        beginInsertRows( QModelIndex(), first, row - 1 );
+        for ( int i = first; i < row; ++i )
+            m_displayList.insert( i, displayList.at(i) );
+        invalidateIndexCache( first );
+        endInsertRows();
+        firstChangedRow = qMin( firstChangedRow, first );
+    }
+
+    Q_ASSERT( m_displayList.size() == displayList.size() );
+    updateIndexCache( firstChangedRow );
+}
+
+void ThumbnailView::ThumbnailModel::emitStackActionStates()
+{
     emit collapseAllStacksEnabled( m_expandedStacks.size() > 0);
-    emit expandAllStacksEnabled( m_allStacks.size() != model()->m_expandedStacks.size() );
-    endResetModel();
+    emit expandAllStacksEnabled( m_allStacks.size() != m_expandedStacks.size() );
 }
 
 void ThumbnailView::ThumbnailModel::toggleStackExpansion(const DB::FileName& fileName)
 {
-    DB::ImageInfoPtr imageInfo = fileName.info();
-    if (imageInfo) {
-        DB::StackID stackid = imageInfo->stackId();
-        model()->beginResetModel();
-        if (m_expandedStacks.contains(stackid))
-            m_expandedStacks.remove(stackid);
+    const auto found = m_stackOf.constFind( fileName );
+    if ( found == m_stackOf.constEnd() )
+        return;
+    const DB::StackID stackid = found.value();
+    const DB::FileNameList& orderedStack = m_stackContents[stackid];
+    const bool expand = !m_expandedStacks.contains( stackid );
+
+    /* Only the rows of this stack change. The top of the stack stays where it is,
+     * and the other images go after it, or before it when showing the newest first.
+     */
+    const int top = indexOf( orderedStack.at(0) );
+    const int count = orderedStack.size() - 1;
+    if ( top < 0 || count == 0 ) {
+        if ( expand )
+            m_expandedStacks.insert( stackid );
         else
-            m_expandedStacks.insert(stackid);
-        updateDisplayModel();
-        model()->endResetModel();
+            m_expandedStacks.remove( stackid );
+        updateCell( orderedStack.at(0) );
+        emitStackActionStates();
+        return;
+    }
+    const int first = ( m_sortDirection == OldestFirst ) ? top + 1 : top - ( expand ? 0 : count );
+
+    ImageManager::AsyncLoader::instance()->stop( model(), ImageManager::StopOnlyNonPriorityLoads );
+    if ( expand ) {
+        beginInsertRows( QModelIndex(), first, first + count - 1 );
+        for ( int i = 0; i < count; ++i ) {
+            // the stack order is reversed along with the rest when showing the newest first:
+            const DB::FileName& member = ( m_sortDirection == OldestFirst ) ? orderedStack.at( i + 1 ) : orderedStack.at( count - i );
+            m_displayList.insert( first + i, member );
+        }
+        m_expandedStacks.insert( stackid );
+        updateIndexCache( first );
+        endInsertRows();
+    } else {
+        beginRemoveRows( QModelIndex(), first, first + count - 1 );
+        for ( int i = 0; i < count; ++i ) {
+            m_fileNameToIndex.remove( m_displayList.at( first ) );
+            m_displayList.removeAt( first );
+        }
+        m_expandedStacks.remove( stackid );
+        updateIndexCache( first );
+        endRemoveRows();
     }
+    // the top of the stack is drawn with the expanded or collapsed stack:
+    updateCell( orderedStack.at(0) );
+    emitStackActionStates();
 }
 
 void ThumbnailView::ThumbnailModel::collapseAllStacks()
 {
+    const QSet<DB::StackID> expandedStacks = m_expandedStacks;
     m_expandedStacks.clear();
-    updateDisplayModel();
+    setDisplayList( createDisplayList() );
+    updateStackTops( expandedStacks );
+    emitStackActionStates();
 }
 
 void ThumbnailView::ThumbnailModel::expandAllStacks()
 {
+    const QSet<DB::StackID> collapsedStacks = m_allStacks - m_expandedStacks;
     m_expandedStacks = m_allStacks;
-    updateDisplayModel();
+    setDisplayList( createDisplayList() );
+    updateStackTops( collapsedStacks );
+    emitStackActionStates();
+}
+
+void ThumbnailView::ThumbnailModel::updateStackTops( const QSet<DB::StackID>& stacks )
+{
+    Q_FOREACH( const DB::StackID& stackid, stacks ) {
+        const auto found = m_stackContents.constFind( stackid );
+        if ( found != m_stackContents.constEnd() )
+            updateCell( found.value().at(0) );
+    }
 }
 
 
 void ThumbnailView::ThumbnailModel::setImageList(const DB::FileNameList& items)
 {
     m_imageList = items;
-    m_allStacks.clear();
-    Q_FOREACH( const DB::FileName& fileName, items) {
-        DB::ImageInfoPtr info = fileName.info();
-        if ( info && info->isStacked() )
-            m_allStacks << info->stackId();
-    }
     updateDisplayModel();
     preloadThumbnails();
 }
@@ -173,41 +303,48 @@ void ThumbnailView::ThumbnailModel::imagesDeletedFromDB( const DB::FileNameList&
 {
     SelectionMaintainer dummy(widget(),model());
 
-    Q_FOREACH( const DB::FileName& fileName, list ) {
-        m_displayList.removeAll(fileName);
-        m_imageList.removeAll(fileName);
+    const QSet<DB::FileName> deleted = list.toSet();
+    DB::FileNameList remaining;
+    remaining.reserve( m_imageList.size() );
+    Q_FOREACH( const DB::FileName& fileName, m_imageList ) {
+        if ( !deleted.contains( fileName ) )
+            remaining.append( fileName );
     }
+    m_imageList = remaining;
     updateDisplayModel();
 }
 
 
 int ThumbnailView::ThumbnailModel::indexOf(const DB::FileName& fileName)
 {
-    Q_ASSERT( !fileName.isNull() );
-    if ( !m_fileNameToIndex.contains(fileName) )
-        m_fileNameToIndex.insert(fileName, m_displayList.indexOf(fileName));
-    
-    return m_fileNameToIndex[fileName];
+    return static_cast<const ThumbnailModel*>( this )->indexOf( fileName );
 }
 
 int ThumbnailView::ThumbnailModel::indexOf(const DB::FileName& fileName) const
 {
     Q_ASSERT( !fileName.isNull() );
-    if ( !m_fileNameToIndex.contains(fileName) )
-        return -1;
-    
-    return m_fileNameToIndex[fileName];
+    if ( m_indexCacheValidRows < m_displayList.size() )
+        updateIndexCache( m_indexCacheValidRows );
+    // the index now holds every image of m_displayList:
+    return m_fileNameToIndex.value( fileName, -1 );
 }
 
 void ThumbnailView::ThumbnailModel::updateIndexCache()
 {
     m_fileNameToIndex.clear();
-    int index = 0;
-    Q_FOREACH( const DB::FileName& fileName, m_displayList) {
-        m_fileNameToIndex[fileName] = index;
-        ++index;
-    }
+    updateIndexCache( 0 );
+}
+
+void ThumbnailView::ThumbnailModel::updateIndexCache( int fromRow ) const
+{
+    for ( int index = fromRow; index < m_displayList.size(); ++index )
+        m_fileNameToIndex[m_displayList.at(index)] = index;
+    m_indexCacheValidRows = m_displayList.size();
+}
 
+void ThumbnailView::ThumbnailModel::invalidateIndexCache( int fromRow )
+{
+    m_indexCacheValidRows = qMin( m_indexCacheValidRows, fromRow );
 }
 
 DB::FileName ThumbnailView::ThumbnailModel::rightDropItem() const
@@ -399,7 +536,9 @@ void ThumbnailView::ThumbnailModel::updateCell( const QModelIndex& index )
 
 void ThumbnailView::ThumbnailModel::updateCell( const DB::FileName& fileName )
 {
-    updateCell( indexOf(fileName) );
+    const int row = indexOf(fileName);
+    if ( row >= 0 )
+        updateCell( row );
 }
 
 QModelIndex ThumbnailView::ThumbnailModel::fileNameToIndex( const DB::FileName& fileName ) const
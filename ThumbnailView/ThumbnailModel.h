@@ -19,7 +19,9 @@
 #define THUMBNAILMODEL_H
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QPixmap>
+#include <QSet>
 
 #include <DB/FileNameList.h>
 #include <DB/ImageInfo.h>
@@ -79,6 +81,9 @@ public:
     void setOverrideImage( const DB::FileName& fileName, const QPixmap& pixmap );
 
     //-------------------------------------------------- Misc.
+    /**
+     * Read the stacks of the images from the database again, and rebuild the display list.
+     */
     void updateDisplayModel();
     void updateIndexCache();
     void setSortDirection( SortDirection );
@@ -96,6 +101,13 @@ signals:
 private: // Methods
     void requestThumbnail( const DB::FileName& mediaId, const ImageManager::Priority priority );
     void preloadThumbnails();
+    void updateStacks();
+    DB::FileNameList createDisplayList() const;
+    void setDisplayList( const DB::FileNameList& displayList );
+    void updateStackTops( const QSet<DB::StackID>& stacks );
+    void updateIndexCache( int fromRow ) const;
+    void invalidateIndexCache( int fromRow );
+    void emitStackActionStates();
 
 private slots:
     void imagesDeletedFromDB( const DB::FileNameList& );
@@ -136,10 +148,25 @@ private: // Instance variables.
      * Used by expandAllStacks. */
     QSet<DB::StackID> m_allStacks;
 
+    /**
+     * The stack of every stacked image in m_imageList.
+     */
+    QHash<DB::FileName, DB::StackID> m_stackOf;
+
+    /**
+     * The images of every stack in m_imageList, in stack order.
+     */
+    QHash<DB::StackID, DB::FileNameList> m_stackContents;
+
     /**
      * A map mapping from Id to its index in m_displayList.
      */
-    QMap<DB::FileName,int> m_fileNameToIndex;
+    mutable QHash<DB::FileName,int> m_fileNameToIndex;
+    /**
+     * The rows of m_displayList from here on may have moved since m_fileNameToIndex was updated.
+     * indexOf() brings them up to date when needed.
+     */
+    mutable int m_indexCacheValidRows = 0;
 
     int m_firstVisibleRow;
     int m_lastVisibleRow;
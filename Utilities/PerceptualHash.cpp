@@ -0,0 +1,91 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "PerceptualHash.h"
+
+#include <QImage>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr int SIZE = 32;
+constexpr int FREQUENCIES = 8;
+
+// cosines[u * SIZE + x] is the DCT-II basis function of frequency u at pixel x
+QVector<double> dctCosines()
+{
+    QVector<double> cosines( FREQUENCIES * SIZE );
+    for ( int u = 0; u < FREQUENCIES; ++u ) {
+        for ( int x = 0; x < SIZE; ++x )
+            cosines[u * SIZE + x] = std::cos( ( 2 * x + 1 ) * u * M_PI / ( 2 * SIZE ) );
+    }
+    return cosines;
+}
+}
+
+quint64 Utilities::perceptualHash( const QImage& image )
+{
+    if ( image.isNull() )
+        return 0;
+
+    static const QVector<double> cosines = dctCosines();
+
+    const QImage grey = image.scaled( SIZE, SIZE, Qt::IgnoreAspectRatio, Qt::SmoothTransformation )
+            .convertToFormat( QImage::Format_Grayscale8 );
+
+    // Only the lowest frequencies are needed, so the rows are transformed first and
+    // then the columns of the few coefficients that are left.
+    double rows[SIZE][FREQUENCIES];
+    for ( int y = 0; y < SIZE; ++y ) {
+        const uchar* line = grey.constScanLine( y );
+        for ( int u = 0; u < FREQUENCIES; ++u ) {
+            double sum = 0;
+            for ( int x = 0; x < SIZE; ++x )
+                sum += line[x] * cosines[u * SIZE + x];
+            rows[y][u] = sum;
+        }
+    }
+
+    double coefficients[FREQUENCIES * FREQUENCIES];
+    for ( int v = 0; v < FREQUENCIES; ++v ) {
+        for ( int u = 0; u < FREQUENCIES; ++u ) {
+            double sum = 0;
+            for ( int y = 0; y < SIZE; ++y )
+                sum += rows[y][u] * cosines[v * SIZE + y];
+            coefficients[v * FREQUENCIES + u] = sum;
+        }
+    }
+
+    // The first coefficient is the average brightness, which says nothing about the picture itself.
+    double sorted[FREQUENCIES * FREQUENCIES - 1];
+    std::copy( coefficients + 1, coefficients + FREQUENCIES * FREQUENCIES, sorted );
+    std::nth_element( sorted, sorted + ( FREQUENCIES * FREQUENCIES - 1 ) / 2, sorted + FREQUENCIES * FREQUENCIES - 1 );
+    const double median = sorted[( FREQUENCIES * FREQUENCIES - 1 ) / 2];
+
+    quint64 hash = 0;
+    for ( int i = 0; i < FREQUENCIES * FREQUENCIES; ++i ) {
+        if ( coefficients[i] > median )
+            hash |= quint64( 1 ) << i;
+    }
+    return hash;
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
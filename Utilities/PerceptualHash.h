@@ -0,0 +1,51 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef UTILITIES_PERCEPTUALHASH_H
+#define UTILITIES_PERCEPTUALHASH_H
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+class QImage;
+
+namespace Utilities
+{
+
+/**
+ * @return a 64 bit hash of what \p image looks like, or 0 if \p image is null.
+ *
+ * The hash is made of the signs of the lowest frequencies of the discrete cosine transform
+ * of the image scaled down to 32x32 grey pixels. A resized or re-encoded copy of an image
+ * gets a hash that differs in only a few bits; see hammingDistance().
+ */
+quint64 perceptualHash( const QImage& image );
+
+/**
+ * @return the number of bits in which \p a and \p b differ.
+ */
+inline int hammingDistance( quint64 a, quint64 b )
+{
+    // compiles to a single popcnt instruction where the CPU has one
+    return qPopulationCount( a ^ b );
+}
+
+}
+
+#endif /* UTILITIES_PERCEPTUALHASH_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -20,7 +20,7 @@
 #ifndef UTILITIES_UNIQ_FILENAME_MAPPER_H
 #define UTILITIES_UNIQ_FILENAME_MAPPER_H
 
-#include <QMap>
+#include <QHash>
 #include <QSet>
 #include <QString>
 #include <DB/FileName.h>
@@ -63,7 +63,7 @@ private:
     bool fileClashes(const QString& file);
 
     const QString m_targetDirectory;
-    typedef QMap<DB::FileName, QString> FileNameMap;
+    typedef QHash<DB::FileName, QString> FileNameMap;
     FileNameMap m_origToUniq;
     QSet<QString> m_uniqFiles;
 };
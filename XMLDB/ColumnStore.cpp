@@ -0,0 +1,105 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "ColumnStore.h"
+
+void XMLDB::Columns::resize( int size )
+{
+    m_infos.clear();
+    m_infos.reserve( size );
+    m_date.resize( size );
+    m_mediaType.resize( size );
+    m_rating.resize( size );
+    m_stackId.resize( size );
+    m_stackOrder.resize( size );
+    m_locked.resize( size );
+    m_size.resize( size );
+}
+
+void XMLDB::Columns::set( int row, const DB::ImageInfoPtr& info )
+{
+    m_date[row] = info->date();
+    m_mediaType[row] = info->mediaType();
+    m_rating[row] = info->rating();
+    m_stackId[row] = info->stackId();
+    m_stackOrder[row] = info->stackOrder();
+    m_locked.setBit( row, info->isLocked() );
+    m_size[row] = info->size();
+}
+
+XMLDB::ColumnStore::ColumnStore( DB::ImageInfoObserver* observer )
+    : m_observer( observer )
+{
+}
+
+void XMLDB::ColumnStore::invalidate()
+{
+    m_valid = false;
+}
+
+const XMLDB::Columns& XMLDB::ColumnStore::columns( const DB::ImageInfoList& images )
+{
+    if ( m_valid )
+        return m_columns;
+
+    m_columns.resize( images.size() );
+    for ( int row = 0; row < images.size(); ++row ) {
+        const DB::ImageInfoPtr& info = images.at( row );
+        m_columns.m_infos.append( info );
+        m_columns.set( row, info );
+        info->setObserver( m_observer, row );
+    }
+    m_valid = true;
+    return m_columns;
+}
+
+void XMLDB::ColumnStore::imageInfoChanged( int row, const DB::ImageInfo* info )
+{
+    // The image may have left the database since the columns were built, and a copy
+    // of an ImageInfo also carries the row of the original.
+    if ( !m_valid || row >= m_columns.size() || m_columns.info( row ).data() != info )
+        return;
+
+    m_columns.set( row, m_columns.info( row ) );
+}
+
+int XMLDB::ColumnStore::rowOf( const DB::ImageInfo* info ) const
+{
+    if ( !m_valid || info->observer() != m_observer )
+        return -1;
+    const int row = info->observerIndex();
+    if ( row < 0 || row >= m_columns.size() || m_columns.info( row ).data() != info )
+        return -1;
+    return row;
+}
+
+void XMLDB::ColumnStore::rowsMoved( const DB::ImageInfoList& images, int first, int last )
+{
+    if ( !m_valid )
+        return;
+
+    Q_ASSERT( images.size() == m_columns.size() );
+    for ( int row = first; row < last; ++row ) {
+        const DB::ImageInfoPtr& info = images.at( row );
+        m_columns.m_infos[row] = info;
+        m_columns.set( row, info );
+        info->setObserver( m_observer, row );
+    }
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
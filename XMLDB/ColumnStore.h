@@ -0,0 +1,127 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef XMLDB_COLUMNSTORE_H
+#define XMLDB_COLUMNSTORE_H
+
+#include <DB/ImageDate.h>
+#include <DB/ImageInfo.h>
+#include <DB/ImageInfoObserver.h>
+#include <DB/ImageInfoList.h>
+
+#include <QBitArray>
+#include <QSize>
+#include <QVector>
+
+namespace XMLDB
+{
+
+/**
+ * \brief The fields of all images that scans over the database need, in contiguous arrays.
+ *
+ * Row \c i holds the fields of image \c i of the database.
+ * Searching, classifying, building the date bar and looking up stacks need only a few fields
+ * of every image. Reading them from here keeps the scans from chasing a pointer to every
+ * ImageInfo, most of which is strings and maps the scans never look at.
+ *
+ * All arrays are implicitly shared, so a copy is a cheap snapshot of the columns.
+ */
+class Columns
+{
+public:
+    int size() const { return m_infos.size(); }
+
+    const DB::ImageInfoPtr& info( int row ) const { return m_infos.at( row ); }
+    const DB::ImageDate& date( int row ) const { return m_date.at( row ); }
+    DB::MediaType mediaType( int row ) const { return m_mediaType.at( row ); }
+    short rating( int row ) const { return m_rating.at( row ); }
+    DB::StackID stackId( int row ) const { return m_stackId.at( row ); }
+    unsigned int stackOrder( int row ) const { return m_stackOrder.at( row ); }
+    bool isLocked( int row ) const { return m_locked.testBit( row ); }
+    QSize size( int row ) const { return m_size.at( row ); }
+
+private:
+    friend class ColumnStore;
+    void resize( int size );
+    void set( int row, const DB::ImageInfoPtr& info );
+
+    DB::ImageInfoList m_infos;
+    QVector<DB::ImageDate> m_date;
+    QVector<DB::MediaType> m_mediaType;
+    QVector<short> m_rating;
+    QVector<DB::StackID> m_stackId;
+    QVector<unsigned int> m_stackOrder;
+    QBitArray m_locked;
+    QVector<QSize> m_size;
+};
+
+/**
+ * \brief Keeps the Columns of the images of XMLDB::Database up to date.
+ *
+ * The database observes its images (see DB::ImageInfoObserver) and passes the changes on to
+ * imageInfoChanged(), so the setters of ImageInfo update the row of their image right away.
+ * The store tells the images their row through the index of that observer.
+ * Any change to the list of images invalidates the store, and the columns are built
+ * again the next time they are needed.
+ */
+class ColumnStore
+{
+public:
+    /**
+     * @param observer is the observer of the images; the store sets their index to their row.
+     */
+    explicit ColumnStore( DB::ImageInfoObserver* observer );
+    ColumnStore( const ColumnStore& ) = delete;
+    ColumnStore& operator=( const ColumnStore& ) = delete;
+
+    /**
+     * Call whenever images are added to, removed from or moved within the image list.
+     */
+    void invalidate();
+
+    /**
+     * @return the columns of \p images, which must be the image list of the database.
+     */
+    const Columns& columns( const DB::ImageInfoList& images );
+
+    /**
+     * Copy the fields of \p info into its row again. Called for the setters of DB::ImageInfo.
+     */
+    void imageInfoChanged( int row, const DB::ImageInfo* info );
+
+    /**
+     * @return the row of \p info in the columns, or -1 if the columns are not built or \p info is not in them.
+     */
+    int rowOf( const DB::ImageInfo* info ) const;
+
+    /**
+     * Call instead of invalidate() when images were only moved around within the rows
+     * \p first up to \p last (exclusive) of \p images.
+     */
+    void rowsMoved( const DB::ImageInfoList& images, int first, int last );
+
+private:
+    DB::ImageInfoObserver* m_observer;
+    Columns m_columns;
+    bool m_valid = false;
+};
+
+}
+
+#endif /* XMLDB_COLUMNSTORE_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
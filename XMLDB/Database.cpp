@@ -27,24 +27,49 @@
 #include "DB/ImageInfoPtr.h"
 #include "DB/CategoryCollection.h"
 #include "XMLCategory.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QExplicitlySharedDataPointer>
+#include <QFile>
 #include <QFileInfo>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QThread>
 #include "XMLImageDateCollection.h"
 #include "FileReader.h"
 #include "FileWriter.h"
+#include "Logging.h"
+#include "SaveTask.h"
 #include "Exif/Database.h"
 #include <DB/FileName.h>
+#include <MainWindow/Logging.h>
+
+#include <algorithm>
+#include <vector>
 
 using Utilities::StringSet;
 
 bool XMLDB::Database::s_anyImageWithEmptySize = false;
 XMLDB::Database::Database( const QString& configFile ):
-    m_fileName(configFile)
+    m_fileName(configFile),
+    m_columnStore(this),
+    m_pendingCheckpoints(0)
 {
+    // the thread calling forEachRange processes a range as well:
+    m_searchPool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() - 1 ) );
+    m_savePool.setMaxThreadCount( 1 );
+
     Utilities::checkForBackupFile( configFile );
     FileReader reader( this );
     reader.read( configFile );
     m_nextStackId = reader.nextStackId();
+    Q_FOREACH( const DB::ImageInfoPtr& imageInfo, m_images ) {
+        m_stacks.insert( imageInfo );
+        m_imageCache.insert( imageInfo->fileName(), imageInfo );
+        imageInfo->setObserver( this, -1 );
+    }
+    m_journal.loaded( this, reader.replayedJournalEntries() );
+    connect( &m_members, SIGNAL(dirty()), this, SLOT(memberGroupsChanged()) );
 
     connect( categoryCollection(), SIGNAL(itemRemoved(DB::Category*,QString)),
              this, SLOT(deleteItem(DB::Category*,QString)) );
@@ -59,52 +84,187 @@ XMLDB::Database::Database( const QString& configFile ):
              &m_members, SLOT(deleteCategory(QString)));
 }
 
+XMLDB::Database::~Database()
+{
+    m_savePool.waitForDone();
+    // the images may outlive the database:
+    Q_FOREACH( const DB::ImageInfoPtr& imageInfo, m_images )
+        imageInfo->setObserver( nullptr, -1 );
+}
+
 uint XMLDB::Database::totalCount() const
 {
     return m_images.count();
 }
 
+namespace
+{
 /**
- * I was considering merging the two calls to this method (one for images, one for video), but then I
- * realized that all the work is really done after the check for whether the given
- * imageInfo is of the right type, and as a match can't be both, this really
- * would buy me nothing.
+ * @return search info matching the images of \p info without any item of \p category.
  */
-QMap<QString,uint> XMLDB::Database::classify( const DB::ImageSearchInfo& info, const QString &category, DB::MediaType typemask )
+DB::ImageSearchInfo noMatchInfoFor( const DB::ImageSearchInfo& info, const QString& category )
 {
-    QMap<QString, uint> map;
-    DB::GroupCounter counter( category );
-    Utilities::StringSet alreadyMatched = info.findAlreadyMatched( category );
-
     DB::ImageSearchInfo noMatchInfo = info;
     QString currentMatchTxt = noMatchInfo.categoryMatchText( category );
     if ( currentMatchTxt.isEmpty() )
         noMatchInfo.setCategoryMatchText( category, DB::ImageDB::NONE() );
     else
         noMatchInfo.setCategoryMatchText( category, QString::fromLatin1( "%1 & %2" ).arg(currentMatchTxt).arg(DB::ImageDB::NONE()) );
+    return noMatchInfo;
+}
 
-    // Iterate through the whole database of images.
-    for( DB::ImageInfoListConstIterator it = m_images.constBegin(); it != m_images.constEnd(); ++it ) {
-        bool match = ( (*it)->mediaType() & typemask ) && !(*it)->isLocked() && info.match( *it ) && rangeInclude( *it );
-        if ( match ) { // If the given image is currently matched.
-
-            // Now iterate through all the categories the current image
-            // contains, and increase them in the map mapping from category
-            // to count.
-            StringSet items = (*it)->itemsOfCategory(category);
-            counter.count( items );
-            for( StringSet::const_iterator it2 = items.begin(); it2 != items.end(); ++it2 ) {
-                if ( !alreadyMatched.contains(*it2) ) // We do not want to match "Jesper & Jesper"
-                    map[*it2]++;
-            }
+// Below this number of images per thread, spreading a search over several threads does not pay off:
+constexpr int MIN_IMAGES_PER_RANGE = 1000;
+
+void addCounts( QMap<QString,uint>& to, const QMap<QString,uint>& from )
+{
+    for( QMap<QString,uint>::const_iterator it = from.begin(); it != from.end(); ++it )
+        to[it.key()] += it.value();
+}
+
+/**
+ * What to count for one category in XMLDB::Database::classifyCategories.
+ * This is shared by the CategoryCounter of all threads, and does not change while counting.
+ */
+struct CategoryQuery
+{
+    CategoryQuery( const DB::ImageSearchInfo& info, const QString& category )
+        : category( category )
+        , alreadyMatched( info.findAlreadyMatched( category ) )
+        , noMatchInfo( noMatchInfoFor( info, category ) )
+    {}
+
+    QString category;
+    StringSet alreadyMatched;
+    DB::ImageSearchInfo noMatchInfo;
+};
+
+/**
+ * Counting state of one category in XMLDB::Database::classifyCategories.
+ */
+struct CategoryCounter
+{
+    explicit CategoryCounter( const CategoryQuery& query )
+        : query( &query )
+        , imageGroups( query.category )
+        , videoGroups( query.category )
+    {}
+
+    void count( const DB::ImageInfoPtr& imageInfo, DB::MediaType mediaType )
+    {
+        const bool isImage = ( mediaType == DB::Image );
+        QMap<QString,uint>& map = isImage ? result.images : result.videos;
+
+        const StringSet items = imageInfo->itemsOfCategory( query->category );
+        ( isImage ? imageGroups : videoGroups ).count( items );
+        for( StringSet::const_iterator it = items.begin(); it != items.end(); ++it ) {
+            if ( !query->alreadyMatched.contains(*it) ) // We do not want to match "Jesper & Jesper"
+                map[*it]++;
+        }
+
+        // Find those with no other matches
+        if ( query->noMatchInfo.match( imageInfo ) )
+            map[DB::ImageDB::NONE()]++;
+    }
+
+    /**
+     * Add the counts of \p other, which counted other images for the same query.
+     */
+    void merge( const CategoryCounter& other )
+    {
+        addCounts( result.images, other.result.images );
+        addCounts( result.videos, other.result.videos );
+        imageGroups.merge( other.imageGroups );
+        videoGroups.merge( other.videoGroups );
+    }
+
+    /**
+     * @return the counts so far, including the member groups.
+     */
+    DB::CategoryClassification current() const
+    {
+        DB::CategoryClassification classification = result;
+        const QMap<QString,uint> imageGroupCounts = imageGroups.result();
+        for( QMap<QString,uint>::const_iterator it = imageGroupCounts.begin(); it != imageGroupCounts.end(); ++it )
+            classification.images[it.key()] = it.value();
+        const QMap<QString,uint> videoGroupCounts = videoGroups.result();
+        for( QMap<QString,uint>::const_iterator it = videoGroupCounts.begin(); it != videoGroupCounts.end(); ++it )
+            classification.videos[it.key()] = it.value();
+        return classification;
+    }
+
+    const CategoryQuery* query;
+    DB::GroupCounter imageGroups;
+    DB::GroupCounter videoGroups;
+    DB::CategoryClassification result;
+};
+
+/**
+ * Runs XMLDB::Database::forEachRange for one range of images.
+ */
+class RangeTask : public QRunnable
+{
+public:
+    RangeTask( const std::function<void( int, int, int )>& function, int index, int begin, int end )
+        : m_function( function ), m_index( index ), m_begin( begin ), m_end( end )
+    {}
+    void run() override
+    {
+        m_function( m_index, m_begin, m_end );
+    }
+
+private:
+    const std::function<void( int, int, int )>& m_function;
+    const int m_index;
+    const int m_begin;
+    const int m_end;
+};
+}
 
-            // Find those with no other matches
-            if ( noMatchInfo.match( *it ) )
-                map[DB::ImageDB::NONE()]++;
+QMap<QString,uint> XMLDB::Database::classify( const DB::ImageSearchInfo& info, const QString &category, DB::MediaType typemask )
+{
+    const Utilities::StringSet alreadyMatched = info.findAlreadyMatched( category );
+    const DB::ImageSearchInfo noMatchInfo = noMatchInfoFor( info, category );
+    const bool concurrent = info.prepareConcurrentMatching() && noMatchInfo.prepareConcurrentMatching();
+
+    // Every range of images is counted on its own, and the counts are added up afterwards.
+    const Columns& images = columns();
+    const QVector<QPair<int, int>> ranges = imageRanges( 0, images.size(), concurrent );
+    std::vector<QMap<QString, uint>> maps( ranges.size() );
+    std::vector<DB::GroupCounter> counters( ranges.size(), DB::GroupCounter( category ) );
+
+    forEachRange( ranges, [&]( int index, int begin, int end ) {
+        QMap<QString, uint>& map = maps[index];
+        DB::GroupCounter& counter = counters[index];
+        for ( int row = begin; row < end; ++row ) {
+            const DB::ImageInfoPtr& imageInfo = images.info( row );
+            bool match = ( images.mediaType( row ) & typemask ) && matches( info, images, row, true );
+            if ( match ) { // If the given image is currently matched.
+
+                // Now iterate through all the categories the current image
+                // contains, and increase them in the map mapping from category
+                // to count.
+                StringSet items = imageInfo->itemsOfCategory(category);
+                counter.count( items );
+                for( StringSet::const_iterator it2 = items.begin(); it2 != items.end(); ++it2 ) {
+                    if ( !alreadyMatched.contains(*it2) ) // We do not want to match "Jesper & Jesper"
+                        map[*it2]++;
+                }
+
+                // Find those with no other matches
+                if ( noMatchInfo.match( imageInfo ) )
+                    map[DB::ImageDB::NONE()]++;
+            }
         }
+    });
+
+    QMap<QString, uint> map = maps.front();
+    for ( size_t index = 1; index < maps.size(); ++index ) {
+        addCounts( map, maps[index] );
+        counters.front().merge( counters[index] );
     }
 
-    QMap<QString,uint> groups = counter.result();
+    QMap<QString,uint> groups = counters.front().result();
     for( QMap<QString,uint>::iterator it= groups.begin(); it != groups.end(); ++it ) {
         map[it.key()] = it.value();
     }
@@ -112,6 +272,106 @@ QMap<QString,uint> XMLDB::Database::classify( const DB::ImageSearchInfo& info, c
     return map;
 }
 
+/**
+ * Counts a snapshot of the images of the database, a slice at a time.
+ */
+class XMLDB::Database::Classifier : public DB::CategoryClassifier
+{
+public:
+    Classifier( const Database* db, const DB::ImageSearchInfo& info, const QStringList& categories )
+        : m_db( db )
+        , m_info( info )
+        , m_images( db->columns() )
+        , m_next( 0 )
+    {
+        m_queries.reserve( categories.size() );
+        for ( const QString& category : categories )
+            m_queries.emplace_back( info, category );
+        m_counters = newCounters();
+
+        m_concurrent = m_info.prepareConcurrentMatching();
+        for ( const CategoryQuery& query : m_queries )
+            m_concurrent = query.noMatchInfo.prepareConcurrentMatching() && m_concurrent;
+    }
+
+    bool countNext( int count ) override
+    {
+        // One pass over the database for all categories and media types, instead of one per category and media type.
+        const int end = qMin( m_images.size(), m_next + count );
+        const QVector<QPair<int, int>> ranges = m_db->imageRanges( m_next, end, m_concurrent );
+        if ( ranges.size() == 1 ) {
+            countRange( m_counters, m_next, end );
+        } else {
+            // The counters of the ranges are created here, as creating a GroupCounter needs the member map.
+            std::vector<std::vector<CategoryCounter>> rangeCounters( ranges.size(), newCounters() );
+            m_db->forEachRange( ranges, [&]( int index, int rangeBegin, int rangeEnd ) {
+                countRange( rangeCounters[index], rangeBegin, rangeEnd );
+            });
+            for ( const std::vector<CategoryCounter>& counters : rangeCounters ) {
+                for ( size_t i = 0; i < m_counters.size(); ++i )
+                    m_counters[i].merge( counters[i] );
+            }
+        }
+        m_next = end;
+        return isFinished();
+    }
+
+    bool isFinished() const override
+    {
+        return m_next >= m_images.size();
+    }
+
+    QMap<QString, DB::CategoryClassification> result() const override
+    {
+        QMap<QString, DB::CategoryClassification> result;
+        for ( const CategoryCounter& counter : m_counters )
+            result.insert( counter.query->category, counter.current() );
+        return result;
+    }
+
+private:
+    std::vector<CategoryCounter> newCounters() const
+    {
+        std::vector<CategoryCounter> counters;
+        counters.reserve( m_queries.size() );
+        for ( const CategoryQuery& query : m_queries )
+            counters.emplace_back( query );
+        return counters;
+    }
+
+    void countRange( std::vector<CategoryCounter>& counters, int begin, int end ) const
+    {
+        for ( int row = begin; row < end; ++row ) {
+            if ( !m_db->matches( m_info, m_images, row, true ) )
+                continue;
+            for ( CategoryCounter& counter : counters )
+                counter.count( m_images.info( row ), m_images.mediaType( row ) );
+        }
+    }
+
+    const Database* m_db;
+    DB::ImageSearchInfo m_info;
+    // implicitly shared, so this is only copied if the database changes meanwhile:
+    const Columns m_images;
+    int m_next;
+    bool m_concurrent;
+    // not changed after construction, as the counters point to the queries:
+    std::vector<CategoryQuery> m_queries;
+    std::vector<CategoryCounter> m_counters;
+};
+
+QMap<QString, DB::CategoryClassification> XMLDB::Database::classifyCategories( const DB::ImageSearchInfo& info, const QStringList& categories )
+{
+    Classifier classifier( this, info, categories );
+    classifier.countNext( m_images.size() );
+    return classifier.result();
+}
+
+std::unique_ptr<DB::CategoryClassifier> XMLDB::Database::createClassifier( const DB::ImageSearchInfo& info, const QStringList& categories )
+{
+    return std::unique_ptr<DB::CategoryClassifier>( new Classifier( this, info, categories ) );
+}
+
 void XMLDB::Database::renameCategory( const QString& oldName, const QString newName )
 {
     for( DB::ImageInfoListIterator it = m_images.begin(); it != m_images.end(); ++it ) {
@@ -124,6 +384,7 @@ void XMLDB::Database::addToBlockList(const DB::FileNameList& list)
     Q_FOREACH(const DB::FileName& fileName, list) {
         m_blockList.insert(fileName);
     }
+    m_journal.blockListChanged();
     deleteList( list );
 }
 
@@ -131,29 +392,23 @@ void XMLDB::Database::deleteList(const DB::FileNameList& list)
 {
     Q_FOREACH(const DB::FileName& fileName, list) {
         DB::ImageInfoPtr inf = fileName.info();
-        StackMap::iterator found = m_stackMap.find(inf->stackId());
-        if ( inf->isStacked() && found != m_stackMap.end() ) {
-            const DB::FileNameList origCache = found.value();
-            DB::FileNameList newCache;
-            Q_FOREACH(const DB::FileName& cacheName, origCache) {
-                if (fileName != cacheName)
-                    newCache.append(cacheName);
-            }
-            if (newCache.size() <= 1) {
+        if ( inf->isStacked() ) {
+            m_stacks.remove( fileName );
+            const DB::FileNameList rest = m_stacks.members( inf->stackId() );
+            if (rest.size() == 1) {
                 // we're destroying a stack
-                Q_FOREACH(const DB::FileName& cacheName, newCache) {
-                    DB::ImageInfoPtr cacheInf = cacheName.info();
-                    cacheInf->setStackId(0);
-                    cacheInf->setStackOrder(0);
-                }
-                m_stackMap.remove( inf->stackId() );
-            } else {
-                m_stackMap.insert(inf->stackId(), newCache);
+                m_stacks.remove( rest.first() );
+                DB::ImageInfoPtr restInf = rest.first().info();
+                restInf->setStackId(0);
+                restInf->setStackOrder(0);
             }
         }
-        m_imageCache.remove( inf->fileName().absolute() );
+        m_journal.imageDeleted( inf.data() );
+        inf->setObserver( nullptr, -1 );
+        m_imageCache.remove( inf->fileName() );
         m_images.remove( inf );
     }
+    m_columnStore.invalidate();
     Exif::Database::instance()->remove( list );
     emit totalChanged( m_images.count() );
     emit imagesDeleted(list);
@@ -200,10 +455,16 @@ void XMLDB::Database::forceUpdate( const DB::ImageInfoList& images )
 {
     // FIXME: merge stack information
     DB::ImageInfoList newImages = images.sort();
+    m_columnStore.invalidate();
+    Q_FOREACH( const DB::ImageInfoPtr& imageInfo, newImages ) {
+        m_stacks.insert( imageInfo );
+        imageInfo->setObserver( this, -1 );
+    }
+    bool appended = true;
     if ( m_images.count() == 0 ) {
         // case 1: The existing imagelist is empty.
         Q_FOREACH( const DB::ImageInfoPtr& imageInfo, newImages )
-            m_imageCache.insert( imageInfo->fileName().absolute(), imageInfo );
+            m_imageCache.insert( imageInfo->fileName(), imageInfo );
         m_images = newImages;
     }
     else if ( newImages.count() == 0 ) {
@@ -213,21 +474,23 @@ void XMLDB::Database::forceUpdate( const DB::ImageInfoList& images )
     else if ( newImages.first()->date().start() > m_images.last()->date().start() ) {
         // case 2: The new list is later than the existsing
         Q_FOREACH( const DB::ImageInfoPtr& imageInfo, newImages )
-            m_imageCache.insert( imageInfo->fileName().absolute(), imageInfo );
+            m_imageCache.insert( imageInfo->fileName(), imageInfo );
         m_images.appendList(newImages);
     }
     else if ( m_images.isSorted() ) {
         // case 3: The lists overlaps, and the existsing list is sorted
         Q_FOREACH( const DB::ImageInfoPtr& imageInfo, newImages )
-            m_imageCache.insert( imageInfo->fileName().absolute(), imageInfo );
+            m_imageCache.insert( imageInfo->fileName(), imageInfo );
         m_images.mergeIn( newImages );
+        appended = false;
     }
     else{
         // case 4: The lists overlaps, and the existsing list is not sorted in the overlapping range.
         Q_FOREACH( const DB::ImageInfoPtr& imageInfo, newImages )
-            m_imageCache.insert( imageInfo->fileName().absolute(), imageInfo );
+            m_imageCache.insert( imageInfo->fileName(), imageInfo );
         m_images.appendList( newImages );
     }
+    m_journal.imagesAdded( newImages, appended );
 }
 
 void XMLDB::Database::addImages( const DB::ImageInfoList& images,
@@ -236,7 +499,7 @@ void XMLDB::Database::addImages( const DB::ImageInfoList& images,
     Q_FOREACH( const DB::ImageInfoPtr& info, images ) {
         info->addCategoryInfo( i18n( "Media Type" ),
                                info->mediaType() == DB::Image ? i18n( "Image" ) : i18n( "Video" ) );
-        m_delayedCache.insert( info->fileName().absolute(), info );
+        m_delayedCache.insert( info->fileName(), info );
         m_delayedUpdate << info;
     }
     if ( doUpdate ) {
@@ -263,7 +526,12 @@ void XMLDB::Database::commitDelayedImages()
 void XMLDB::Database::renameImage( DB::ImageInfoPtr info, const DB::FileName& newName )
 {
     info->delaySavingChanges(false);
+    const DB::FileName oldName = info->fileName();
+    m_stacks.rename( oldName, newName );
+    m_imageCache.remove( oldName );
     info->setFileName(newName);
+    m_imageCache.insert( newName, info );
+    m_journal.imageRenamed( info.data(), oldName );
 }
 
 DB::ImageInfoPtr XMLDB::Database::info( const DB::FileName& fileName ) const
@@ -271,30 +539,59 @@ DB::ImageInfoPtr XMLDB::Database::info( const DB::FileName& fileName ) const
     if ( fileName.isNull() )
         return DB::ImageInfoPtr();
 
-    const QString name = fileName.absolute();
-
-    if (m_imageCache.contains( name ))
-        return m_imageCache[name];
+    const auto found = m_imageCache.constFind( fileName );
+    if ( found != m_imageCache.constEnd() )
+        return found.value();
 
-    if (m_delayedCache.contains( name ))
-        return m_delayedCache[name];
+    const auto delayed = m_delayedCache.constFind( fileName );
+    if ( delayed != m_delayedCache.constEnd() )
+        return delayed.value();
 
     Q_FOREACH( const DB::ImageInfoPtr& imageInfo, m_images )
-        m_imageCache.insert( imageInfo->fileName().absolute(), imageInfo );
+        m_imageCache.insert( imageInfo->fileName(), imageInfo );
+
+    return m_imageCache.value( fileName );
+}
 
-    if ( m_imageCache.contains( name ) ) {
-        return m_imageCache[ name ];
+/**
+ * Split the images from \p begin to \p end into ranges to be processed by forEachRange.
+ * Unless \p concurrent is \c true and there are enough images, this is a single range.
+ */
+QVector<QPair<int, int>> XMLDB::Database::imageRanges( int begin, int end, bool concurrent ) const
+{
+    int count = 1;
+    if ( concurrent )
+        count = qBound( 1, ( end - begin ) / MIN_IMAGES_PER_RANGE, m_searchPool.maxThreadCount() + 1 );
+
+    QVector<QPair<int, int>> ranges;
+    ranges.reserve( count );
+    for ( int index = 0; index < count; ++index ) {
+        const int rangeBegin = begin + int( qint64( end - begin ) * index / count );
+        const int rangeEnd = begin + int( qint64( end - begin ) * ( index + 1 ) / count );
+        ranges.append( qMakePair( rangeBegin, rangeEnd ) );
     }
+    return ranges;
+}
 
-    return DB::ImageInfoPtr();
+/**
+ * Call \p function for every range, passing the index of the range and its first and past the last image.
+ * The first range is processed on the calling thread, the others on the search thread pool.
+ * This returns once all ranges are done, so the results can be collected by index and merged in order.
+ */
+void XMLDB::Database::forEachRange( const QVector<QPair<int, int>>& ranges, const std::function<void( int index, int begin, int end )>& function ) const
+{
+    for ( int index = 1; index < ranges.size(); ++index )
+        m_searchPool.start( new RangeTask( function, index, ranges[index].first, ranges[index].second ) );
+    function( 0, ranges[0].first, ranges[0].second );
+    m_searchPool.waitForDone();
 }
 
-bool XMLDB::Database::rangeInclude( DB::ImageInfoPtr info ) const
+bool XMLDB::Database::rangeInclude( const DB::ImageDate& date ) const
 {
     if (m_selectionRange.start().isNull() )
         return true;
 
-    DB::ImageDate::MatchType tp = info->date().isIncludedIn( m_selectionRange );
+    DB::ImageDate::MatchType tp = date.isIncludedIn( m_selectionRange );
     if ( m_includeFuzzyCounts )
         return ( tp == DB::ImageDate::ExactMatch || tp == DB::ImageDate::RangeMatch );
     else
@@ -310,8 +607,96 @@ DB::MemberMap& XMLDB::Database::memberMap()
 
 void XMLDB::Database::save( const QString& fileName, bool isAutoSave )
 {
+    // a save still being written in the background must not overwrite this one:
+    waitForSaves();
     FileWriter saver( this );
-    saver.save( fileName, isAutoSave );
+    const bool success = saver.save( fileName, isAutoSave );
+    if ( isAutoSave ) {
+        // The file replaces the journal, which only starts over with the next save of index.xml.
+        m_journal.setBroken( true );
+    } else {
+        m_journal.checkpoint( this );
+        m_journal.setBroken( !success );
+    }
+}
+
+void XMLDB::Database::saveInBackground( const QString& fileName, bool isAutoSave )
+{
+    // The FileWriter copies the database here, on the GUI thread.
+    m_savePool.start( new SaveTask( this, new FileWriter( this ), fileName, isAutoSave ) );
+    if ( isAutoSave ) {
+        // The file replaces the journal, which only starts over with the next save of index.xml.
+        m_journal.setBroken( true );
+    } else {
+        ++m_pendingCheckpoints;
+        m_journal.checkpoint( this );
+    }
+}
+
+bool XMLDB::Database::autoSave()
+{
+    // Until index.xml is written, the journal can't tell what it belongs to.
+    if ( m_pendingCheckpoints > 0 )
+        return false;
+
+    const QString directory = QFileInfo( m_fileName ).absolutePath();
+    if ( m_journal.isBroken() ) {
+        saveInBackground( directory + QString::fromLatin1( "/.#index.xml" ), true );
+        return true;
+    }
+
+    FileWriter* entry = m_journal.createEntry( this );
+    if ( entry )
+        m_savePool.start( new SaveTask( this, entry, Journal::fileName( directory ), true ) );
+    else
+        QMetaObject::invokeMethod( this, "saveWritten", Qt::QueuedConnection,
+                                   Q_ARG( bool, true ), Q_ARG( bool, true ), Q_ARG( QStringList, QStringList() ) );
+    return true;
+}
+
+void XMLDB::Database::discardAutoSave()
+{
+    // an auto save still being written would create the files again:
+    waitForSaves();
+    const QString directory = QFileInfo( m_fileName ).absolutePath();
+    QFile::remove( directory + QString::fromLatin1( "/.#index.xml" ) );
+    QFile::remove( Journal::fileName( directory ) );
+}
+
+void XMLDB::Database::waitForSaves()
+{
+    m_savePool.waitForDone();
+    // deliver the results of the finished saves right away:
+    QCoreApplication::sendPostedEvents( this, QEvent::MetaCall );
+}
+
+void XMLDB::Database::saveWritten( bool isAutoSave, bool success, const QStringList& errors )
+{
+    if ( !isAutoSave )
+        --m_pendingCheckpoints;
+    if ( !success )
+        m_journal.setBroken( true );
+    else if ( !isAutoSave )
+        m_journal.setBroken( false );
+
+    FileWriter::showErrors( errors );
+    emit saveFinished( isAutoSave, success );
+}
+
+
+void XMLDB::Database::memberGroupsChanged()
+{
+    m_journal.memberGroupsChanged();
+}
+
+void XMLDB::Database::imageInfoChanged( int row, const DB::ImageInfo* info )
+{
+    m_columnStore.imageInfoChanged( row, info );
+
+    // A copy of an image also carries the observer of the original.
+    const auto found = m_imageCache.constFind( info->fileName() );
+    if ( found != m_imageCache.constEnd() && found.value().data() == info )
+        m_journal.imageChanged( found.value().data() );
 }
 
 
@@ -342,26 +727,142 @@ DB::FileNameList XMLDB::Database::searchPrivate(
         const DB::ImageSearchInfo& info,
         bool requireOnDisk,
         bool onlyItemsMatchingRange) const
+{
+    const Columns& images = columns();
+    DB::FileNameList result;
+    for ( int row : matchingRows( info, requireOnDisk, onlyItemsMatchingRange ) )
+        result.append( images.info( row )->fileName() );
+    return result;
+}
+
+/**
+ * @return the rows of the images matching \p info, in the order of the images.
+ */
+QVector<int> XMLDB::Database::matchingRows(
+        const DB::ImageSearchInfo& info,
+        bool requireOnDisk,
+        bool onlyItemsMatchingRange) const
 {
     // When searching for images counts for the datebar, we want matches outside the range too.
     // When searching for images for the thumbnail view, we only want matches inside the range.
-    DB::FileNameList result;
-    for( DB::ImageInfoListConstIterator it = m_images.constBegin(); it != m_images.constEnd(); ++it ) {
-        bool match = !(*it)->isLocked() && info.match( *it ) && ( !onlyItemsMatchingRange || rangeInclude( *it ));
-        match &= !requireOnDisk || DB::ImageInfo::imageOnDisk( (*it)->fileName() );
+    QElapsedTimer timer;
+    timer.start();
+    const Columns& images = columns();
+    const QVector<QPair<int, int>> ranges = imageRanges( 0, images.size(), info.prepareConcurrentMatching() );
+    std::vector<QVector<int>> results( ranges.size() );
+    forEachRange( ranges, [&]( int index, int begin, int end ) {
+        QVector<int>& result = results[index];
+        for ( int row = begin; row < end; ++row ) {
+            bool match = matches( info, images, row, onlyItemsMatchingRange );
+            match &= !requireOnDisk || DB::ImageInfo::imageOnDisk( images.info( row )->fileName() );
+
+            if (match)
+                result.append( row );
+        }
+    });
+
+    // the ranges are in the order of the images:
+    QVector<int> result = results.front();
+    for ( size_t index = 1; index < results.size(); ++index )
+        result += results[index];
+    qCDebug(TimingLog) << "XMLDB::Database::matchingRows(): Searching" << images.size() << "images in" << ranges.size()
+                       << "ranges found" << result.size() << "matches in" << timer.elapsed() << "ms";
+    return result;
+}
 
-        if (match)
-            result.append((*it)->fileName());
+bool XMLDB::Database::matches( const DB::ImageSearchInfo& info, const Columns& images, int row, bool onlyItemsMatchingRange ) const
+{
+    // The checks on the columns come first, as they are much cheaper than the search itself.
+    return !images.isLocked( row ) && ( !onlyItemsMatchingRange || rangeInclude( images.date( row ) ) ) && info.match( images.info( row ) );
+}
+
+const XMLDB::Columns& XMLDB::Database::columns() const
+{
+    return m_columnStore.columns( m_images );
+}
+
+DB::MediaCount XMLDB::Database::count( const DB::ImageSearchInfo& info )
+{
+    // Count directly while matching, rather than building a FileNameList and looking up every info again:
+    QElapsedTimer timer;
+    timer.start();
+    const Columns& rows = columns();
+    const QVector<QPair<int, int>> ranges = imageRanges( 0, rows.size(), info.prepareConcurrentMatching() );
+    std::vector<DB::MediaCount> counts( ranges.size() );
+    forEachRange( ranges, [&]( int index, int begin, int end ) {
+        int images = 0;
+        int videos = 0;
+        for ( int row = begin; row < end; ++row ) {
+            if ( !matches( info, rows, row, true ) )
+                continue;
+            if ( rows.mediaType( row ) == DB::Image )
+                ++images;
+            else
+                ++videos;
+        }
+        counts[index] = DB::MediaCount( images, videos );
+    });
+
+    int images = 0;
+    int videos = 0;
+    for ( const DB::MediaCount& count : counts ) {
+        images += count.images();
+        videos += count.videos();
+    }
+    qCDebug(TimingLog) << "XMLDB::Database::count(): Counting" << rows.size() << "images in" << ranges.size()
+                       << "ranges took" << timer.elapsed() << "ms";
+    return DB::MediaCount( images, videos );
+}
+
+DB::FileNameList XMLDB::Database::searchStackTops( const DB::ImageSearchInfo& info, DB::MediaType typemask, int* position, int maxCount )
+{
+    // Media type and stack order are checked on the columns, before the search itself.
+    // position is the row to continue at, so only the rows of the page asked for are looked at.
+    const Columns& images = columns();
+    DB::FileNameList result;
+    int row = *position;
+    for ( ; row < images.size() && result.size() < maxCount; ++row ) {
+        if ( images.stackOrder( row ) > 1 || !( images.mediaType( row ) & typemask ) )
+            continue;
+        if ( matches( info, images, row, true ) )
+            result.append( images.info( row )->fileName() );
     }
+    *position = ( row < images.size() ) ? row : -1;
     return result;
 }
 
+bool XMLDB::Database::hasMatches( const DB::ImageSearchInfo& info )
+{
+    const Columns& images = columns();
+    for ( int row = 0; row < images.size(); ++row ) {
+        if ( matches( info, images, row, true ) )
+            return true;
+    }
+    return false;
+}
+
 void XMLDB::Database::sortAndMergeBackIn(const DB::FileNameList& fileNameList)
 {
+    if ( fileNameList.isEmpty() )
+        return;
+
+    const QList<int> rows = rowsOf( fileNameList );
+    const int firstRow = columnStoreRow( info( fileNameList.first() ) );
+    Q_ASSERT( firstRow >= 0 );
+    if ( rows.size() != fileNameList.size() )
+        qCWarning(XMLDBLog) << "Sorting images back in:" << fileNameList.size() - rows.size()
+                            << "of" << fileNameList.size() << "images are not in the database or given twice";
+    if ( rows.isEmpty() )
+        return;
+
+    // the images to sort, without the ones that are not in the database:
     DB::ImageInfoList infoList;
-    Q_FOREACH( const DB::FileName &fileName, fileNameList )
-        infoList.append(fileName.info());
-    m_images.sortAndMergeBackIn(infoList);
+    for ( int row : rows )
+        infoList.append( m_images.at( row ) );
+
+    // The sorted images go where the first of the given images was.
+    const int insertAt = ( firstRow >= 0 ) ? firstRow : rows.first();
+    moveImages( rows, infoList.sort(), qMin( insertAt, m_images.size() - rows.size() ) );
 }
 
 DB::CategoryCollection* XMLDB::Database::categoryCollection()
@@ -371,8 +872,11 @@ DB::CategoryCollection* XMLDB::Database::categoryCollection()
 
 QExplicitlySharedDataPointer<DB::ImageDateCollection> XMLDB::Database::rangeCollection()
 {
-    return QExplicitlySharedDataPointer<DB::ImageDateCollection>(
-                new XMLImageDateCollection( searchPrivate( Browser::BrowserWidget::instance()->currentContext(), false, false)));
+    const Columns& images = columns();
+    QList<DB::ImageDate> dates;
+    for ( int row : matchingRows( Browser::BrowserWidget::instance()->currentContext(), false, false ) )
+        dates.append( images.date( row ) );
+    return QExplicitlySharedDataPointer<DB::ImageDateCollection>( new XMLImageDateCollection( dates ) );
 }
 
 void XMLDB::Database::reorder(
@@ -381,75 +885,101 @@ void XMLDB::Database::reorder(
         bool after)
 {
     Q_ASSERT(!item.isNull());
-    DB::ImageInfoList list = takeImagesFromSelection(selection);
-    insertList(item, list, after );
+    const int anchorRow = columnStoreRow( info( item ) );
+    const QList<int> rows = rowsOf( selection );
+    if ( anchorRow < 0 || rows.isEmpty() || std::binary_search( rows.begin(), rows.end(), anchorRow ) )
+        return;
+
+    // The selected images keep the order in which they appear in the image list.
+    DB::ImageInfoList list;
+    for ( int row : rows )
+        list.append( m_images.at( row ) );
+
+    // insertion point counted in the image list without the selected images:
+    const int insertAt = ( after ? anchorRow + 1 : anchorRow )
+            - int( std::lower_bound( rows.begin(), rows.end(), anchorRow ) - rows.begin() );
+    moveImages( rows, list, insertAt );
+    emit dirty();
 }
 
-// Remove all the images from the database that match the given selection and
-// return that sublist.
-// This returns the selected and erased images in the order in which they appear
-// in the image list itself.
-DB::ImageInfoList XMLDB::Database::takeImagesFromSelection(const DB::FileNameList& selection)
+int XMLDB::Database::columnStoreRow( const DB::ImageInfoPtr& info ) const
 {
-    DB::ImageInfoList result;
-    if (selection.isEmpty())
-        return result;
+    if ( !info )
+        return -1;
+    // building the columns also tells every image its row:
+    columns();
+    return m_columnStore.rowOf( info.data() );
+}
 
-    // iterate over all images (expensive!!) TODO: improve?
-    for( DB::ImageInfoListIterator it = m_images.begin(); it != m_images.end(); /**/ ) {
-        const DB::FileName imagefile = (*it)->fileName();
-        DB::FileNameList::const_iterator si = selection.begin();
-        // for each image, iterate over selection, break on match
-        for ( /**/; si != selection.end(); ++si ) {
-            const DB::FileName file = *si;
-            if ( imagefile == file ) {
-                break;
-            }
-        }
-        // if image is not in selection, simply advance to next, if not add to result and erase
-        if (si == selection.end()) {
-            ++it;
-        } else {
-            result << *it;
-            m_imageCache.remove( (*it)->fileName().absolute() );
-            it = m_images.erase(it);
-        }
-        // if all images from selection are in result (size of lists is equal) break.
-        if (result.size() == selection.size())
-            break;
+// Return the rows of the given images in the image list, sorted and without
+// duplicates. Images not in the database are left out.
+QList<int> XMLDB::Database::rowsOf( const DB::FileNameList& fileNames ) const
+{
+    QList<int> rows;
+    rows.reserve( fileNames.size() );
+    Q_FOREACH( const DB::FileName& fileName, fileNames ) {
+        const int row = columnStoreRow( info( fileName ) );
+        if ( row >= 0 )
+            rows.append( row );
     }
-
-    return result;
+    std::sort( rows.begin(), rows.end() );
+    rows.erase( std::unique( rows.begin(), rows.end() ), rows.end() );
+    return rows;
 }
 
-void XMLDB::Database::insertList(
-        const DB::FileName& fileName,
-        const DB::ImageInfoList& list,
-        bool after)
+// Take the images in the sorted \p rows out of the image list, and put \p list
+// in at \p insertAt, which counts the images that are left.
+// Only the span between the first affected row and the last one is rewritten,
+// and the columns of that span are updated instead of being built again.
+void XMLDB::Database::moveImages( const QList<int>& rows, const DB::ImageInfoList& list, int insertAt )
 {
-    DB::ImageInfoListIterator imageIt = m_images.begin();
-    for( ; imageIt != m_images.end(); ++imageIt ) {
-        if ( (*imageIt)->fileName() == fileName ) {
+    Q_ASSERT( rows.size() == list.size() );
+
+    // the insertion point in the image list as it is now:
+    int insertRow = insertAt;
+    for ( int row : rows ) {
+        if ( row >= insertRow )
             break;
-        }
+        ++insertRow;
     }
-    // since insert() inserts before iterator increment when inserting AFTER image
-    if ( after )
-        imageIt++;
-    for( DB::ImageInfoListConstIterator it = list.begin(); it != list.end(); ++it ) {
-        // the call to insert() destroys the given iterator so use the new one after the call
-        imageIt = m_images.insert( imageIt, *it );
-        m_imageCache.insert( (*it)->fileName().absolute(), *it );
-        // increment always to retain order of selected images
-        imageIt++;
+
+    const int first = qMin( rows.first(), insertRow );
+    const int last = qMax( rows.last() + 1, insertRow );
+
+    DB::ImageInfoList span;
+    span.reserve( last - first );
+    QList<int>::const_iterator selected = std::lower_bound( rows.begin(), rows.end(), first );
+    for ( int row = first; row < last; ++row ) {
+        if ( row == insertRow )
+            span.append( list );
+        if ( selected != rows.end() && *selected == row )
+            ++selected;
+        else
+            span.append( m_images.at( row ) );
     }
-    emit dirty();
+    if ( insertRow == last )
+        span.append( list );
+
+    Q_ASSERT( span.size() == last - first );
+    for ( int i = 0; i < span.size(); ++i )
+        m_images[first + i] = span.at( i );
+    m_columnStore.rowsMoved( m_images, first, last );
+    m_journal.orderChanged();
 }
 
 
 bool XMLDB::Database::stack(const DB::FileNameList& items)
 {
-    unsigned int changed = 0;
+    const int changed = stackImages( items );
+    if ( changed )
+        emit dirty();
+
+    return changed;
+}
+
+int XMLDB::Database::stackImages(const DB::FileNameList& items)
+{
+    int changed = 0;
     QSet<DB::StackID> stacks;
     QList<DB::ImageInfoPtr> images;
     unsigned int stackOrder = 1;
@@ -466,24 +996,43 @@ bool XMLDB::Database::stack(const DB::FileNameList& items)
     }
 
     if ( stacks.size() > 1 )
-        return false; // images already in different stacks -> can't stack
+        return 0; // images already in different stacks -> can't stack
 
     DB::StackID stackId = ( stacks.size() == 1 ) ? *(stacks.begin() ) : m_nextStackId++;
     Q_FOREACH( DB::ImageInfoPtr info, images ) {
         info->setStackOrder( stackOrder );
         info->setStackId( stackId );
-        m_stackMap[stackId].append(info->fileName());
+        m_stacks.insert( info );
         ++changed;
         ++stackOrder;
     }
 
+    return changed;
+}
+
+void XMLDB::Database::unstack(const DB::FileNameList& items)
+{
+    unstackImages( items );
+    if (!items.isEmpty())
+        emit dirty();
+}
+
+int XMLDB::Database::stackAll(const QList<DB::FileNameList>& groups, bool unstackFirst)
+{
+    int changed = 0;
+    Q_FOREACH( const DB::FileNameList& group, groups ) {
+        if ( unstackFirst )
+            unstackImages( group );
+        changed += stackImages( group );
+    }
+
     if ( changed )
         emit dirty();
 
     return changed;
 }
 
-void XMLDB::Database::unstack(const DB::FileNameList& items)
+void XMLDB::Database::unstackImages(const DB::FileNameList& items)
 {
     Q_FOREACH(const DB::FileName& fileName, items) {
         DB::FileNameList allInStack = getStackFor(fileName);
@@ -493,7 +1042,7 @@ void XMLDB::Database::unstack(const DB::FileNameList& items)
                 DB::ImageInfoPtr imgInfo = stackFileName.info();
                 Q_ASSERT( imgInfo );
                 if ( imgInfo->isStacked() ) {
-                    m_stackMap.remove( imgInfo->stackId() );
+                    m_stacks.remove( stackFileName );
                     imgInfo->setStackId( 0 );
                     imgInfo->setStackOrder( 0 );
                 }
@@ -502,42 +1051,25 @@ void XMLDB::Database::unstack(const DB::FileNameList& items)
             DB::ImageInfoPtr imgInfo = fileName.info();
             Q_ASSERT( imgInfo );
             if ( imgInfo->isStacked() ) {
-                m_stackMap[imgInfo->stackId()].removeAll(fileName);
+                m_stacks.remove( fileName );
                 imgInfo->setStackId( 0 );
                 imgInfo->setStackOrder( 0 );
             }
         }
     }
-
-    if (!items.isEmpty())
-        emit dirty();
 }
 
 DB::FileNameList XMLDB::Database::getStackFor(const DB::FileName& referenceImg) const
 {
-    DB::ImageInfoPtr imageInfo = info( referenceImg );
-
-    if ( !imageInfo || ! imageInfo->isStacked() )
+    const DB::StackID stackId = m_stacks.stackOf( referenceImg );
+    if ( stackId == 0 )
         return DB::FileNameList();
+    return m_stacks.members( stackId );
+}
 
-    StackMap::iterator found = m_stackMap.find(imageInfo->stackId());
-    if ( found != m_stackMap.end() )
-        return found.value();
-
-    // it wasn't in the cache -> rebuild it
-    m_stackMap.clear();
-    for( DB::ImageInfoListConstIterator it = m_images.constBegin(); it != m_images.constEnd(); ++it ) {
-        if ( (*it)->isStacked() ) {
-            DB::StackID stackid = (*it)->stackId();
-            m_stackMap[stackid].append((*it)->fileName());
-        }
-    }
-
-    found = m_stackMap.find(imageInfo->stackId());
-    if ( found != m_stackMap.end() )
-        return found.value();
-    else
-        return DB::FileNameList();
+DB::StackID XMLDB::Database::getStackId(const DB::FileName& fileName) const
+{
+    return m_stacks.stackOf( fileName );
 }
 
 void XMLDB::Database::copyData(const DB::FileName &from, const DB::FileName &to)
@@ -592,6 +1124,7 @@ DB::ImageInfoPtr XMLDB::Database::createImageInfo( const DB::FileName& fileName,
     static QString _gpsLat_ = QString::fromUtf8("gpsLat");
     static QString _gpsAlt_ = QString::fromUtf8("gpsAlt");
     static QString _videoLength_ = QString::fromUtf8("videoLength");
+    static QString _perceptualHash_ = QString::fromUtf8("perceptualHash");
     static QString _options_ = QString::fromUtf8("options");
     static QString _0_ = QString::fromUtf8("0");
     static QString _minus1_ = QString::fromUtf8("-1");
@@ -659,6 +1192,9 @@ DB::ImageInfoPtr XMLDB::Database::createImageInfo( const DB::FileName& fileName,
     if ( reader->hasAttribute(_videoLength_))
         info->setVideoLength(reader->attribute(_videoLength_).toInt());
 
+    if ( reader->hasAttribute(_perceptualHash_) )
+        info->setPerceptualHash(reader->attribute(_perceptualHash_).toULongLong(nullptr, 16));
+
     DB::ImageInfoPtr result(info);
 
     possibleLoadCompressedCategories( reader, result, db, newToOldCategory );
@@ -21,6 +21,7 @@
 
 #include "DB/ImageSearchInfo.h"
 #include "DB/ImageInfoList.h"
+#include "DB/ImageInfoObserver.h"
 #include <qstringlist.h>
 #include "DB/MemberMap.h"
 #include "DB/ImageDB.h"
@@ -31,6 +32,15 @@
 #include <qdom.h>
 #include <DB/FileNameList.h>
 #include "FileReader.h"
+#include "ColumnStore.h"
+#include "Journal.h"
+#include "StackIndex.h"
+
+#include <QPair>
+#include <QThreadPool>
+#include <QVector>
+
+#include <functional>
 
 namespace DB
 {
@@ -38,7 +48,7 @@ namespace DB
 }
 
 namespace XMLDB {
-    class Database :public DB::ImageDB
+    class Database :public DB::ImageDB, public DB::ImageInfoObserver
     {
         Q_OBJECT
 
@@ -47,9 +57,14 @@ namespace XMLDB {
         DB::FileNameList search(
             const DB::ImageSearchInfo&,
             bool requireOnDisk=false) const override;
+        DB::MediaCount count( const DB::ImageSearchInfo& info ) override;
+        bool hasMatches( const DB::ImageSearchInfo& info ) override;
+        DB::FileNameList searchStackTops( const DB::ImageSearchInfo& info, DB::MediaType typemask, int* position, int maxCount ) override;
         void renameCategory( const QString& oldName, const QString newName ) override;
 
         QMap<QString,uint> classify( const DB::ImageSearchInfo& info, const QString &category, DB::MediaType typemask ) override;
+        QMap<QString, DB::CategoryClassification> classifyCategories( const DB::ImageSearchInfo& info, const QStringList& categories ) override;
+        std::unique_ptr<DB::CategoryClassifier> createClassifier( const DB::ImageSearchInfo& info, const QStringList& categories ) override;
         DB::FileNameList images() override;
         void addImages( const DB::ImageInfoList& images, bool doUpdate ) override;
         void commitDelayedImages() override;
@@ -62,6 +77,10 @@ namespace XMLDB {
         DB::ImageInfoPtr info( const DB::FileName& fileName ) const override;
         DB::MemberMap& memberMap() override;
         void save( const QString& fileName, bool isAutoSave ) override;
+        void saveInBackground( const QString& fileName, bool isAutoSave ) override;
+        void waitForSaves() override;
+        bool autoSave() override;
+        void discardAutoSave() override;
         DB::MD5Map* md5Map() override;
         void sortAndMergeBackIn(const DB::FileNameList& idList) override;
         DB::CategoryCollection* categoryCollection() override;
@@ -75,7 +94,9 @@ namespace XMLDB {
         static void possibleLoadCompressedCategories( ReaderPtr reader , DB::ImageInfoPtr info, Database* db, const QMap<QString,QString> *newToOldCategory = nullptr );
         bool stack(const DB::FileNameList& items) override;
         void unstack(const DB::FileNameList& images) override;
+        int stackAll(const QList<DB::FileNameList>& groups, bool unstackFirst) override;
         DB::FileNameList getStackFor(const DB::FileName& referenceId) const override;
+        DB::StackID getStackId(const DB::FileName& fileName) const override;
         void copyData( const DB::FileName& from, const DB::FileName& to) override;
 
         static int fileVersion();
@@ -84,10 +105,17 @@ namespace XMLDB {
             const DB::ImageSearchInfo&,
             bool requireOnDisk,
             bool onlyItemsMatchingRange) const;
-        bool rangeInclude( DB::ImageInfoPtr info ) const;
+        QVector<int> matchingRows(
+            const DB::ImageSearchInfo&,
+            bool requireOnDisk,
+            bool onlyItemsMatchingRange) const;
+        bool matches( const DB::ImageSearchInfo& info, const Columns& images, int row, bool onlyItemsMatchingRange ) const;
+        bool rangeInclude( const DB::ImageDate& date ) const;
+        const Columns& columns() const;
 
-        DB::ImageInfoList takeImagesFromSelection(const DB::FileNameList& list);
-        void insertList( const DB::FileName& id, const DB::ImageInfoList& list, bool after );
+        int columnStoreRow( const DB::ImageInfoPtr& info ) const;
+        QList<int> rowsOf( const DB::FileNameList& fileNames ) const;
+        void moveImages( const QList<int>& rows, const DB::ImageInfoList& list, int insertAt );
         static void readOptions( DB::ImageInfoPtr info, ReaderPtr reader, const QMap<QString,QString> *newToOldCategory = nullptr );
 
 
@@ -96,16 +124,31 @@ namespace XMLDB {
         void deleteItem( DB::Category* category, const QString& option );
         void lockDB( bool lock, bool exclude ) override;
 
+    private slots:
+        void saveWritten( bool isAutoSave, bool success, const QStringList& errors );
+        void memberGroupsChanged();
+
     private:
         friend class DB::ImageDB;
         friend class FileReader;
         friend class FileWriter;
+        friend class Journal;
+        class Classifier;
 
         Database( const QString& configFile );
+        ~Database() override;
         void forceUpdate( const DB::ImageInfoList& );
+        // passes the changes of the images on to the column store and the journal:
+        void imageInfoChanged( int row, const DB::ImageInfo* info ) override;
+        int stackImages( const DB::FileNameList& items );
+        void unstackImages( const DB::FileNameList& items );
+        QVector<QPair<int, int>> imageRanges( int begin, int end, bool concurrent ) const;
+        void forEachRange( const QVector<QPair<int, int>>& ranges, const std::function<void( int index, int begin, int end )>& function ) const;
 
         QString m_fileName;
         DB::ImageInfoList m_images;
+        // the fields of m_images that scans need:
+        mutable ColumnStore m_columnStore;
         QSet<DB::FileName> m_blockList;
         DB::ImageInfoList m_missingTimes;
         XMLCategoryCollection m_categoryCollection;
@@ -114,11 +157,17 @@ namespace XMLDB {
         //QMap<QString, QString> m_settings;
 
         DB::StackID m_nextStackId;
-        typedef QMap<DB::StackID, DB::FileNameList> StackMap;
-        mutable  StackMap m_stackMap;
+        StackIndex m_stacks;
         DB::ImageInfoList m_delayedUpdate;
-	mutable QHash<const QString, DB::ImageInfoPtr> m_imageCache;
-	mutable QHash<const QString, DB::ImageInfoPtr> m_delayedCache;
+	mutable QHash<DB::FileName, DB::ImageInfoPtr> m_imageCache;
+	mutable QHash<DB::FileName, DB::ImageInfoPtr> m_delayedCache;
+        // runs searches and classification on several threads:
+        mutable QThreadPool m_searchPool;
+        // writes the saves from saveInBackground, one at a time:
+        QThreadPool m_savePool;
+        Journal m_journal;
+        // saves of index.xml not written yet; the journal must wait for them:
+        int m_pendingCheckpoints;
 
         // used for checking if any images are without image attribute from the database.
         static bool s_anyImageWithEmptySize;
@@ -20,6 +20,7 @@
 #include "CompressFileInfo.h"
 #include "Database.h"
 #include "FileReader.h"
+#include "Journal.h"
 #include "Logging.h"
 #include "XMLCategory.h"
 
@@ -34,9 +35,11 @@
 
 // Qt includes
 #include <QFile>
+#include <QFileInfo>
 #include <QHash>
 #include <QLocale>
 #include <QRegExp>
+#include <QSet>
 #include <QTextCodec>
 #include <QTextStream>
 
@@ -74,6 +77,7 @@ void XMLDB::FileReader::read( const QString& configFile )
     loadBlockList( reader );
     loadMemberGroups( reader );
     //loadSettings(reader);
+    replayJournal( configFile );
 
     m_db->m_members.setLoading( false );
 
@@ -340,6 +344,246 @@ void XMLDB::FileReader::loadMemberGroups( ReaderPtr reader )
     }
 }
 
+void XMLDB::FileReader::replayJournal( const QString& configFile )
+{
+    static QString journalString = QString::fromUtf8("journal");
+    static QString baseString = QString::fromUtf8("base");
+    static QString indexString = QString::fromUtf8("index");
+    static QString entryString = QString::fromUtf8("entry");
+    static QString endOfEntry = QString::fromUtf8("</entry>");
+
+    QFile file( Journal::fileName( QFileInfo( configFile ).absolutePath() ) );
+    if ( !file.exists() )
+        return;
+
+    QByteArray data;
+    if ( file.open( QIODevice::ReadOnly ) )
+        data = file.readAll();
+    file.close();
+
+    // An entry cut short by a crash is left out; the ones before it were on disk before it was started.
+    const int end = data.lastIndexOf( endOfEntry.toUtf8() );
+    if ( end == -1 ) {
+        qCWarning(XMLDBLog) << "Removing journal without any complete entry:" << file.fileName();
+        file.remove();
+        return;
+    }
+    data.truncate( end + endOfEntry.size() );
+
+    ReaderPtr reader = ReaderPtr(new XmlReader);
+    reader->addData( QByteArray( "<journal>" ) + data + QByteArray( "</journal>" ) );
+    reader->readNextStartOrStopElement(journalString);
+
+    QString base;
+    ElementInfo info = reader->peekNext();
+    if ( info.isStartToken && info.tokenName == baseString ) {
+        reader->readNextStartOrStopElement(baseString);
+        base = reader->attribute(indexString);
+        reader->readEndElement();
+    }
+    if ( base != Journal::baseIdentity( configFile ) ) {
+        qCWarning(XMLDBLog) << "Removing journal" << file.fileName() << "as it was not written for the current" << configFile;
+        file.remove();
+        return;
+    }
+
+    const int ret = KMessageBox::questionYesNo( messageParent(),
+                                                i18n("<p>KPhotoAlbum was not shut down properly, and there are changes that were not saved to '%1'.</p>"
+                                                     "<p>Do you want to recover these changes?</p>", configFile ),
+                                                i18n("Recover Unsaved Changes?") );
+    if ( ret != KMessageBox::Yes ) {
+        file.remove();
+        return;
+    }
+
+    // The entries are written in the readable format, whatever index.xml uses.
+    const bool compressed = useCompressedFileFormat();
+    setUseCompressedFileFormat( false );
+
+    QHash<DB::FileName, int> rows;
+    for ( int row = 0; row < m_db->m_images.size(); ++row )
+        rows.insert( m_db->m_images.at( row )->fileName(), row );
+
+    while ( reader->readNextStartOrStopElement(entryString).isStartToken ) {
+        replayEntry( reader, rows );
+        ++m_replayedJournalEntries;
+    }
+
+    // deleted images leave an empty slot behind:
+    DB::ImageInfoList images;
+    for ( const DB::ImageInfoPtr& imageInfo : m_db->m_images ) {
+        if ( imageInfo )
+            images.append( imageInfo );
+    }
+    m_db->m_images = images;
+
+    setUseCompressedFileFormat( compressed );
+    qCDebug(XMLDBLog) << "Replayed" << m_replayedJournalEntries << "entries of" << file.fileName();
+    MainWindow::DirtyIndicator::markDirty();
+}
+
+void XMLDB::FileReader::replayEntry( ReaderPtr reader, QHash<DB::FileName, int>& rows )
+{
+    static QString fileString = QString::fromUtf8("file");
+    static QString toString = QString::fromUtf8("to");
+    static QString categoriesString = QString::fromUtf8("Categories");
+    static QString renameString = QString::fromUtf8("rename");
+    static QString deleteString = QString::fromUtf8("delete");
+    static QString imagesString = QString::fromUtf8("images");
+    static QString imageString = QString::fromUtf8("image");
+    static QString orderString = QString::fromUtf8("order");
+    static QString blockListString = QString::fromUtf8("blocklist");
+    static QString memberGroupsString = QString::fromUtf8("member-groups");
+
+    for ( ElementInfo info = reader->peekNext(); info.isStartToken; info = reader->peekNext() ) {
+        if ( info.tokenName == categoriesString ) {
+            replayCategories( reader );
+        }
+        else if ( info.tokenName == renameString ) {
+            // Renames happen all at once, as two images may have swapped their names.
+            QList<QPair<DB::FileName, int>> renamed;
+            while ( info.isStartToken && info.tokenName == renameString ) {
+                reader->readNextStartOrStopElement(renameString);
+                const auto it = rows.find( DB::FileName::fromRelativePath( reader->attribute(fileString) ) );
+                if ( it != rows.end() ) {
+                    renamed.append( qMakePair( DB::FileName::fromRelativePath( reader->attribute(toString) ), it.value() ) );
+                    // the image is in the entry under its new name, which adds its sum again:
+                    m_db->m_md5map.removeFile( it.key() );
+                    rows.erase( it );
+                }
+                reader->readEndElement();
+                info = reader->peekNext();
+            }
+            for ( const auto& rename : renamed )
+                rows.insert( rename.first, rename.second );
+        }
+        else if ( info.tokenName == deleteString ) {
+            reader->readNextStartOrStopElement(deleteString);
+            const auto it = rows.find( DB::FileName::fromRelativePath( reader->attribute(fileString) ) );
+            if ( it != rows.end() ) {
+                m_db->m_images[it.value()] = DB::ImageInfoPtr();
+                m_db->m_md5map.removeFile( it.key() );
+                rows.erase( it );
+            }
+            reader->readEndElement();
+        }
+        else if ( info.tokenName == imagesString ) {
+            reader->readNextStartOrStopElement(imagesString);
+            while (reader->readNextStartOrStopElement(imageString).isStartToken) {
+                const DB::FileName fileName = DB::FileName::fromRelativePath( reader->attribute(fileString) );
+                DB::ImageInfoPtr imageInfo = load( fileName, reader, false );
+                const auto it = rows.constFind( fileName );
+                if ( it != rows.constEnd() ) {
+                    m_db->m_images[it.value()] = imageInfo;
+                    // the sum may have changed:
+                    m_db->m_md5map.removeFile( fileName );
+                } else {
+                    rows.insert( fileName, m_db->m_images.size() );
+                    m_db->m_images.append( imageInfo );
+                }
+                m_db->m_md5map.insert( imageInfo->MD5Sum(), fileName );
+            }
+        }
+        else if ( info.tokenName == orderString ) {
+            reader->readNextStartOrStopElement(orderString);
+            DB::ImageInfoList images;
+            while (reader->readNextStartOrStopElement(imageString).isStartToken) {
+                const auto it = rows.constFind( DB::FileName::fromRelativePath( reader->attribute(fileString) ) );
+                if ( it != rows.constEnd() && m_db->m_images.at( it.value() ) ) {
+                    images.append( m_db->m_images.at( it.value() ) );
+                    m_db->m_images[it.value()] = DB::ImageInfoPtr();
+                }
+                reader->readEndElement();
+            }
+            // images missing from the order stay at the end:
+            for ( const DB::ImageInfoPtr& imageInfo : m_db->m_images ) {
+                if ( imageInfo )
+                    images.append( imageInfo );
+            }
+            m_db->m_images = images;
+            rows.clear();
+            for ( int row = 0; row < m_db->m_images.size(); ++row )
+                rows.insert( m_db->m_images.at( row )->fileName(), row );
+        }
+        else if ( info.tokenName == blockListString ) {
+            m_db->m_blockList.clear();
+            loadBlockList( reader );
+        }
+        else if ( info.tokenName == memberGroupsString ) {
+            m_db->m_members = DB::MemberMap();
+            loadMemberGroups( reader );
+        }
+        else {
+            reader->complainStartElementExpected(imagesString);
+        }
+    }
+    // the end of the entry:
+    reader->readNextStartOrStopElement(QString());
+}
+
+void XMLDB::FileReader::replayCategories( ReaderPtr reader )
+{
+    static QString nameString = QString::fromUtf8("name");
+    static QString iconString = QString::fromUtf8("icon");
+    static QString viewTypeString = QString::fromUtf8("viewtype");
+    static QString showString = QString::fromUtf8("show");
+    static QString thumbnailSizeString = QString::fromUtf8("thumbnailsize");
+    static QString positionableString = QString::fromUtf8("positionable");
+    static QString metaString = QString::fromUtf8("meta");
+    static QString tokensString = QString::fromUtf8("tokens");
+    static QString valueString = QString::fromUtf8("value");
+    static QString idString = QString::fromUtf8("id");
+    static QString birthDateString = QString::fromUtf8("birthDate");
+    static QString categoriesString = QString::fromUtf8("Categories");
+    static QString categoryString = QString::fromUtf8("Category");
+
+    reader->readNextStartOrStopElement(categoriesString);
+
+    QSet<QString> categoryNames;
+    while ( reader->readNextStartOrStopElement(categoryString).isStartToken) {
+        const QString categoryName = unescape(reader->attribute(nameString));
+        const QString icon = reader->attribute(iconString);
+        const DB::Category::ViewType type =
+                (DB::Category::ViewType) reader->attribute( viewTypeString, QString::fromLatin1( "0" ) ).toInt();
+        const int thumbnailSize = reader->attribute( thumbnailSizeString, QString::fromLatin1( "32" ) ).toInt();
+        const bool show = (bool) reader->attribute( showString, QString::fromLatin1( "1" ) ).toInt();
+        const bool positionable = (bool) reader->attribute( positionableString, QString::fromLatin1( "0" ) ).toInt();
+
+        DB::CategoryPtr cat = m_db->m_categoryCollection.categoryForName( categoryName );
+        if ( cat ) {
+            cat->setIconName( icon );
+            cat->setViewType( type );
+            cat->setThumbnailSize( thumbnailSize );
+            cat->setDoShow( show );
+            cat->setPositionable( positionable );
+        } else {
+            cat = new XMLCategory( categoryName, icon, type, thumbnailSize, show, positionable );
+            if ( reader->attribute(metaString) == tokensString )
+                cat->setType(DB::Category::TokensCategory);
+            m_db->m_categoryCollection.addCategory( cat );
+        }
+        categoryNames.insert( categoryName );
+
+        QStringList items;
+        while( reader->readNextStartOrStopElement(valueString).isStartToken) {
+            QString value = reader->attribute(valueString);
+            if ( reader->hasAttribute(idString) )
+                static_cast<XMLCategory*>(cat.data())->setIdMapping( value, reader->attribute(idString).toInt() );
+            if (reader->hasAttribute(birthDateString))
+                cat->setBirthDate(value,QDate::fromString(reader->attribute(birthDateString), Qt::ISODate));
+            items.append( value );
+            reader->readEndElement();
+        }
+        cat->setItems( items );
+    }
+
+    // Categories that are not saved, like the "Folder" category, are never part of the journal.
+    for ( const DB::CategoryPtr& category : m_db->m_categoryCollection.categories() ) {
+        if ( static_cast<XMLCategory*>( category.data() )->shouldSave() && !categoryNames.contains( category->name() ) )
+            m_db->m_categoryCollection.removeCategory( category->name() );
+    }
+}
+
 /*
 void XMLDB::FileReader::loadSettings(ReaderPtr reader)
 {
@@ -415,9 +659,9 @@ void XMLDB::FileReader::checkIfAllImagesHaveSizeAttributes()
 
 }
 
-DB::ImageInfoPtr XMLDB::FileReader::load( const DB::FileName& fileName, ReaderPtr reader )
+DB::ImageInfoPtr XMLDB::FileReader::load( const DB::FileName& fileName, ReaderPtr reader, bool compressed )
 {
-    DB::ImageInfoPtr info = XMLDB::Database::createImageInfo(fileName, reader, m_db);
+    DB::ImageInfoPtr info = XMLDB::Database::createImageInfo(fileName, reader, compressed ? m_db : nullptr);
     m_nextStackId = qMax( m_nextStackId, info->stackId() + 1 );
     info->createFolderCategoryItem( m_folderCategory, m_db->m_members );
     return info;
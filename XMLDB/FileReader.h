@@ -21,6 +21,7 @@
 #include <qdom.h>
 #include "DB/ImageInfoPtr.h"
 #include "DB/ImageInfo.h"
+#include <QHash>
 #include <QSharedPointer>
 #include "XmlReader.h"
 
@@ -35,10 +36,11 @@ class FileReader
 {
 
 public:
-    FileReader( Database* db ) : m_db( db ), m_nextStackId(1) {}
+    FileReader( Database* db ) : m_db( db ), m_nextStackId(1), m_replayedJournalEntries(0) {}
     void read( const QString& configFile );
     static QString unescape( const QString& );
     DB::StackID nextStackId() const { return m_nextStackId; };
+    int replayedJournalEntries() const { return m_replayedJournalEntries; }
 
 protected:
     void loadCategories( ReaderPtr reader );
@@ -47,7 +49,11 @@ protected:
     void loadMemberGroups( ReaderPtr reader );
     //void loadSettings(ReaderPtr reader);
 
-    DB::ImageInfoPtr load( const DB::FileName& filename, ReaderPtr reader );
+    void replayJournal( const QString& configFile );
+    void replayEntry( ReaderPtr reader, QHash<DB::FileName, int>& rows );
+    void replayCategories( ReaderPtr reader );
+
+    DB::ImageInfoPtr load( const DB::FileName& filename, ReaderPtr reader, bool compressed = true );
     ReaderPtr readConfigFile( const QString& configFile );
 
     void createSpecialCategories();
@@ -62,6 +68,7 @@ private:
     Database* const m_db;
     int m_fileVersion;
     DB::StackID m_nextStackId;
+    int m_replayedJournalEntries;
 
     // During profilation I found that it was rather expensive to look this up over and over again (once for each image)
     DB::CategoryPtr m_folderCategory;
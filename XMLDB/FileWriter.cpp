@@ -20,6 +20,7 @@
 #include "CompressFileInfo.h"
 #include "Database.h"
 #include "ElementWriter.h"
+#include "Journal.h"
 #include "Logging.h"
 #include "NumberedBackup.h"
 #include "XMLCategory.h"
@@ -32,9 +33,16 @@
 #include <KLocalizedString>
 #include <KMessageBox>
 
+#include <QBuffer>
+#include <QDir>
 #include <QFile>
-#include <QXmlStreamWriter>
 #include <QFileInfo>
+#include <QSaveFile>
+#include <QXmlStreamWriter>
+
+extern "C" {
+#include <unistd.h>
+}
 
 // I've added this to provide anyone interested
 // with a quick and easy means to benchmark performance differences
@@ -68,92 +76,273 @@
 
 using Utilities::StringSet;
 
-void XMLDB::FileWriter::save( const QString& fileName, bool isAutoSave )
+XMLDB::FileWriter::FileWriter()
+    : m_compressed( false )
+    , m_indent( true )
+    , m_isJournalEntry( false )
+    , m_replaceJournal( false )
+    , m_writeOrder( false )
+    , m_writeCategories( false )
+    , m_writeBlockList( false )
+    , m_writeMemberGroups( false )
 {
-    setUseCompressedFileFormat( Settings::SettingsData::instance()->useCompressedIndexXML() );
+}
 
-    if ( !isAutoSave )
-        NumberedBackup().makeNumberedBackup();
+XMLDB::FileWriter::FileWriter( Database* db )
+    : FileWriter()
+{
+    setUseCompressedFileFormat( Settings::SettingsData::instance()->useCompressedIndexXML() );
+    m_compressed = useCompressedFileFormat();
+    m_indent = Settings::SettingsData::instance()->indentIndexXML();
 
     // prepare XML document for saving:
-    m_db->m_categoryCollection.initIdMap();
-    QFile out(fileName + QString::fromLatin1(".tmp"));
+    db->m_categoryCollection.initIdMap();
+    setCategories( categoryData( db ) );
+
+    for ( const DB::ImageInfoPtr& info : db->m_images )
+        m_images.append( DB::ImageInfoPtr( new DB::ImageInfo( *info ) ) );
+    // Copy files from clipboard to end of overview, so we don't loose them
+    for ( const DB::ImageInfoPtr& info : db->m_clipboard )
+        m_images.append( DB::ImageInfoPtr( new DB::ImageInfo( *info ) ) );
+
+    m_blockList = db->m_blockList;
+    m_members = db->m_members.memberMap();
+}
+
+QList<XMLDB::FileWriter::CategoryData> XMLDB::FileWriter::categoryData( Database* db, bool withItems )
+{
+    QList<CategoryData> result;
+    const DB::CategoryPtr tokensCategory = db->m_categoryCollection.categoryForSpecial( DB::Category::TokensCategory );
+    for ( const DB::CategoryPtr& category : db->m_categoryCollection.categories() ) {
+        XMLCategory* xmlCategory = static_cast<XMLCategory*>( category.data() );
+        CategoryData data;
+        data.name = category->name();
+        data.escapedName = escape( data.name );
+        data.iconName = category->iconName();
+        data.show = category->doShow();
+        data.viewType = category->viewType();
+        data.thumbnailSize = category->thumbnailSize();
+        data.positionable = category->positionable();
+        data.isTokens = ( category == tokensCategory );
+        data.shouldSave = xmlCategory->shouldSave();
+        if ( !withItems ) {
+            result.append( data );
+            continue;
+        }
+        data.items = category->items();
+        data.ids = xmlCategory->idMap();
+        for ( const QString& item : data.items ) {
+            const QDate birthDate = category->birthDate( item );
+            if ( !birthDate.isNull() )
+                data.birthDates.insert( item, birthDate );
+        }
+        result.append( data );
+    }
+    return result;
+}
+
+void XMLDB::FileWriter::setCategories( const QList<CategoryData>& categories )
+{
+    m_categories = categories;
+    m_categoryIndex.clear();
+    for ( int i = 0; i < m_categories.size(); ++i )
+        m_categoryIndex.insert( m_categories.at( i ).name, i );
+}
+
+bool XMLDB::FileWriter::CategoryData::operator==( const CategoryData& other ) const
+{
+    return name == other.name
+            && iconName == other.iconName
+            && show == other.show
+            && viewType == other.viewType
+            && thumbnailSize == other.thumbnailSize
+            && positionable == other.positionable
+            && isTokens == other.isTokens
+            && shouldSave == other.shouldSave
+            && items == other.items
+            && ids == other.ids
+            && birthDates == other.birthDates;
+}
+
+bool XMLDB::FileWriter::save( const QString& fileName, bool isAutoSave )
+{
+    const bool success = write( fileName, isAutoSave );
+    showErrors( m_errors );
+    return success;
+}
+
+bool XMLDB::FileWriter::write( const QString& fileName, bool isAutoSave, const std::function<void( int percent )>& progress )
+{
+    m_errors.clear();
+
+    if ( !isAutoSave ) {
+        const QString backupError = m_backup.makeNumberedBackup();
+        if ( !backupError.isEmpty() )
+            m_errors.append( backupError );
+    }
+
+    // QSaveFile writes to a temporary file, syncs it to disk and only then replaces the old file.
+    // That way, index.xml always holds either the previous or the current version.
+    QSaveFile out( fileName );
     if ( !out.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        KMessageBox::sorry( messageParent(),
-                            i18n("<p>Could not save the image database to XML.</p>"
-                                 "File %1 could not be opened because of the following error: %2"
-                                 , out.fileName(), out.errorString() )
-                            );
-        return;
+        m_errors.append( i18n("<p>Could not save the image database to XML.</p>"
+                              "File %1 could not be opened because of the following error: %2"
+                              , fileName, out.errorString() ) );
+        return false;
     }
     QTime t;
     if (TimingLog().isDebugEnabled())
         t.start();
-    QXmlStreamWriter writer(&out);
-    writer.setAutoFormatting(true);
+
+    // QXmlStreamWriter makes many small writes, which are a lot cheaper into memory than into the file.
+    // The buffer is moved into the file each time the progress changes, so it never holds more
+    // than about a hundredth of the images.
+    QByteArray data;
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+    qint64 written = 0;
+    bool writeOk = true;
+    const auto flush = [&]() {
+        writeOk = writeOk && out.write( data ) == data.size();
+        written += data.size();
+        data.clear();
+        buffer.seek( 0 );
+    };
+    const auto flushAndReport = [&]( int percent ) {
+        flush();
+        if ( progress )
+            progress( percent );
+    };
+
+    QXmlStreamWriter writer(&buffer);
+    writer.setAutoFormatting(m_indent);
     writer.writeStartDocument();
 
     {
         ElementWriter dummy(writer, QString::fromLatin1("KPhotoAlbum"));
         writer.writeAttribute( QString::fromLatin1( "version" ), QString::number(Database::fileVersion()));
-        writer.writeAttribute( QString::fromLatin1( "compressed" ), QString::number(useCompressedFileFormat()));
+        writer.writeAttribute( QString::fromLatin1( "compressed" ), QString::number(m_compressed));
 
         saveCategories( writer );
-        saveImages( writer );
+        saveImages( writer, flushAndReport );
         saveBlockList( writer );
         saveMemberGroups( writer );
         //saveSettings(writer);
     }
     writer.writeEndDocument();
-    qCDebug(TimingLog) << "XMLDB::FileWriter::save(): Saving took" << t.elapsed() <<"ms";
+    flush();
+    qCDebug(TimingLog) << "XMLDB::FileWriter::write(): Saving" << m_images.size() << "images and" << written << "bytes took" << t.elapsed() <<"ms";
 
-    // State: index.xml has previous DB version, index.xml.tmp has the current version.
+    if ( writer.hasError() || !writeOk || !out.commit() ) {
+        m_errors.append( i18n("<p>Could not save the image database to XML.</p>"
+                              "File %1 could not be written because of the following error: %2"
+                              , fileName, out.errorString() ) );
+        return false;
+    }
 
-    // original file can be safely deleted
-    if ( ( ! QFile::remove( fileName ) ) && QFile::exists( fileName ) )
-    {
-        KMessageBox::sorry( messageParent(),
-                            i18n("<p>Failed to remove old version of image database.</p>"
-                                 "<p>Please try again or replace the file %1 with file %2 manually!</p>",
-                                 fileName, out.fileName() )
-                            );
-        return;
+    // Everything in the journal is in the file now.
+    QFile::remove( Journal::fileName( QFileInfo( fileName ).absolutePath() ) );
+    return true;
+}
+
+bool XMLDB::FileWriter::appendToJournal( const QString& journalFile, const std::function<void( int percent )>& progress )
+{
+    m_errors.clear();
+
+    QByteArray data;
+    QBuffer buffer( &data );
+    buffer.open( QIODevice::WriteOnly );
+    QXmlStreamWriter writer( &buffer );
+    writer.setAutoFormatting( m_indent );
+
+    if ( m_replaceJournal ) {
+        ElementWriter dummy( writer, QString::fromLatin1( "base" ) );
+        writer.writeAttribute( QString::fromLatin1( "index" ), Journal::baseIdentity( m_indexFile ) );
     }
-    // State: index.xml doesn't exist, index.xml.tmp has the current version.
-    if ( ! out.rename( fileName ) )
     {
-        KMessageBox::sorry( messageParent(),
-                            i18n("<p>Failed to move temporary XML file to permanent location.</p>"
-                                 "<p>Please try again or rename file %1 to %2 manually!</p>",
-                                 out.fileName(), fileName )
-                            );
-        // State: index.xml.tmp has the current version.
-        return;
+        ElementWriter dummy( writer, QString::fromLatin1( "entry" ) );
+        writer.writeAttribute( QString::fromLatin1( "version" ), QString::number( Database::fileVersion() ) );
+
+        if ( m_writeCategories )
+            saveCategories( writer );
+        // Deleted images go first: an image may have been renamed to the name of one deleted.
+        for ( const DB::FileName& fileName : m_deleted ) {
+            ElementWriter dummy( writer, QString::fromLatin1( "delete" ) );
+            writer.writeAttribute( QString::fromLatin1( "file" ), fileName.relative() );
+        }
+        for ( const auto& rename : m_renamed ) {
+            ElementWriter dummy( writer, QString::fromLatin1( "rename" ) );
+            writer.writeAttribute( QString::fromLatin1( "file" ), rename.first.relative() );
+            writer.writeAttribute( QString::fromLatin1( "to" ), rename.second.relative() );
+        }
+        if ( !m_images.isEmpty() )
+            saveImages( writer, progress );
+        if ( m_writeOrder ) {
+            ElementWriter dummy( writer, QString::fromLatin1( "order" ) );
+            for ( const DB::FileName& fileName : m_order ) {
+                ElementWriter dummy( writer, QString::fromLatin1( "image" ) );
+                writer.writeAttribute( QString::fromLatin1( "file" ), fileName.relative() );
+            }
+        }
+        if ( m_writeBlockList )
+            saveBlockList( writer );
+        if ( m_writeMemberGroups )
+            saveMemberGroups( writer );
+    }
+    data.append( '\n' );
+
+    if ( m_replaceJournal ) {
+        QSaveFile out( journalFile );
+        if ( !out.open( QIODevice::WriteOnly ) || out.write( data ) != data.size() || !out.commit() ) {
+            m_errors.append( i18n( "<p>Could not auto save the changes.</p>"
+                                   "File %1 could not be written because of the following error: %2"
+                                   , journalFile, out.errorString() ) );
+            return false;
+        }
+        // An auto save of the whole database from before is out of date now.
+        QFile::remove( QFileInfo( journalFile ).absolutePath() + QString::fromLatin1( "/.#index.xml" ) );
+        return true;
+    }
+
+    QFile out( journalFile );
+    bool ok = out.exists() && out.open( QIODevice::WriteOnly | QIODevice::Append );
+    if ( ok )
+        ok = out.write( data ) == data.size() && out.flush() && ::fsync( out.handle() ) == 0;
+    if ( !ok ) {
+        m_errors.append( i18n( "<p>Could not auto save the changes.</p>"
+                               "File %1 could not be written because of the following error: %2"
+                               , journalFile, out.exists() ? out.errorString() : i18n( "The file does not exist" ) ) );
+        // Entries after a missing one must never be replayed.
+        out.close();
+        QFile::remove( journalFile );
+        return false;
     }
-    // State: index.xml has the current version.
+    return true;
+}
+
+void XMLDB::FileWriter::showErrors( const QStringList& errors )
+{
+    for ( const QString& error : errors )
+        KMessageBox::sorry( messageParent(), error );
 }
 
 void XMLDB::FileWriter::saveCategories( QXmlStreamWriter& writer )
 {
-    QStringList categories = DB::ImageDB::instance()->categoryCollection()->categoryNames();
     ElementWriter dummy(writer, QString::fromLatin1("Categories") );
 
-    DB::CategoryPtr tokensCategory = DB::ImageDB::instance()->categoryCollection()->categoryForSpecial( DB::Category::TokensCategory );
-    for (QString name : categories) {
-        DB::CategoryPtr category = DB::ImageDB::instance()->categoryCollection()->categoryForName(name);
-
-        if (! shouldSaveCategory(name)) {
+    for (const CategoryData& category : m_categories) {
+        if (! shouldSaveCategory(category.name)) {
             continue;
         }
 
         ElementWriter dummy(writer, QString::fromUtf8("Category"));
-        writer.writeAttribute(QString::fromUtf8("name"),  name);
-        writer.writeAttribute(QString::fromUtf8("icon"), category->iconName());
-        writer.writeAttribute(QString::fromUtf8("show"), QString::number(category->doShow()));
-        writer.writeAttribute(QString::fromUtf8("viewtype"), QString::number(category->viewType()));
-        writer.writeAttribute(QString::fromUtf8("thumbnailsize"), QString::number(category->thumbnailSize()));
-        writer.writeAttribute(QString::fromUtf8("positionable"), QString::number(category->positionable()));
-        if (category == tokensCategory) {
+        writer.writeAttribute(QString::fromUtf8("name"),  category.name);
+        writer.writeAttribute(QString::fromUtf8("icon"), category.iconName);
+        writer.writeAttribute(QString::fromUtf8("show"), QString::number(category.show));
+        writer.writeAttribute(QString::fromUtf8("viewtype"), QString::number(category.viewType));
+        writer.writeAttribute(QString::fromUtf8("thumbnailsize"), QString::number(category.thumbnailSize));
+        writer.writeAttribute(QString::fromUtf8("positionable"), QString::number(category.positionable));
+        if (category.isTokens) {
             writer.writeAttribute(QString::fromUtf8("meta"),QString::fromUtf8("tokens"));
         }
 
@@ -168,32 +357,31 @@ void XMLDB::FileWriter::saveCategories( QXmlStreamWriter& writer )
                                             m_db->_members.groups(name));
         */
 
-        Q_FOREACH(const QString &tagName, category->items()) {
+        for (const QString &tagName : category.items) {
             ElementWriter dummy( writer, QString::fromLatin1("value") );
             writer.writeAttribute( QString::fromLatin1("value"), tagName );
             writer.writeAttribute( QString::fromLatin1( "id" ),
-                                    QString::number(static_cast<XMLCategory*>( category.data() )->idForName( tagName ) ));
-            QDate birthDate = category->birthDate(tagName);
+                                    QString::number( category.idForName( tagName ) ));
+            QDate birthDate = category.birthDates.value(tagName);
             if (!birthDate.isNull())
                 writer.writeAttribute( QString::fromUtf8("birthDate"), birthDate.toString(Qt::ISODate) );
         }
     }
 }
 
-void XMLDB::FileWriter::saveImages( QXmlStreamWriter& writer )
+void XMLDB::FileWriter::saveImages( QXmlStreamWriter& writer, const std::function<void( int percent )>& progress )
 {
-    DB::ImageInfoList list = m_db->m_images;
+    ElementWriter dummy(writer, QString::fromLatin1( "images" ) );
 
-    // Copy files from clipboard to end of overview, so we don't loose them
-    Q_FOREACH(const DB::ImageInfoPtr &infoPtr, m_db->m_clipboard) {
-        list.append(infoPtr);
-    }
-
-    {
-        ElementWriter dummy(writer, QString::fromLatin1( "images" ) );
+    int count = 0;
+    int lastPercent = -1;
+    for (const DB::ImageInfoPtr &infoPtr : m_images) {
+        save( writer, infoPtr );
 
-        Q_FOREACH(const DB::ImageInfoPtr &infoPtr, list) {
-            save( writer, infoPtr );
+        const int percent = ++count * 100 / m_images.size();
+        if ( progress && percent != lastPercent ) {
+            progress( percent );
+            lastPercent = percent;
         }
     }
 }
@@ -202,11 +390,11 @@ void XMLDB::FileWriter::saveBlockList( QXmlStreamWriter& writer )
 {
     ElementWriter dummy( writer, QString::fromLatin1( "blocklist" ) );
 #ifdef DETERMINISTIC_DBSAVE
-    QList<DB::FileName> blockList = m_db->m_blockList.toList();
+    QList<DB::FileName> blockList = m_blockList.toList();
     // sort blocklist to get diffable files
     std::sort(blockList.begin(), blockList.end());
 #else
-    QSet<DB::FileName> blockList = m_db->m_blockList;
+    QSet<DB::FileName> blockList = m_blockList;
 #endif
     Q_FOREACH(const DB::FileName &block, blockList) {
         ElementWriter dummy( writer,  QString::fromLatin1( "block" ) );
@@ -216,12 +404,13 @@ void XMLDB::FileWriter::saveBlockList( QXmlStreamWriter& writer )
 
 void XMLDB::FileWriter::saveMemberGroups( QXmlStreamWriter& writer )
 {
-    if ( m_db->m_members.isEmpty() )
+    // in the journal, an empty element tells that all groups are gone
+    if ( m_members.isEmpty() && !m_isJournalEntry )
         return;
 
     ElementWriter dummy( writer, QString::fromLatin1( "member-groups" ) );
-    for( QMap< QString,QMap<QString,StringSet> >::ConstIterator memberMapIt= m_db->m_members.memberMap().constBegin();
-         memberMapIt != m_db->m_members.memberMap().constEnd(); ++memberMapIt )
+    for( QMap< QString,QMap<QString,StringSet> >::ConstIterator memberMapIt= m_members.constBegin();
+         memberMapIt != m_members.constEnd(); ++memberMapIt )
     {
         const QString categoryName = memberMapIt.key();
 
@@ -243,23 +432,21 @@ void XMLDB::FileWriter::saveMemberGroups( QXmlStreamWriter& writer )
                 continue;
             }
 
-            if ( useCompressedFileFormat() ) {
+            if ( m_compressed ) {
                 StringSet members = groupMapIt.value();
                 ElementWriter dummy( writer, QString::fromLatin1( "member" ) );
                 writer.writeAttribute( QString::fromLatin1( "category" ), categoryName );
                 writer.writeAttribute( QString::fromLatin1( "group-name" ), groupMapIt.key() );
-                QStringList idList;
+                QVector<int> idList;
+                idList.reserve( members.size() );
+                const CategoryData* category = this->category( categoryName );
                 Q_FOREACH(const QString& member, members) {
-                    DB::CategoryPtr catPtr = m_db->m_categoryCollection.categoryForName( categoryName );
-                    XMLCategory* category = static_cast<XMLCategory*>( catPtr.data() );
-                    if (category->idForName(member)==0)
+                    const int id = category->idForName( member );
+                    if (id==0)
                         qCWarning(XMLDBLog) << "Member" << member << "in group" << categoryName << "->" << groupMapIt.key() << "has no id!";
-                    idList.append( QString::number( category->idForName( member ) ) );
+                    idList.append( id );
                 }
-#ifdef DETERMINISTIC_DBSAVE
-                std::sort(idList.begin(), idList.end());
-#endif
-                writer.writeAttribute( QString::fromLatin1( "members" ), idList.join( QString::fromLatin1( "," ) ) );
+                writer.writeAttribute( QString::fromLatin1( "members" ), idListToString( idList ) );
             }
             else {
 #ifdef DETERMINISTIC_DBSAVE
@@ -350,7 +537,10 @@ void XMLDB::FileWriter::save( QXmlStreamWriter& writer, const DB::ImageInfoPtr&
     if ( info->isVideo() )
         writer.writeAttribute( QLatin1String("videoLength"), QString::number(info->videoLength()));
 
-    if ( useCompressedFileFormat() )
+    if ( info->perceptualHash() != 0 )
+        writer.writeAttribute( QString::fromLatin1("perceptualHash"), QString::number(info->perceptualHash(), 16));
+
+    if ( m_compressed )
         writeCategoriesCompressed( writer, info );
     else
         writeCategories( writer, info );
@@ -366,6 +556,63 @@ QString XMLDB::FileWriter::areaToString(QRect area) const
     return areaString.join( QString::fromLatin1(" ") );
 }
 
+namespace
+{
+int digitCount( int number )
+{
+    int count = 1;
+    while ( number >= 10 ) {
+        number /= 10;
+        ++count;
+    }
+    return count;
+}
+
+// Tell whether the decimal text of a comes before that of b, so that "10" comes before "9".
+// The ids used to be sorted as strings, and the files must stay the same.
+bool lessAsText( int a, int b )
+{
+    qint64 scaledA = a;
+    qint64 scaledB = b;
+    const int digitsA = digitCount( a );
+    const int digitsB = digitCount( b );
+    for ( int i = digitsA; i < digitsB; ++i )
+        scaledA *= 10;
+    for ( int i = digitsB; i < digitsA; ++i )
+        scaledB *= 10;
+    if ( scaledA != scaledB )
+        return scaledA < scaledB;
+    // one is a prefix of the other:
+    return digitsA < digitsB;
+}
+}
+
+/**
+ * Sort the (non-negative) ids and join them with commas, without a string for each of them.
+ */
+QString XMLDB::FileWriter::idListToString( QVector<int>& ids )
+{
+#ifdef DETERMINISTIC_DBSAVE
+    std::sort( ids.begin(), ids.end(), lessAsText );
+#endif
+    QString result;
+    result.reserve( ids.size() * 4 );
+    char digits[12];
+    for ( int id : ids ) {
+        if ( !result.isEmpty() )
+            result.append( QLatin1Char( ',' ) );
+        char* end = digits + sizeof( digits );
+        char* start = end;
+        unsigned int value = id;
+        do {
+            *--start = char( '0' + value % 10 );
+            value /= 10;
+        } while ( value != 0 );
+        result.append( QLatin1String( start, int( end - start ) ) );
+    }
+    return result;
+}
+
 void XMLDB::FileWriter::writeCategories( QXmlStreamWriter& writer, const DB::ImageInfoPtr& info )
 {
     ElementWriter topElm(writer, QString::fromLatin1("options"), false );
@@ -405,16 +652,16 @@ void XMLDB::FileWriter::writeCategoriesCompressed( QXmlStreamWriter& writer, con
 {
     QMap<QString, QList<QPair<QString, QRect>>> positionedTags;
 
-    QList<DB::CategoryPtr> categoryList = DB::ImageDB::instance()->categoryCollection()->categories();
-    Q_FOREACH(const DB::CategoryPtr &category, categoryList) {
-        QString categoryName = category->name();
+    for (const CategoryData& category : m_categories) {
+        const QString& categoryName = category.name;
 
         if ( !shouldSaveCategory( categoryName ) )
             continue;
 
         StringSet items = info->itemsOfCategory(categoryName);
         if ( !items.empty() ) {
-            QStringList idList;
+            QVector<int> idList;
+            idList.reserve( items.size() );
 
             Q_FOREACH(const QString &itemValue, items) {
                 QRect area = info->areaForTag(categoryName, itemValue);
@@ -424,8 +671,7 @@ void XMLDB::FileWriter::writeCategoriesCompressed( QXmlStreamWriter& writer, con
                     // so we have to handle them separately
                     positionedTags[categoryName] << QPair<QString, QRect>(itemValue, area);
                 } else {
-                    int id = static_cast<const XMLCategory*>(category.data())->idForName(itemValue);
-                    idList.append( QString::number( id ) );
+                    idList.append( category.idForName(itemValue) );
                 }
             }
 
@@ -433,10 +679,7 @@ void XMLDB::FileWriter::writeCategoriesCompressed( QXmlStreamWriter& writer, con
             // write the category attribute if there are actually ids to write
             if ( !idList.isEmpty() )
             {
-#ifdef DETERMINISTIC_DBSAVE
-                std::sort(idList.begin(), idList.end());
-#endif
-                writer.writeAttribute( escape( categoryName ), idList.join( QString::fromLatin1( "," ) ) );
+                writer.writeAttribute( category.escapedName, idListToString( idList ) );
             }
         }
     }
@@ -471,21 +714,21 @@ void XMLDB::FileWriter::writeCategoriesCompressed( QXmlStreamWriter& writer, con
 
 bool XMLDB::FileWriter::shouldSaveCategory( const QString& categoryName ) const
 {
-    // Profiling indicated that this function was a hotspot, so this cache improved saving speed with 25%
-    static QHash<QString,bool> cache;
-    if ( cache.contains(categoryName))
-        return cache[categoryName];
-
     // A few bugs has shown up, where an invalid category name has crashed KPA. It therefore checks for such invalid names here.
-    if ( !m_db->m_categoryCollection.categoryForName( categoryName ) ) {
+    const CategoryData* category = this->category( categoryName );
+    if ( !category ) {
         qCWarning(XMLDBLog,"Invalid category name: %s", qPrintable(categoryName));
-        cache.insert(categoryName,false);
         return false;
     }
+    return category->shouldSave;
+}
 
-    const bool shouldSave =  dynamic_cast<XMLCategory*>( m_db->m_categoryCollection.categoryForName( categoryName ).data() )->shouldSave();
-    cache.insert(categoryName,shouldSave);
-    return shouldSave;
+const XMLDB::FileWriter::CategoryData* XMLDB::FileWriter::category( const QString& name ) const
+{
+    const auto it = m_categoryIndex.constFind( name );
+    if ( it == m_categoryIndex.constEnd() )
+        return nullptr;
+    return &m_categories.at( it.value() );
 }
 
 /**
@@ -494,28 +737,26 @@ bool XMLDB::FileWriter::shouldSaveCategory( const QString& categoryName ) const
  */
 QString XMLDB::FileWriter::escape( const QString& str )
 {
-    static QHash<QString,QString> cache;
-    if ( cache.contains(str) )
-        return cache[str];
-
-    QString tmp( str );
-    // Regex to match characters that are not allowed to start XML attribute names
-    const QRegExp rx( QString::fromLatin1( "([^a-zA-Z0-9:_])" ) );
-    int pos = 0;
-
     // Encoding special characters if compressed XML is selected
-    if ( useCompressedFileFormat() ) {
-        while ( ( pos = rx.indexIn( tmp, pos ) ) != -1 ) {
-            QString before = rx.cap( 1 );
-            QString after;
-            after.sprintf( "_.%0X", rx.cap( 1 ).data()->toLatin1());
-            tmp.replace( pos, before.length(), after);
-            pos += after.length();
+    if ( !useCompressedFileFormat() ) {
+        QString tmp( str );
+        return tmp.replace( QLatin1Char( ' ' ), QLatin1Char( '_' ) );
+    }
+
+    QString result;
+    result.reserve( str.size() );
+    for ( const QChar ch : str ) {
+        const ushort c = ch.unicode();
+        if ( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == ':' || c == '_' )
+            result.append( ch );
+        else {
+            // the characters that are not allowed to start XML attribute names are written as their
+            // Latin-1 code the way printf("%X") does, i.e. sign extended for codes above 127:
+            result.append( QString::fromLatin1( "_." ) );
+            result.append( QString::number( uint( int( ch.toLatin1() ) ), 16 ).toUpper() );
         }
-    } else
-        tmp.replace( QString::fromLatin1( " " ), QString::fromLatin1( "_" ) );
-    cache.insert(str,tmp);
-    return tmp;
+    }
+    return result;
 }
 
 // TODO(hzeller): DEPENDENCY This pulls in the whole MainWindow dependency into the database backend.
@@ -18,10 +18,25 @@
 #ifndef XMLDB_FILEWRITER_H
 #define XMLDB_FILEWRITER_H
 
+#include "NumberedBackup.h"
+
+#include <DB/FileNameList.h>
+#include <DB/ImageInfoList.h>
+#include <DB/ImageInfoPtr.h>
+#include <Utilities/StringSet.h>
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
 #include <QRect>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QVector>
 
-#include <DB/ImageInfoPtr.h>
+#include <functional>
 
 class QWidget;
 class QXmlStreamWriter;
@@ -30,16 +45,78 @@ namespace XMLDB
 {
 class Database;
 
+/**
+ * \brief Writes the database to index.xml.
+ *
+ * The constructor copies everything that goes into the file out of the database.
+ * The ImageInfos are copied as well, which is cheap, as their strings, sets and maps are implicitly shared.
+ * After that, write() does not touch the database any more, and can run on any thread while the database
+ * is changed in the GUI: the file contains the database as it was when the FileWriter was created.
+ *
+ * The constructor must run on the GUI thread.
+ *
+ * The XMLDB::Journal creates FileWriters holding only what changed since its last entry;
+ * those are written with appendToJournal() instead of write().
+ */
 class FileWriter
 {
 public:
-    explicit FileWriter( Database* db ) :m_db(db) {}
-    void save( const QString& fileName, bool isAutoSave );
+    explicit FileWriter( Database* db );
+    /**
+     * Write the file and show any errors to the user. Must be called on the GUI thread.
+     */
+    bool save( const QString& fileName, bool isAutoSave );
+    /**
+     * Write the file. Unless \p isAutoSave is set, a numbered backup of the current index.xml is made first.
+     * The file holds all changes, so a journal next to it is removed.
+     * @param progress is called with the percentage of the images written so far.
+     * @return \c true if the file was written. Either way, errors() tells what went wrong.
+     */
+    bool write( const QString& fileName, bool isAutoSave, const std::function<void( int percent )>& progress = std::function<void( int )>() );
+    /**
+     * Indent the elements of the file, which is the default.
+     * The files are byte for byte the same as the ones QXmlStreamWriter::setAutoFormatting writes.
+     */
+    void setIndentation( bool indent ) { m_indent = indent; }
+    /**
+     * Show \p errors of a write() to the user. Must be called on the GUI thread.
+     */
+    static void showErrors( const QStringList& errors );
+    bool isJournalEntry() const { return m_isJournalEntry; }
+    /**
+     * Append the changes to \p journalFile, and flush them to disk.
+     * The first entry after a save replaces the journal and records which index.xml it belongs to.
+     */
+    bool appendToJournal( const QString& journalFile, const std::function<void( int percent )>& progress = std::function<void( int )>() );
+    QStringList errors() const { return m_errors; }
     static QString escape( const QString& );
 
+    /**
+     * \brief What the FileWriter needs to know about a category.
+     */
+    struct CategoryData {
+        QString name;
+        // the name as attribute of compressed images:
+        QString escapedName;
+        QString iconName;
+        bool show;
+        int viewType;
+        int thumbnailSize;
+        bool positionable;
+        bool isTokens;
+        bool shouldSave;
+        QStringList items;
+        QMap<QString,int> ids;
+        QMap<QString,QDate> birthDates;
+
+        int idForName( const QString& name ) const { return ids.value( name ); }
+        bool operator==( const CategoryData& other ) const;
+        bool operator!=( const CategoryData& other ) const { return !( *this == other ); }
+    };
+
 protected:
     void saveCategories( QXmlStreamWriter& );
-    void saveImages( QXmlStreamWriter& );
+    void saveImages( QXmlStreamWriter&, const std::function<void( int percent )>& progress );
     void saveBlockList( QXmlStreamWriter& );
     void saveMemberGroups( QXmlStreamWriter& );
     void save( QXmlStreamWriter& writer, const DB::ImageInfoPtr& info );
@@ -49,11 +126,45 @@ protected:
     //void saveSettings(QXmlStreamWriter&);
 
 private:
+    friend class Journal;
+    FileWriter();
+
+    /**
+     * The categories of \p db. Call XMLCategoryCollection::initIdMap() first for the ids to be complete.
+     * Unless \p withItems is \c true, the items, ids and birth dates are left out; that is enough
+     * to write images, but not to write the categories.
+     */
+    static QList<CategoryData> categoryData( Database* db, bool withItems = true );
+    void setCategories( const QList<CategoryData>& categories );
+    const CategoryData* category( const QString& name ) const;
+
     // The parent widget information dialogs are displayed in.
-    QWidget *messageParent();
+    static QWidget *messageParent();
 
-    Database* const m_db;
     QString areaToString(QRect area) const;
+    static QString idListToString( QVector<int>& ids );
+
+    NumberedBackup m_backup;
+    bool m_compressed;
+    bool m_indent;
+    QList<CategoryData> m_categories;
+    QHash<QString, int> m_categoryIndex;
+    DB::ImageInfoList m_images;
+    QSet<DB::FileName> m_blockList;
+    QMap<QString, QMap<QString, Utilities::StringSet>> m_members;
+    QStringList m_errors;
+
+    // Only for entries of the journal, where m_images holds the changed images:
+    bool m_isJournalEntry;
+    bool m_replaceJournal;
+    QString m_indexFile;
+    QList<QPair<DB::FileName, DB::FileName>> m_renamed;
+    DB::FileNameList m_deleted;
+    bool m_writeOrder;
+    DB::FileNameList m_order;
+    bool m_writeCategories;
+    bool m_writeBlockList;
+    bool m_writeMemberGroups;
 };
 
 }
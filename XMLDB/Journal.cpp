@@ -0,0 +1,258 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "Journal.h"
+#include "Database.h"
+#include "Logging.h"
+#include "XMLCategory.h"
+
+#include <DB/ImageInfo.h>
+
+#include <QDateTime>
+#include <QFileInfo>
+
+namespace
+{
+// replace the journal by a single entry after this many entries:
+constexpr int MAX_ENTRIES = 100;
+}
+
+XMLDB::Journal::Journal()
+    : m_entries( 0 )
+    , m_canCompact( false )
+    , m_broken( false )
+{
+}
+
+QString XMLDB::Journal::fileName( const QString& directory )
+{
+    return directory + QString::fromLatin1( "/.#index.xml.journal" );
+}
+
+QString XMLDB::Journal::baseIdentity( const QString& indexFile )
+{
+    const QFileInfo info( indexFile );
+    if ( !info.exists() )
+        return QString::fromLatin1( "none" );
+    return QString::fromLatin1( "%1:%2" ).arg( info.size() ).arg( info.lastModified().toMSecsSinceEpoch() );
+}
+
+void XMLDB::Journal::loaded( Database* db, int replayedEntries )
+{
+    // reading the images set their dirty flags:
+    for ( const DB::ImageInfoPtr& info : db->m_images )
+        info->setIsDirty( false );
+    m_sinceLast.clear();
+    m_sinceCheckpoint.clear();
+    m_checkpointCategories = categoryRevisions( db );
+    m_lastCategories = m_checkpointCategories;
+    m_entries = replayedEntries;
+    m_canCompact = ( replayedEntries == 0 );
+    m_broken = false;
+}
+
+void XMLDB::Journal::checkpoint( Database* db )
+{
+    db->m_categoryCollection.initIdMap();
+    m_sinceCheckpoint.clearDirtyFlags();
+    m_sinceLast.clear();
+    m_sinceCheckpoint.clear();
+    m_checkpointCategories = categoryRevisions( db );
+    m_lastCategories = m_checkpointCategories;
+    m_entries = 0;
+    m_canCompact = true;
+}
+
+XMLDB::FileWriter* XMLDB::Journal::createEntry( Database* db )
+{
+    const bool compact = m_canCompact && m_entries >= MAX_ENTRIES;
+    const Changes& changes = compact ? m_sinceCheckpoint : m_sinceLast;
+    const bool writeCategories = ( categoryRevisions( db ) != ( compact ? m_checkpointCategories : m_lastCategories ) );
+    if ( changes.isEmpty() && !writeCategories )
+        return nullptr;
+
+    if ( compact )
+        qCDebug(XMLDBLog) << "Compacting the journal to the changes since the last save";
+
+    FileWriter* entry = new FileWriter;
+    entry->m_isJournalEntry = true;
+    entry->m_replaceJournal = ( m_entries == 0 || compact );
+    entry->m_indexFile = db->m_fileName;
+
+    entry->m_writeCategories = writeCategories;
+    if ( writeCategories ) {
+        db->m_categoryCollection.initIdMap();
+        entry->setCategories( FileWriter::categoryData( db ) );
+    } else {
+        entry->setCategories( FileWriter::categoryData( db, false ) );
+    }
+
+    entry->m_deleted = changes.deleted;
+    for ( auto it = changes.renamed.constBegin(); it != changes.renamed.constEnd(); ++it ) {
+        // an image may have got its old name back:
+        if ( it.value() != it.key()->fileName() )
+            entry->m_renamed.append( qMakePair( it.value(), it.key()->fileName() ) );
+    }
+    for ( DB::ImageInfo* info : changes.added )
+        entry->m_images.append( DB::ImageInfoPtr( new DB::ImageInfo( *info ) ) );
+    for ( DB::ImageInfo* info : changes.changed )
+        entry->m_images.append( DB::ImageInfoPtr( new DB::ImageInfo( *info ) ) );
+
+    entry->m_writeOrder = changes.order;
+    if ( changes.order )
+        entry->m_order = db->m_images.files();
+    entry->m_writeBlockList = changes.blockList;
+    if ( changes.blockList )
+        entry->m_blockList = db->m_blockList;
+    entry->m_writeMemberGroups = changes.memberGroups;
+    if ( changes.memberGroups )
+        entry->m_members = db->m_members.memberMap();
+
+    changes.clearDirtyFlags();
+    m_sinceLast.clear();
+    m_lastCategories = categoryRevisions( db );
+    m_entries = compact ? 1 : m_entries + 1;
+    return entry;
+}
+
+void XMLDB::Journal::imageChanged( DB::ImageInfo* info )
+{
+    // a setter given the value the image already had:
+    if ( !info->isDirty() )
+        return;
+    m_sinceLast.imageChanged( info );
+    m_sinceCheckpoint.imageChanged( info );
+}
+
+void XMLDB::Journal::imagesAdded( const DB::ImageInfoList& images, bool appended )
+{
+    m_sinceLast.imagesAdded( images, appended );
+    m_sinceCheckpoint.imagesAdded( images, appended );
+}
+
+void XMLDB::Journal::imageRenamed( DB::ImageInfo* info, const DB::FileName& oldName )
+{
+    m_sinceLast.imageRenamed( info, oldName );
+    m_sinceCheckpoint.imageRenamed( info, oldName );
+}
+
+void XMLDB::Journal::imageDeleted( DB::ImageInfo* info )
+{
+    m_sinceLast.imageDeleted( info );
+    m_sinceCheckpoint.imageDeleted( info );
+}
+
+void XMLDB::Journal::orderChanged()
+{
+    m_sinceLast.order = true;
+    m_sinceCheckpoint.order = true;
+}
+
+void XMLDB::Journal::blockListChanged()
+{
+    m_sinceLast.blockList = true;
+    m_sinceCheckpoint.blockList = true;
+}
+
+void XMLDB::Journal::memberGroupsChanged()
+{
+    m_sinceLast.memberGroups = true;
+    m_sinceCheckpoint.memberGroups = true;
+}
+
+QList<int> XMLDB::Journal::categoryRevisions( Database* db )
+{
+    QList<int> result;
+    for ( const DB::CategoryPtr& category : db->m_categoryCollection.categories() )
+        result.append( static_cast<XMLCategory*>( category.data() )->revision() );
+    return result;
+}
+
+XMLDB::Journal::Changes::Changes()
+    : order( false )
+    , blockList( false )
+    , memberGroups( false )
+{
+}
+
+void XMLDB::Journal::Changes::clear()
+{
+    added.clear();
+    isAdded.clear();
+    changed.clear();
+    renamed.clear();
+    deleted.clear();
+    order = false;
+    blockList = false;
+    memberGroups = false;
+}
+
+bool XMLDB::Journal::Changes::isEmpty() const
+{
+    return added.isEmpty() && changed.isEmpty() && renamed.isEmpty() && deleted.isEmpty()
+            && !order && !blockList && !memberGroups;
+}
+
+void XMLDB::Journal::Changes::imageChanged( DB::ImageInfo* info )
+{
+    // new images are written with all their changes anyway:
+    if ( !isAdded.contains( info ) )
+        changed.insert( info );
+}
+
+void XMLDB::Journal::Changes::imagesAdded( const DB::ImageInfoList& images, bool appended )
+{
+    // replaying the entry appends the new images, in the order they are written in:
+    for ( const DB::ImageInfoPtr& info : images ) {
+        added.append( info.data() );
+        isAdded.insert( info.data() );
+    }
+    if ( !appended )
+        order = true;
+}
+
+void XMLDB::Journal::Changes::imageRenamed( DB::ImageInfo* info, const DB::FileName& oldName )
+{
+    if ( isAdded.contains( info ) )
+        return;
+    // The renames of an entry are replayed all at once, so only the first name counts.
+    if ( !renamed.contains( info ) )
+        renamed.insert( info, oldName );
+    // the image itself is replayed under its new name:
+    changed.insert( info );
+}
+
+void XMLDB::Journal::Changes::imageDeleted( DB::ImageInfo* info )
+{
+    if ( isAdded.remove( info ) ) {
+        added.removeOne( info );
+        return;
+    }
+    changed.remove( info );
+    deleted.append( renamed.contains( info ) ? renamed.take( info ) : info->fileName() );
+}
+
+void XMLDB::Journal::Changes::clearDirtyFlags() const
+{
+    for ( DB::ImageInfo* info : added )
+        info->setIsDirty( false );
+    for ( DB::ImageInfo* info : changed )
+        info->setIsDirty( false );
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
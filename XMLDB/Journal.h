@@ -0,0 +1,159 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef XMLDB_JOURNAL_H
+#define XMLDB_JOURNAL_H
+
+#include "FileWriter.h"
+
+#include <DB/FileName.h>
+#include <DB/ImageInfoList.h>
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+namespace DB
+{
+class ImageInfo;
+}
+
+namespace XMLDB
+{
+class Database;
+
+/**
+ * \brief Keeps track of the changes to the database since it was last saved.
+ *
+ * Rather than writing the whole database on every auto save, only the changes are appended
+ * to the file <tt>.#index.xml.journal</tt> next to index.xml. Each entry of the journal holds the
+ * images that were changed, added, renamed or deleted, and the categories, block list and
+ * member groups if they were changed. When KPhotoAlbum did not shut down properly, the FileReader
+ * replays the entries on top of index.xml.
+ *
+ * The Database tells the Journal about every change as it happens, so writing an entry takes as
+ * long as the changes since the last one, not as long as the database is large. Setting a field
+ * of an image to the value it already has does not make the image dirty, and is ignored; the dirty
+ * flag is cleared once the image is in an entry. Changes to the categories are told apart by the
+ * revisions of the categories.
+ *
+ * Saving index.xml is the checkpoint: it holds all changes, and the journal starts over.
+ * To keep the journal from growing without bounds, every so many entries it is replaced by
+ * a single entry holding all changes since the checkpoint.
+ *
+ * All methods must be called on the GUI thread; the FileWriters created are written by a SaveTask.
+ */
+class Journal
+{
+public:
+    Journal();
+    static QString fileName( const QString& directory );
+    /**
+     * @return a string identifying the current contents of \p indexFile.
+     * The journal is only replayed on top of the very index.xml it was written for.
+     */
+    static QString baseIdentity( const QString& indexFile );
+
+    /**
+     * The database was just read, with \p replayedEntries entries of the journal replayed on top of index.xml.
+     */
+    void loaded( Database* db, int replayedEntries );
+    /**
+     * The database as it is now is being written to index.xml.
+     */
+    void checkpoint( Database* db );
+    /**
+     * @return a FileWriter holding the changes since the last entry, or \c nullptr if there are none.
+     */
+    FileWriter* createEntry( Database* db );
+
+    /**
+     * \p info, which is in the database, was changed.
+     */
+    void imageChanged( DB::ImageInfo* info );
+    /**
+     * \p images were added to the database. Unless \p appended is \c true, they were not simply
+     * put at the end of the image list, in the order given.
+     */
+    void imagesAdded( const DB::ImageInfoList& images, bool appended );
+    /**
+     * \p info was renamed; it was called \p oldName before.
+     */
+    void imageRenamed( DB::ImageInfo* info, const DB::FileName& oldName );
+    /**
+     * \p info is being deleted from the database.
+     */
+    void imageDeleted( DB::ImageInfo* info );
+    /**
+     * Images were moved within the image list.
+     */
+    void orderChanged();
+    void blockListChanged();
+    void memberGroupsChanged();
+
+    /**
+     * The journal does not reflect the database any more, because writing an entry or index.xml failed.
+     * Until index.xml is saved again, auto saves must write the whole database.
+     */
+    void setBroken( bool broken ) { m_broken = broken; }
+    bool isBroken() const { return m_broken; }
+
+private:
+    /**
+     * \brief The changes since some point in time.
+     * The images are left out as soon as they are deleted from the database, so they are never dangling.
+     */
+    struct Changes {
+        Changes();
+        void clear();
+        bool isEmpty() const;
+        void imageChanged( DB::ImageInfo* info );
+        void imagesAdded( const DB::ImageInfoList& images, bool appended );
+        void imageRenamed( DB::ImageInfo* info, const DB::FileName& oldName );
+        void imageDeleted( DB::ImageInfo* info );
+        void clearDirtyFlags() const;
+
+        // the images new to the database, in the order they were appended in:
+        QList<DB::ImageInfo*> added;
+        QSet<DB::ImageInfo*> isAdded;
+        // the changed images that are not new:
+        QSet<DB::ImageInfo*> changed;
+        // the names the renamed images had at the start:
+        QHash<DB::ImageInfo*, DB::FileName> renamed;
+        DB::FileNameList deleted;
+        bool order;
+        bool blockList;
+        bool memberGroups;
+    };
+    static QList<int> categoryRevisions( Database* db );
+
+    Changes m_sinceLast;
+    Changes m_sinceCheckpoint;
+    QList<int> m_lastCategories;
+    QList<int> m_checkpointCategories;
+    int m_entries;
+    // after replaying, the checkpoint is not what is in index.xml:
+    bool m_canCompact;
+    bool m_broken;
+};
+
+}
+
+#endif /* XMLDB_JOURNAL_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
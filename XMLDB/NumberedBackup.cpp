@@ -18,13 +18,19 @@
 #include "NumberedBackup.h"
 #include "Settings/SettingsData.h"
 #include <kzip.h>
-#include <kmessagebox.h>
 #include <KLocalizedString>
 #include <qregexp.h>
 #include <qdir.h>
 #include "Utilities/Util.h"
 
-void XMLDB::NumberedBackup::makeNumberedBackup()
+XMLDB::NumberedBackup::NumberedBackup()
+    : m_imageDirectory( Settings::SettingsData::instance()->imageDirectory() )
+    , m_compressBackup( Settings::SettingsData::instance()->compressBackup() )
+    , m_backupCount( Settings::SettingsData::instance()->backupCount() )
+{
+}
+
+QString XMLDB::NumberedBackup::makeNumberedBackup()
 {
     deleteOldBackupFiles();
 
@@ -32,28 +38,29 @@ void XMLDB::NumberedBackup::makeNumberedBackup()
     QString fileName;
     fileName.sprintf( "index.xml~%04d~", max+1 );
 
-    if ( !QFileInfo( QString::fromLatin1( "%1/index.xml" ).arg( Settings::SettingsData::instance()->imageDirectory() ) ).exists() )
-        return;
+    if ( !QFileInfo( QString::fromLatin1( "%1/index.xml" ).arg( m_imageDirectory ) ).exists() )
+        return QString();
 
-    if ( Settings::SettingsData::instance()->compressBackup() ) {
+    if ( m_compressBackup ) {
         QString fileNameWithExt = fileName + QString::fromLatin1( ".zip" );
 
-        QString fileAndDir = QString::fromLatin1( "%1/%2" ).arg(Settings::SettingsData::instance()->imageDirectory() ).arg(fileNameWithExt);
+        QString fileAndDir = QString::fromLatin1( "%1/%2" ).arg( m_imageDirectory ).arg(fileNameWithExt);
         KZip zip( fileAndDir );
-        if ( ! zip.open( QIODevice::WriteOnly ) ) {
-            KMessageBox::error( nullptr, i18n("Error creating zip file %1",fileAndDir) );
-            return;
-        }
+        if ( ! zip.open( QIODevice::WriteOnly ) )
+            return i18n("Error creating zip file %1",fileAndDir);
 
-        if ( !zip.addLocalFile( QString::fromLatin1( "%1/index.xml" ).arg( Settings::SettingsData::instance()->imageDirectory() ), fileName ) )
+        QString error;
+        if ( !zip.addLocalFile( QString::fromLatin1( "%1/index.xml" ).arg( m_imageDirectory ), fileName ) )
         {
-            KMessageBox::error( nullptr, i18n("Error writing file %1 to zip file %2", fileName, fileAndDir) );
+            error = i18n("Error writing file %1 to zip file %2", fileName, fileAndDir);
         }
         zip.close();
+        return error;
     }
     else {
-        Utilities::copy( QString::fromLatin1( "%1/index.xml" ).arg( Settings::SettingsData::instance()->imageDirectory() ),
-                    QString::fromLatin1( "%1/%2" ).arg( Settings::SettingsData::instance()->imageDirectory() ).arg( fileName ) );
+        Utilities::copy( QString::fromLatin1( "%1/index.xml" ).arg( m_imageDirectory ),
+                    QString::fromLatin1( "%1/%2" ).arg( m_imageDirectory ).arg( fileName ) );
+        return QString();
     }
 }
 
@@ -71,7 +78,7 @@ int XMLDB::NumberedBackup::getMaxId() const
 
 QStringList XMLDB::NumberedBackup::backupFiles() const
 {
-    QDir dir( Settings::SettingsData::instance()->imageDirectory() );
+    QDir dir( m_imageDirectory );
     return dir.entryList( QStringList() << QString::fromLatin1( "index.xml~*~*" ), QDir::Files );
 }
 
@@ -92,7 +99,7 @@ int XMLDB::NumberedBackup::idForFile( const QString& fileName, bool& OK ) const
 void XMLDB::NumberedBackup::deleteOldBackupFiles()
 {
     int maxId = getMaxId();
-    int maxBackupFiles = Settings::SettingsData::instance()->backupCount();
+    int maxBackupFiles = m_backupCount;
     if ( maxBackupFiles == -1 )
         return;
 
@@ -102,7 +109,7 @@ void XMLDB::NumberedBackup::deleteOldBackupFiles()
         bool OK;
         int num = idForFile( *fileIt, OK );
         if ( OK && num <= maxId+1 - maxBackupFiles ) {
-            (QDir( Settings::SettingsData::instance()->imageDirectory() )).remove( *fileIt );
+            (QDir( m_imageDirectory )).remove( *fileIt );
         }
 
     }
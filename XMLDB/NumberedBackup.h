@@ -20,15 +20,29 @@
 #include <qstringlist.h>
 
 namespace XMLDB {
+    /**
+     * \brief Keeps numbered copies of index.xml around.
+     *
+     * The settings are read in the constructor, so makeNumberedBackup() may run on any thread.
+     */
     class NumberedBackup
     {
     public:
-        void makeNumberedBackup();
+        NumberedBackup();
+        /**
+         * @return a message describing the error, or an empty string if the backup was made.
+         */
+        QString makeNumberedBackup();
     protected:
         int getMaxId() const;
         QStringList backupFiles() const;
         int idForFile( const QString& fileName, bool& OK ) const;
         void deleteOldBackupFiles();
+
+    private:
+        QString m_imageDirectory;
+        bool m_compressBackup;
+        int m_backupCount;
     };
 }
 
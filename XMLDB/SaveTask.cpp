@@ -0,0 +1,52 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "SaveTask.h"
+#include "FileWriter.h"
+
+#include <QMetaObject>
+#include <QObject>
+#include <QStringList>
+
+XMLDB::SaveTask::SaveTask( QObject* receiver, FileWriter* writer, const QString& fileName, bool isAutoSave )
+    : m_receiver( receiver )
+    , m_writer( writer )
+    , m_fileName( fileName )
+    , m_isAutoSave( isAutoSave )
+{
+}
+
+XMLDB::SaveTask::~SaveTask()
+{
+}
+
+void XMLDB::SaveTask::run()
+{
+    const auto progress = [this]( int percent ) {
+        QMetaObject::invokeMethod( m_receiver, "saveProgress", Qt::QueuedConnection, Q_ARG( int, percent ) );
+    };
+    const bool success = m_writer->isJournalEntry() ? m_writer->appendToJournal( m_fileName, progress )
+                                                    : m_writer->write( m_fileName, m_isAutoSave, progress );
+    QMetaObject::invokeMethod( m_receiver, "saveWritten", Qt::QueuedConnection,
+                               Q_ARG( bool, m_isAutoSave ), Q_ARG( bool, success ), Q_ARG( QStringList, m_writer->errors() ) );
+
+    // The copy of the database goes away on this thread, rather than holding up the GUI.
+    m_writer.reset();
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
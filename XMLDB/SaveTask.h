@@ -0,0 +1,61 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef XMLDB_SAVETASK_H
+#define XMLDB_SAVETASK_H
+
+#include <QRunnable>
+#include <QString>
+
+#include <memory>
+
+class QObject;
+
+namespace XMLDB
+{
+class FileWriter;
+
+/**
+ * \brief Write a FileWriter's copy of the database to disk on a worker thread.
+ * For an entry of the XMLDB::Journal, \p fileName is the journal it is appended to.
+ *
+ * While writing, the signal <tt>saveProgress(int)</tt> of the receiver is invoked through a queued connection.
+ * When done, its slot <tt>saveWritten(bool isAutoSave, bool success, QStringList errors)</tt> is invoked the same way,
+ * as any errors must be shown on the GUI thread.
+ */
+class SaveTask : public QRunnable
+{
+public:
+    /**
+     * The task takes ownership of \p writer.
+     */
+    SaveTask( QObject* receiver, FileWriter* writer, const QString& fileName, bool isAutoSave );
+    ~SaveTask() override;
+    void run() override;
+
+private:
+    QObject* m_receiver;
+    std::unique_ptr<FileWriter> m_writer;
+    QString m_fileName;
+    bool m_isAutoSave;
+};
+
+}
+
+#endif /* XMLDB_SAVETASK_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,88 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "StackIndex.h"
+
+#include <algorithm>
+
+void XMLDB::StackIndex::clear()
+{
+    m_members.clear();
+    m_stackOf.clear();
+}
+
+void XMLDB::StackIndex::insert( const DB::ImageInfoPtr& info )
+{
+    if ( !info->isStacked() )
+        return;
+
+    const DB::FileName fileName = info->fileName();
+    if ( m_stackOf.contains( fileName ) )
+        remove( fileName );
+    m_stackOf.insert( fileName, info->stackId() );
+    m_members[info->stackId()].append( info );
+}
+
+void XMLDB::StackIndex::remove( const DB::FileName& fileName )
+{
+    const auto it = m_stackOf.find( fileName );
+    if ( it == m_stackOf.end() )
+        return;
+
+    const auto members = m_members.find( it.value() );
+    if ( members != m_members.end() ) {
+        DB::ImageInfoList& list = members.value();
+        for ( int i = 0; i < list.size(); ++i ) {
+            if ( list.at( i )->fileName() == fileName ) {
+                list.removeAt( i );
+                break;
+            }
+        }
+        if ( list.isEmpty() )
+            m_members.erase( members );
+    }
+    m_stackOf.erase( it );
+}
+
+void XMLDB::StackIndex::rename( const DB::FileName& oldName, const DB::FileName& newName )
+{
+    // The members are kept as ImageInfos, which know their new name already.
+    const auto it = m_stackOf.find( oldName );
+    if ( it == m_stackOf.end() )
+        return;
+    const DB::StackID stackId = it.value();
+    m_stackOf.erase( it );
+    m_stackOf.insert( newName, stackId );
+}
+
+DB::StackID XMLDB::StackIndex::stackOf( const DB::FileName& fileName ) const
+{
+    return m_stackOf.value( fileName, 0 );
+}
+
+DB::FileNameList XMLDB::StackIndex::members( DB::StackID stackId ) const
+{
+    // The stack order is changed through the ImageInfos, so it is only sorted here:
+    DB::ImageInfoList list = m_members.value( stackId );
+    std::stable_sort( list.begin(), list.end(), []( const DB::ImageInfoPtr& a, const DB::ImageInfoPtr& b ) {
+        return a->stackOrder() < b->stackOrder();
+    });
+    return list.files();
+}
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -0,0 +1,66 @@
+/* Copyright (C) 2019 The KPhotoAlbum Development Team
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; see the file COPYING.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+#ifndef XMLDB_STACKINDEX_H
+#define XMLDB_STACKINDEX_H
+
+#include <DB/FileName.h>
+#include <DB/FileNameList.h>
+#include <DB/ImageInfo.h>
+#include <DB/ImageInfoList.h>
+
+#include <QHash>
+
+namespace XMLDB
+{
+
+/**
+ * \brief The members of every stack of XMLDB::Database, and the stack of every stacked image.
+ *
+ * The index is kept up to date by the database whenever images are stacked, unstacked,
+ * added, renamed or deleted, so looking up a stack never needs to scan all images.
+ */
+class StackIndex
+{
+public:
+    void clear();
+    /**
+     * Add \p info to the stack it is in. Images that are not stacked are ignored.
+     */
+    void insert( const DB::ImageInfoPtr& info );
+    void remove( const DB::FileName& fileName );
+    void rename( const DB::FileName& oldName, const DB::FileName& newName );
+
+    /**
+     * @return the stack \p fileName is in, or 0 if it is not stacked.
+     */
+    DB::StackID stackOf( const DB::FileName& fileName ) const;
+    /**
+     * @return the images of the stack, sorted by their stack order.
+     */
+    DB::FileNameList members( DB::StackID stackId ) const;
+
+private:
+    QHash<DB::StackID, DB::ImageInfoList> m_members;
+    QHash<DB::FileName, DB::StackID> m_stackOf;
+};
+
+}
+
+#endif /* XMLDB_STACKINDEX_H */
+
+// vi:expandtab:tabstop=4 shiftwidth=4:
@@ -20,9 +20,16 @@
 #include "DB/MemberMap.h"
 #include "Utilities/List.h"
 
+namespace
+{
+// shared by all categories, so no two categories ever have the same revision:
+int s_lastRevision = 0;
+}
+
 XMLDB::XMLCategory::XMLCategory( const QString& name, const QString& icon, ViewType type, int thumbnailSize, bool show, bool positionable )
     : m_name( name ), m_icon( icon ), m_show( show ), m_type( type ), m_thumbnailSize( thumbnailSize ), m_positionable ( positionable ), m_categoryType(DB::Category::PlainCategory), m_shouldSave( true )
 {
+    markChanged();
 }
 
 QString XMLDB::XMLCategory::name() const
@@ -33,6 +40,7 @@ QString XMLDB::XMLCategory::name() const
 void XMLDB::XMLCategory::setName( const QString& name )
 {
     m_name = name;
+    markChanged();
 }
 
 void XMLDB::XMLCategory::setPositionable( bool positionable )
@@ -40,6 +48,7 @@ void XMLDB::XMLCategory::setPositionable( bool positionable )
     if ( positionable != m_positionable )
     {
         m_positionable = positionable;
+    markChanged();
         emit changed();
     }
 }
@@ -57,12 +66,14 @@ QString XMLDB::XMLCategory::iconName() const
 void XMLDB::XMLCategory::setIconName( const QString& name )
 {
     m_icon = name;
+    markChanged();
     emit changed();
 }
 
 void XMLDB::XMLCategory::setViewType( ViewType type )
 {
     m_type = type;
+    markChanged();
     emit changed();
 }
 
@@ -74,6 +85,7 @@ XMLDB::XMLCategory::ViewType XMLDB::XMLCategory::viewType() const
 void XMLDB::XMLCategory::setDoShow( bool b )
 {
     m_show = b;
+    markChanged();
     emit changed();
 }
 
@@ -100,11 +112,13 @@ bool XMLDB::XMLCategory::isSpecialCategory() const
 void XMLDB::XMLCategory::addOrReorderItems( const QStringList& items )
 {
     m_items = Utilities::mergeListsUniqly(items, m_items);
+    markChanged();
 }
 
 void XMLDB::XMLCategory::setItems( const QStringList& items )
 {
     m_items = items;
+    markChanged();
 }
 
 void XMLDB::XMLCategory::removeItem( const QString& item )
@@ -112,6 +126,7 @@ void XMLDB::XMLCategory::removeItem( const QString& item )
     m_items.removeAll( item );
     m_nameMap.remove(idForName(item));
     m_idMap.remove(item);
+    markChanged();
     emit itemRemoved( item );
 }
 
@@ -133,6 +148,7 @@ void XMLDB::XMLCategory::addItem( const QString& item )
     if (m_items.contains( item ))
         m_items.removeAll(item);
     m_items.prepend(item);
+    markChanged();
 }
 
 QStringList XMLDB::XMLCategory::items() const
@@ -175,6 +191,7 @@ void XMLDB::XMLCategory::setIdMapping( const QString& name, int id )
 {
     m_nameMap.insert( id, name );
     m_idMap.insert( name, id);
+    markChanged();
 }
 
 QString XMLDB::XMLCategory::nameForId( int id ) const
@@ -185,6 +202,7 @@ QString XMLDB::XMLCategory::nameForId( int id ) const
 void XMLDB::XMLCategory::setThumbnailSize( int size )
 {
     m_thumbnailSize = size;
+    markChanged();
     emit changed();
 }
 
@@ -201,11 +219,13 @@ bool XMLDB::XMLCategory::shouldSave()
 void XMLDB::XMLCategory::setShouldSave( bool b)
 {
     m_shouldSave = b;
+    markChanged();
 }
 
 void XMLDB::XMLCategory::setBirthDate(const QString &item, const QDate &birthDate)
 {
     m_birthDates.insert(item,birthDate);
+    markChanged();
 }
 
 QDate XMLDB::XMLCategory::birthDate(const QString &item) const
@@ -213,4 +233,9 @@ QDate XMLDB::XMLCategory::birthDate(const QString &item) const
     return m_birthDates[item];
 }
 
+void XMLDB::XMLCategory::markChanged()
+{
+    m_revision = ++s_lastRevision;
+}
+
 // vi:expandtab:tabstop=4 shiftwidth=4:
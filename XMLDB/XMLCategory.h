@@ -58,6 +58,7 @@ namespace XMLDB {
         virtual void addItem( const QString& item ) override;
         virtual QStringList items() const override;
         int idForName( const QString& name ) const;
+        QMap<QString,int> idMap() const { return m_idMap; }
         void initIdMap();
         void setIdMapping( const QString& name, int id );
         QString nameForId( int id ) const;
@@ -67,7 +68,14 @@ namespace XMLDB {
         void setBirthDate(const QString& item, const QDate& birthDate) override;
         QDate birthDate(const QString& item) const override;
 
+        /**
+         * @return a number that changes whenever anything that is saved about the category changes.
+         */
+        int revision() const { return m_revision; }
+
     private:
+        void markChanged();
+
         QString m_name;
         QString m_icon;
         bool m_show;
@@ -82,6 +90,7 @@ namespace XMLDB {
         QMap<QString,QDate> m_birthDates;
 
         bool m_shouldSave;
+        int m_revision;
     };
 }
 
@@ -18,7 +18,6 @@
 
 #include "XMLImageDateCollection.h"
 #include "DB/ImageDB.h"
-#include "DB/FileNameList.h"
 
 void XMLDB::XMLImageDateCollection::add( const DB::ImageDate& date )
 {
@@ -126,10 +125,10 @@ QDateTime XMLDB::XMLImageDateCollection::upperLimit() const
     return QDateTime( QDate( 2100, 1, 1 ) );
 }
 
-XMLDB::XMLImageDateCollection::XMLImageDateCollection(const DB::FileNameList& list)
+XMLDB::XMLImageDateCollection::XMLImageDateCollection(const QList<DB::ImageDate>& dates)
 {
-    Q_FOREACH(const DB::FileName& fileName, list) {
-        add(fileName.info()->date());
+    for (const DB::ImageDate& date : dates) {
+        add(date);
     }
     buildIndex();
 }
@@ -18,17 +18,16 @@
 #ifndef XMLIMAGEDATECOLLECTION_H
 #define XMLIMAGEDATECOLLECTION_H
 
+#include <QList>
 #include <QMap>
 #include "DB/ImageDateCollection.h"
 
-namespace DB { class FileNameList; }
-
 namespace XMLDB
 {
 class XMLImageDateCollection :public DB::ImageDateCollection
 {
 public:
-    explicit XMLImageDateCollection(const DB::FileNameList&);
+    explicit XMLImageDateCollection(const QList<DB::ImageDate>&);
 
 public:
     virtual DB::ImageCount count( const DB::ImageDate& range );